@@ -9,69 +9,60 @@ local ParticleSystem = {
 }
 
 local ParticleMetadata = {
-    particles = {},
-    NextParticleIndex = 1
+    pool = nil
 }
 
 function ParticleSystem:OnCreate()
     self.Root = Scene.CreateEntity("ParticleSystemRoot")
-    for i = 1, self.maxParticles do
-        local p1 = Scene.CreateEntity("particle", self.Root)
-        p1:AddCircleRenderer()
-        if self.UsePhysics then
-            local body = p1:AddRigidbody()
-            body.Type = BodyType.Dynamic
-            local collider = p1:AddCircleCollider()
-            collider.Restitution = 0.5
-            collider.Friction = 0.0
-            collider.Density = 0.01
-            Physics.SetGravityScale(p1, 0.3) -- low gravity for particles
-            p1:RebuildFixtures()
-        end
-        p1:SetScale(Vec3.new(0.1, 0.1, 0.1)) -- Small size for particles
-        p1:SetEnabled(false) -- Start disabled, will be enabled when emitted
-        table.insert(ParticleMetadata.particles, {
-            id = i,
-            entity = p1,
-            lifetime = 0,
-            velocity = Vec2.new(0, 0),
-            position = Vec3.new(0, 0, 0)
-        })
+    -- build one particle and let the engine pool copies of it
+    local p1 = Scene.CreateEntity("particle", self.Root)
+    p1:AddCircleRenderer()
+    if self.UsePhysics then
+        local body = p1:AddRigidbody()
+        body.Type = BodyType.Dynamic
+        local collider = p1:AddCircleCollider()
+        collider.Restitution = 0.5
+        collider.Friction = 0.0
+        collider.Density = 0.01
     end
+    p1:SetScale(Vec3.new(0.1, 0.1, 0.1)) -- Small size for particles
+    ParticleMetadata.pool = Scene.CreatePool(Scene.CreatePrefab(p1), self.maxParticles, self.Root)
+    Scene.DestroyEntity(p1)
     print("ParticleSystem created")
 end
 
 function ParticleSystem:OnUpdate(ts)
-    for i, particle in pairs(self.ActiveParticles) do
+    for entity, particle in pairs(self.ActiveParticles) do
         particle.lifetime = particle.lifetime - ts
-        particle.entity.CircleRenderer.Color = self.StartColor * (particle.lifetime / self.Lifetime) + self.EndColor * (1 - particle.lifetime / self.Lifetime)
+        entity.CircleRenderer.Color = self.StartColor * (particle.lifetime / self.Lifetime) + self.EndColor * (1 - particle.lifetime / self.Lifetime)
         if not self.UsePhysics then
             particle.position.x = particle.position.x + particle.velocity.x * ts
             particle.position.y = particle.position.y + particle.velocity.y * ts
-            particle.entity:SetPosition(particle.position)
+            entity:SetPosition(particle.position)
         end
         if particle.lifetime <= 0 then
-            -- print("Disabling particle " .. particle.id)
-            particle.entity:SetEnabled(false)
-            self.ActiveParticles[particle.id] = nil
+            ParticleMetadata.pool:Release(entity)
+            self.ActiveParticles[entity] = nil
         end
     end
 end
 
 function ParticleSystem:Emit(position, velocity)
-    local particle = ParticleMetadata.particles[ParticleMetadata.NextParticleIndex]
-    ParticleMetadata.NextParticleIndex = ParticleMetadata.NextParticleIndex % self.maxParticles + 1
-    if not self.ActiveParticles[particle.id] then
-        particle.entity:SetEnabled(true)
-        particle.position = position
-        particle.entity:SetPosition(position)
-        if self.UsePhysics then
-            Physics.SetLinearVelocity(particle.entity, velocity)
-        end
-        particle.velocity = velocity
-        particle.lifetime = self.Lifetime
-        self.ActiveParticles[particle.id] = particle
+    local entity = ParticleMetadata.pool:Acquire()
+    if not entity then
+        return -- every particle is alive
+    end
+    entity:SetPosition(position)
+    if self.UsePhysics then
+        -- low gravity for particles. it is a setting of the runtime body, which the pool resets on every Acquire
+        Physics.SetGravityScale(entity, 0.3)
+        Physics.SetLinearVelocity(entity, velocity)
     end
+    self.ActiveParticles[entity] = {
+        lifetime = self.Lifetime,
+        velocity = velocity,
+        position = position
+    }
 end
 
 return ParticleSystem
\ No newline at end of file
@@ -521,11 +521,13 @@ namespace Engine
 
 			// Draw Box Colliders
 			{
-				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, BoxCollider2DComponent>(entt::exclude<DisabledComponent>);
+				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, BoxCollider2DComponent>();
 
 				for (auto entity : view)
 				{
 					auto [tc, bc2d] = view.get<TransformComponent, BoxCollider2DComponent>(entity);
+					if (!tc.ActiveInHierarchy)
+						continue;
 
 					glm::vec3 globalPos, globalRot, globalScale;
 					Math::DecomposeTransform(tc.GlobalTransform, globalPos, globalRot, globalScale);
@@ -581,11 +583,13 @@ namespace Engine
 
 			// Draw Circle Colliders
 			{
-				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, CircleCollider2DComponent>(entt::exclude<DisabledComponent>);
+				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, CircleCollider2DComponent>();
 
 				for (auto entity : view)
 				{
 					auto [tc, cc2d] = view.get<TransformComponent, CircleCollider2DComponent>(entity);
+					if (!tc.ActiveInHierarchy)
+						continue;
 
 					glm::vec3 globalPos, globalRot, globalScale;
 					Math::DecomposeTransform(tc.GlobalTransform, globalPos, globalRot, globalScale);
@@ -630,6 +634,116 @@ namespace Engine
 					//}
 				}
 			}
+
+			// collider space point (offset included) to world space, like Entity::AttachFixturesToRigidbodyParent places them
+			auto toWorld = [](const glm::vec3& position, float rotation, const glm::vec3& scale, const glm::vec2& point) {
+				glm::vec2 scaled = point * glm::vec2(scale.x, scale.y);
+				float c = std::cos(rotation), s = std::sin(rotation);
+				return glm::vec3(position.x + c * scaled.x - s * scaled.y, position.y + s * scaled.x + c * scaled.y, position.z + zIndex);
+			};
+
+			// Draw Polygon Colliders
+			{
+				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, PolygonCollider2DComponent>();
+
+				for (auto entity : view)
+				{
+					auto [tc, pc2d] = view.get<TransformComponent, PolygonCollider2DComponent>(entity);
+					if (!tc.ActiveInHierarchy || pc2d.Vertices.size() < 2)
+						continue;
+
+					glm::vec3 globalPos, globalRot, globalScale;
+					Math::DecomposeTransform(tc.GlobalTransform, globalPos, globalRot, globalScale);
+
+					const size_t count = pc2d.Vertices.size();
+					for (size_t i = 0; i < count; i++)
+					{
+						glm::vec3 p0 = toWorld(globalPos, globalRot.z, globalScale, pc2d.Offset + pc2d.Vertices[i]);
+						glm::vec3 p1 = toWorld(globalPos, globalRot.z, globalScale, pc2d.Offset + pc2d.Vertices[(i + 1) % count]);
+						Renderer2D::DrawLine(p0, p1, m_PhysicsCollidersColor);
+					}
+				}
+			}
+
+			// Draw Capsule Colliders
+			{
+				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, CapsuleCollider2DComponent>();
+
+				for (auto entity : view)
+				{
+					auto [tc, cap2d] = view.get<TransformComponent, CapsuleCollider2DComponent>(entity);
+					if (!tc.ActiveInHierarchy)
+						continue;
+
+					glm::vec3 globalPos, globalRot, globalScale;
+					Math::DecomposeTransform(tc.GlobalTransform, globalPos, globalRot, globalScale);
+
+					float radius = cap2d.Radius * std::abs(globalScale.x);
+					float halfSegment = std::max(0.5f * cap2d.Height * std::abs(globalScale.y) - radius, 0.0f);
+
+					glm::vec3 center = toWorld(globalPos, globalRot.z, globalScale, cap2d.Offset);
+					glm::vec3 axis = { -std::sin(globalRot.z), std::cos(globalRot.z), 0.0f };
+					glm::vec3 side = { axis.y, -axis.x, 0.0f };
+
+					for (float direction : { 1.0f, -1.0f })
+					{
+						glm::mat4 transform = glm::translate(glm::mat4(1.0f), center + direction * halfSegment * axis)
+							* glm::scale(glm::mat4(1.0f), glm::vec3(radius * 2.0f, radius * 2.0f, 1.0f));
+						Renderer2D::DrawCircle(transform, m_PhysicsCollidersColor, 0.05f);
+
+						glm::vec3 p0 = center + direction * radius * side + halfSegment * axis;
+						glm::vec3 p1 = center + direction * radius * side - halfSegment * axis;
+						Renderer2D::DrawLine(p0, p1, m_PhysicsCollidersColor);
+					}
+				}
+			}
+
+			// Draw Edge Chain Colliders
+			{
+				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, EdgeChainCollider2DComponent>();
+
+				for (auto entity : view)
+				{
+					auto [tc, ec2d] = view.get<TransformComponent, EdgeChainCollider2DComponent>(entity);
+					if (!tc.ActiveInHierarchy || ec2d.Points.size() < 2)
+						continue;
+
+					glm::vec3 globalPos, globalRot, globalScale;
+					Math::DecomposeTransform(tc.GlobalTransform, globalPos, globalRot, globalScale);
+
+					const size_t count = ec2d.Points.size();
+					const size_t segments = ec2d.Loop ? count : count - 1;
+					for (size_t i = 0; i < segments; i++)
+					{
+						glm::vec3 p0 = toWorld(globalPos, globalRot.z, globalScale, ec2d.Offset + ec2d.Points[i]);
+						glm::vec3 p1 = toWorld(globalPos, globalRot.z, globalScale, ec2d.Offset + ec2d.Points[(i + 1) % count]);
+						Renderer2D::DrawLine(p0, p1, m_PhysicsCollidersColor);
+					}
+				}
+			}
+
+			// Draw Joints, from the anchor to the connected anchor (or the target of mouse joints)
+			{
+				auto view = m_ActiveScene->GetAllEntitiesWith<TransformComponent, Joint2DComponent>();
+
+				for (auto entity : view)
+				{
+					auto [tc, joint] = view.get<TransformComponent, Joint2DComponent>(entity);
+					if (!tc.ActiveInHierarchy)
+						continue;
+
+					glm::vec4 anchor = tc.GlobalTransform * glm::vec4(joint.Anchor, 0.0f, 1.0f);
+					glm::vec4 connectedAnchor = { joint.ConnectedAnchor, 0.0f, 1.0f };
+					if (joint.Type == Joint2DComponent::JointType::Mouse)
+						connectedAnchor = { joint.Target, 0.0f, 1.0f };
+					else if (Entity connected = m_ActiveScene->FindEntityByUUID(joint.ConnectedEntity))
+						connectedAnchor = connected.GetComponent<TransformComponent>().GlobalTransform * connectedAnchor;
+
+					glm::vec3 p0 = { anchor.x, anchor.y, anchor.z + zIndex };
+					glm::vec3 p1 = { connectedAnchor.x, connectedAnchor.y, anchor.z + zIndex };
+					Renderer2D::DrawLine(p0, p1, m_PhysicsCollidersColor);
+				}
+			}
 		}
 		Entity selectedEntity = m_SceneHierarchyPanel->GetSelectedEntity();
 		if (selectedEntity)
@@ -783,6 +897,32 @@ namespace Engine
 		if (m_HoveredEntity)
 			name = m_HoveredEntity.GetComponent<TagComponent>().Tag;
 		ImGui::Text("Hovered Entity: %s", name.c_str());
+		ImGui::Text("Play Snapshot: %.3f ms, Restore: %.3f ms", m_SnapshotTime, m_RestoreTime);
+
+		if (m_SceneState != SceneState::Edit)
+		{
+			const auto& sceneStats = m_ActiveScene->GetStats();
+			ImGui::Text("Scene Stats:");
+			ImGui::Text("Update: %.3f ms", sceneStats.UpdateTime);
+			ImGui::Text("Scripts: %.3f ms", sceneStats.ScriptTime);
+			ImGui::Text("Physics: %.3f ms", sceneStats.PhysicsTime);
+			if (m_ActiveScene->m_PipelinedPhysics)
+				ImGui::Text("Physics Worker: %.3f ms (main thread waited %.3f ms)", sceneStats.PhysicsWorkerTime, sceneStats.PhysicsWaitTime);
+			ImGui::Text("Render: %.3f ms", sceneStats.RenderTime);
+			ImGui::Text("Particles: %d (%.3f ms)", sceneStats.ParticleCount, sceneStats.ParticleTime);
+			ImGui::Text("Fixed Steps: %d", sceneStats.FixedSteps);
+			ImGui::Text("Synced Bodies: %d", sceneStats.SyncedBodies);
+			ImGui::Text("Contact Events: %d", sceneStats.ContactEvents);
+			ImGui::Text("Fixtures Created: %d", sceneStats.FixturesCreated);
+
+			const auto& scriptStats = m_ActiveScene->GetScriptStats();
+			if (!scriptStats.empty() && ImGui::TreeNode("Script Updates"))
+			{
+				for (const auto& script : scriptStats)
+					ImGui::Text("%s: %d (%.3f ms)", script.Script.c_str(), script.Updates, script.UpdateTime);
+				ImGui::TreePop();
+			}
+		}
 
 		// Print the exact numbers
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
@@ -877,6 +1017,29 @@ namespace Engine
 
 		ImGui::Columns(1);
 
+		// Fixed timestep
+		ImGui::DragInt("Fixed update rate (Hz)", (int*)&m_ActiveScene->m_FixedUpdateRate, 1, 1, 240, "%d", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::DragInt("Max sub steps", (int*)&m_ActiveScene->m_MaxSubSteps, 1, 1, 20, "%d", ImGuiSliderFlags_AlwaysClamp);
+		ImGui::Checkbox("Interpolate transforms", &m_ActiveScene->m_InterpolateTransforms);
+		ImGui::Checkbox("Pipelined physics", &m_ActiveScene->m_PipelinedPhysics);
+
+		// Physics recording. Also replayed without the editor by running with --replay-physics <file>.
+		bool recordPhysics = !m_ActiveScene->m_PhysicsRecordingPath.empty();
+		if (ImGui::Checkbox("Record physics", &recordPhysics))
+			m_ActiveScene->m_PhysicsRecordingPath = recordPhysics ? std::filesystem::path("PhysicsRecordings") / (m_ActiveScene->m_SceneName + ".physrec") : std::filesystem::path();
+		if (recordPhysics && m_SceneState == SceneState::Edit)
+		{
+			ImGui::SameLine();
+			if (ImGui::Button("Replay"))
+			{
+				PhysicsReplay::Result result = PhysicsReplay::Run(m_ActiveScene->m_PhysicsRecordingPath);
+				if (result.Matches())
+					APP_LOG_INFO("Physics replay matches: {0} steps in {1:.3f} ms, {2} bodies.", result.Steps, result.StepTime, result.Bodies);
+				else
+					APP_LOG_WARN("Physics replay does not match: {0} of {1} bodies differ.", result.Mismatches, result.Bodies);
+			}
+		}
+
 		// Physics colliders color
 		ImGui::Checkbox("Show physics colliders", &m_ShowPhysicsColliders);
 		if (m_ShowPhysicsColliders)
@@ -1030,7 +1193,10 @@ namespace Engine
 
 		m_SceneState = SceneState::Play;
 
-		m_EditorScene = Scene::Copy(m_ActiveScene);
+		Timer timer;
+		m_EditorScene = m_ActiveScene;
+		m_EditorScene->TakeSnapshot();
+		m_SnapshotTime = timer.ElapsedMillis();
 		m_ActiveScene->OnRuntimeStart();
 		
 		m_SceneHierarchyPanel->SetContext(m_ActiveScene);
@@ -1043,7 +1209,10 @@ namespace Engine
 
 		m_SceneState = SceneState::Simulate;
 
-		m_EditorScene = Scene::Copy(m_ActiveScene);
+		Timer timer;
+		m_EditorScene = m_ActiveScene;
+		m_EditorScene->TakeSnapshot();
+		m_SnapshotTime = timer.ElapsedMillis();
 		m_ActiveScene->OnSimulationStart();
 
 		m_SceneHierarchyPanel->SetContext(m_ActiveScene);
@@ -1058,6 +1227,13 @@ namespace Engine
 
 		m_SceneState = SceneState::Edit;
 
+		// undo everything that changed while playing. the active scene may be a different one if the game requested a scene change
+		if (m_EditorScene->HasSnapshot())
+		{
+			Timer timer;
+			m_EditorScene->RestoreSnapshot();
+			m_RestoreTime = timer.ElapsedMillis();
+		}
 		m_ActiveScene = m_EditorScene;
 
 		m_SceneHierarchyPanel->SetContext(m_ActiveScene);
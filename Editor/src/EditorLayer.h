@@ -78,6 +78,10 @@ namespace Engine
 		float m_FPSHistory[10] = { 0.0f };
 		int m_FPSOffset = 0;
 
+		// Time taken to snapshot the scene on play and to restore it on stop
+		float m_SnapshotTime = 0.0f;
+		float m_RestoreTime = 0.0f;
+
 		bool m_ShowPrimaryCameraBounds = false;
 
 		int m_GizmoType = -1;
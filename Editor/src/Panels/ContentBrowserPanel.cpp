@@ -66,6 +66,15 @@ namespace Engine {
 					ImGui::EndDragDropSource();
 				}
 			}
+			else if (ext == ".prefab")
+			{
+				if (ImGui::BeginDragDropSource())
+				{
+					const wchar_t* itemPath = relativePath.c_str();
+					ImGui::SetDragDropPayload("CONTENT_BROWSER_ITEM_PREFAB", itemPath, (wcslen(itemPath) + 1) * sizeof(wchar_t));
+					ImGui::EndDragDropSource();
+				}
+			}
 			else if (ext == ".lua")
 			{
 				if (ImGui::BeginDragDropSource())
@@ -7,7 +7,11 @@
 #include <imgui/imgui_stdlib.h>
 #include <glm/gtc/type_ptr.hpp>
 #include "Engine/Scene/Components.h"
+#include "Engine/Scene/Prefab.h"
+#include "Engine/Scene/Hierarchy.h"
+#include "Engine/Project/Project.h"
 #include "Engine/Utils/AudioEngine.h"
+#include "Engine/Utils/FileDialogs.h"
 
 namespace Engine {
 
@@ -40,6 +44,19 @@ namespace Engine {
 			child = next;
 		}
 		
+		// Drop a prefab anywhere in the window to instantiate it under the scene root
+		if (ImGui::BeginDragDropTargetCustom(ImGui::GetCurrentWindow()->Rect(), ImGui::GetID("SceneHierarchy")))
+		{
+			if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("CONTENT_BROWSER_ITEM_PREFAB"))
+			{
+				const wchar_t* path = (const wchar_t*)payload->Data;
+				std::shared_ptr<Prefab> prefab = Prefab::Load(Project::GetAssetFileSystemPath(path));
+				if (prefab)
+					m_SelectionContext = m_Context->InstantiatePrefab(*prefab, 1, sceneRoot)[0];
+			}
+			ImGui::EndDragDropTarget();
+		}
+
 		if (ImGui::IsMouseDown(0) && ImGui::IsWindowHovered())
 			m_SelectionContext = {};
 		
@@ -66,6 +83,25 @@ namespace Engine {
 	}
 
 	void SceneHierarchyPanel::DrawEntityNode(Entity entity)
+	{
+		// Walk the subtree without recursion. Children are only visited when their parent's tree node is open,
+		// and every open node is popped once its children are drawn.
+		Entity entityToDelete;
+		Hierarchy::Traverse(entity,
+			[&](Entity current) { return DrawEntityTreeNode(current, entityToDelete); },
+			[](Entity current) { ImGui::TreePop(); }
+		);
+
+		// deleted after drawing, the walk still needs the links of the deleted entity
+		if (entityToDelete)
+		{
+			m_Context->DestroyEntity(entityToDelete);
+			if (m_SelectionContext == entityToDelete)
+				m_SelectionContext = {};
+		}
+	}
+
+	bool SceneHierarchyPanel::DrawEntityTreeNode(Entity entity, Entity& entityToDelete)
 	{
 		auto& tag = entity.GetComponent<TagComponent>().Tag;
 		bool isEnabled = entity.isEnabled(); // Store state
@@ -86,12 +122,11 @@ namespace Engine {
 			m_SelectionContext = entity;
 		}
 		
-		bool entityDeleted = false;
 		if (ImGui::BeginPopupContextItem())
 		{
 			if (ImGui::MenuItem("Create Child Entity"))
 				m_Context->CreateNewChildEntity(entity);
-			if (isEnabled)
+			if (entity.isSelfEnabled())
 			{
 				if (ImGui::MenuItem("Disable Entity"))
 					entity.setEnabled(false);
@@ -101,34 +136,20 @@ namespace Engine {
 				if (ImGui::MenuItem("Enable Entity"))
 					entity.setEnabled(true);
 			}
-			if (ImGui::MenuItem("Delete Entity"))
-				entityDeleted = true;
-
-			ImGui::EndPopup();
-		}
-
-		if (opened)
-		{
-			Entity child = { entity.GetComponent<RelationshipComponent>().FirstChild, m_Context.get() };
-			while (child)
+			if (ImGui::MenuItem("Save as Prefab"))
 			{
-				// If DrawEntityNode(child) deletes the child, 'child' becomes invalid, and trying to get 'child.GetComponent' in the next line would CRASH.
-				Entity next = { child.GetComponent<RelationshipComponent>().NextSibling, m_Context.get() };
-
-				DrawEntityNode(child);
-
-				child = next;
+				// scripts load prefabs by their path relative to the asset directory
+				std::string filepath = FileDialogs::SaveFile("Prefab (*.prefab)\0*.prefab\0", "prefab");
+				if (!filepath.empty())
+					Prefab::Create(entity)->Save(filepath);
 			}
+			if (ImGui::MenuItem("Delete Entity"))
+				entityToDelete = entity;
 
-			ImGui::TreePop();
+			ImGui::EndPopup();
 		}
 
-		if (entityDeleted)
-		{
-			m_Context->DestroyEntity(entity);
-			if (m_SelectionContext == entity)
-				m_SelectionContext = {};
-		}
+		return opened;
 	}
 
 	static void DrawVec3Control(const std::string& label, glm::vec3& values, float resetValue = 0.0f, float columnWidth = 100.0f)
@@ -229,6 +250,93 @@ namespace Engine {
 		}
 	}
 
+	// Material, contact and filter settings shared by every collider component
+	template<typename Collider>
+	static void DrawColliderSettings(Collider& component)
+	{
+		ImGui::DragFloat("Density", &component.Density, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Friction", &component.Friction, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Restitution", &component.Restitution, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Restitution Threshold", &component.RestitutionThreshold, 0.01f, 0.0f);
+		auto& contact = component.ContactOptions;
+		ImGui::Checkbox("Is Sensor", &contact.IsSensor);
+		ImGui::Checkbox("One Way", &contact.OneWay);
+		if (contact.OneWay)
+			ImGui::DragFloat2("One Way Direction", glm::value_ptr(contact.OneWayDirection), 0.01f);
+		ImGui::DragFloat("Impulse Threshold", &contact.ImpulseThreshold, 0.01f, 0.0f);
+		if (ImGui::TreeNode("My Categories"))
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				// Check if the i-th bit is currently 1
+				bool active = (component.Category & (1 << i)) != 0;
+
+				if (ImGui::Checkbox((std::string("Category-") + std::to_string(i)).c_str(), &active))
+				{
+					if (active)
+						component.Category |= (1 << i);  // Set the bit to 1
+					else
+						component.Category &= ~(1 << i); // Clear the bit to 0
+				}
+			}
+			ImGui::TreePop();
+		}
+
+		// --- MASK: What can I hit? ---
+		if (ImGui::TreeNode("Collidable Categories"))
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				// Check if the i-th bit is currently 1
+				bool active = (component.Mask & (1 << i)) != 0;
+
+				if (ImGui::Checkbox((std::string("Category-") + std::to_string(i)).c_str(), &active))
+				{
+					if (active)
+						component.Mask |= (1 << i);  // Set the bit to 1
+					else
+						component.Mask &= ~(1 << i); // Clear the bit to 0
+				}
+			}
+			ImGui::TreePop();
+		}
+	}
+
+	// Editable list of 2D points, at least 'minCount' and at most 'maxCount' of them
+	static void DrawPointList(const char* label, std::vector<glm::vec2>& points, size_t minCount, size_t maxCount)
+	{
+		if (!ImGui::TreeNodeEx(label, ImGuiTreeNodeFlags_DefaultOpen))
+			return;
+
+		int removeIndex = -1;
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			ImGui::PushID((int)i);
+			ImGui::DragFloat2("##Point", glm::value_ptr(points[i]), 0.05f);
+			ImGui::SameLine();
+			ImGui::BeginDisabled(points.size() <= minCount);
+			if (ImGui::Button("-"))
+				removeIndex = (int)i;
+			ImGui::EndDisabled();
+			ImGui::PopID();
+		}
+		if (removeIndex >= 0)
+			points.erase(points.begin() + removeIndex);
+
+		ImGui::BeginDisabled(points.size() >= maxCount);
+		if (ImGui::Button("Add Point"))
+		{
+			// continue the last segment so the new point does not land on top of an existing one
+			glm::vec2 point = points.empty() ? glm::vec2(0.0f) : points.back() + glm::vec2(1.0f, 0.0f);
+			if (points.size() >= 2)
+				point = 2.0f * points.back() - points[points.size() - 2];
+			points.push_back(point);
+		}
+		ImGui::EndDisabled();
+
+		ImGui::TreePop();
+	}
+
 	template<typename T>
 	void SceneHierarchyPanel::DisplayAddComponentEntry(const std::string& entryName) {
 		if (!m_SelectionContext.HasComponent<T>())
@@ -252,7 +360,7 @@ namespace Engine {
 			strcpy_s(buffer, sizeof(buffer), tag.c_str());
 			if (ImGui::InputText("##Tag", buffer, sizeof(buffer)))
 			{
-				tag = std::string(buffer);
+				entity.SetName(std::string(buffer));
 			}
 		}
 
@@ -271,7 +379,12 @@ namespace Engine {
 			DisplayAddComponentEntry<Rigidbody2DComponent>("Rigidbody 2D");
 			DisplayAddComponentEntry<BoxCollider2DComponent>("Box Collider 2D");
 			DisplayAddComponentEntry<CircleCollider2DComponent>("Circle Collider 2D");
+			DisplayAddComponentEntry<PolygonCollider2DComponent>("Polygon Collider 2D");
+			DisplayAddComponentEntry<CapsuleCollider2DComponent>("Capsule Collider 2D");
+			DisplayAddComponentEntry<EdgeChainCollider2DComponent>("Edge Chain Collider 2D");
+			DisplayAddComponentEntry<Joint2DComponent>("Joint 2D");
 			DisplayAddComponentEntry<TextComponent>("Text Component");
+			DisplayAddComponentEntry<ParticleEmitterComponent>("Particle Emitter");
 			DisplayAddComponentEntry<ScriptComponent>("Script");
 			DisplayAddComponentEntry<AudioSourcesComponent>("Audio Sources");
 
@@ -546,6 +659,23 @@ namespace Engine {
 				ImGui::DragFloat("Fade", &component.Fade, 0.00025f, 0.0f, 1.0f);
 			});
 
+		DrawComponent<ParticleEmitterComponent>("Particle Emitter", entity, [](ParticleEmitterComponent& component)
+			{
+				ImGui::DragFloat2("Velocity", glm::value_ptr(component.Velocity), 0.1f);
+				ImGui::DragFloat2("Velocity Variation", glm::value_ptr(component.VelocityVariation), 0.1f, 0.0f);
+				ImGui::ColorEdit4("Color Begin", glm::value_ptr(component.ColorBegin));
+				ImGui::ColorEdit4("Color End", glm::value_ptr(component.ColorEnd));
+				ImGui::DragFloat("Size Begin", &component.SizeBegin, 0.01f, 0.0f);
+				ImGui::DragFloat("Size End", &component.SizeEnd, 0.01f, 0.0f);
+				ImGui::DragFloat("Size Variation", &component.SizeVariation, 0.01f, 0.0f);
+				ImGui::DragFloat("Life Time", &component.LifeTime, 0.05f, 0.01f);
+				ImGui::DragFloat("Emission Rate", &component.EmissionRate, 1.0f, 0.0f);
+
+				int maxParticles = (int)component.MaxParticles;
+				if (ImGui::DragInt("Max Particles", &maxParticles, 100.0f, 1, 1000000))
+					component.MaxParticles = (uint32_t)maxParticles;
+			});
+
 		DrawComponent<Rigidbody2DComponent>("Rigidbody 2D", entity, [](Rigidbody2DComponent& component)
 			{
 				const char* bodyTypeStrings[] = { "Static", "Dynamic", "Kinematic" };
@@ -575,91 +705,162 @@ namespace Engine {
 			{
 				ImGui::DragFloat2("Offset", glm::value_ptr(component.Offset));
 				ImGui::DragFloat2("Size", glm::value_ptr(component.Size));
-				ImGui::DragFloat("Density", &component.Density, 0.01f, 0.0f, 1.0f);
-				ImGui::DragFloat("Friction", &component.Friction, 0.01f, 0.0f, 1.0f);
-				ImGui::DragFloat("Restitution", &component.Restitution, 0.01f, 0.0f, 1.0f);
-				ImGui::DragFloat("Restitution Threshold", &component.RestitutionThreshold, 0.01f, 0.0f);
-				if (ImGui::TreeNode("My Categories"))
+				DrawColliderSettings(component);
+			});
+
+		DrawComponent<CircleCollider2DComponent>("Circle Collider 2D", entity, [](CircleCollider2DComponent& component)
+			{
+				ImGui::DragFloat2("Offset", glm::value_ptr(component.Offset));
+				ImGui::DragFloat("Radius", &component.Radius);
+				DrawColliderSettings(component);
+			});
+
+		DrawComponent<PolygonCollider2DComponent>("Polygon Collider 2D", entity, [](PolygonCollider2DComponent& component)
+			{
+				ImGui::DragFloat2("Offset", glm::value_ptr(component.Offset));
+				DrawPointList("Vertices", component.Vertices, 3, PolygonCollider2DComponent::MaxVertices);
+				DrawColliderSettings(component);
+			});
+
+		DrawComponent<CapsuleCollider2DComponent>("Capsule Collider 2D", entity, [](CapsuleCollider2DComponent& component)
+			{
+				ImGui::DragFloat2("Offset", glm::value_ptr(component.Offset));
+				ImGui::DragFloat("Radius", &component.Radius, 0.01f, 0.0f);
+				ImGui::DragFloat("Height", &component.Height, 0.01f, 0.0f);
+				DrawColliderSettings(component);
+			});
+
+		DrawComponent<EdgeChainCollider2DComponent>("Edge Chain Collider 2D", entity, [](EdgeChainCollider2DComponent& component)
+			{
+				ImGui::DragFloat2("Offset", glm::value_ptr(component.Offset));
+				ImGui::Checkbox("Loop", &component.Loop);
+				DrawPointList("Points", component.Points, component.Loop ? 3 : 2, SIZE_MAX);
+				DrawColliderSettings(component);
+			});
+
+		DrawComponent<Joint2DComponent>("Joint 2D", entity, [&](Joint2DComponent& component)
+			{
+				const char* jointTypeStrings[] = { "Revolute", "Distance", "Prismatic", "Weld", "Mouse" };
+				const char* currentJointTypeString = jointTypeStrings[(int)component.Type];
+				if (ImGui::BeginCombo("Joint Type", currentJointTypeString))
 				{
-					for (int i = 0; i < 16; i++)
+					for (int i = 0; i < 5; i++)
 					{
-						// Check if the i-th bit is currently 1
-						bool active = (component.Category & (1 << i)) != 0;
-
-						if (ImGui::Checkbox((std::string("Category-") + std::to_string(i)).c_str(), &active))
+						bool isSelected = currentJointTypeString == jointTypeStrings[i];
+						if (ImGui::Selectable(jointTypeStrings[i], isSelected))
 						{
-							if (active)
-								component.Category |= (1 << i);  // Set the bit to 1
-							else
-								component.Category &= ~(1 << i); // Clear the bit to 0
+							currentJointTypeString = jointTypeStrings[i];
+							component.Type = (Joint2DComponent::JointType)i;
 						}
+
+						if (isSelected)
+							ImGui::SetItemDefaultFocus();
 					}
-					ImGui::TreePop();
+
+					ImGui::EndCombo();
 				}
 
-				// --- MASK: What can I hit? ---
-				if (ImGui::TreeNode("Collidable Categories"))
+				const bool isMouse = component.Type == Joint2DComponent::JointType::Mouse;
+				if (!isMouse)
 				{
-					for (int i = 0; i < 16; i++)
+					Entity connected = m_Context->FindEntityByUUID(component.ConnectedEntity);
+					static char searchBuffer[128] = "";
+					if (ImGui::BeginCombo("Connected Entity", connected ? connected.GetName().c_str() : "(World)"))
 					{
-						// Check if the i-th bit is currently 1
-						bool active = (component.Mask & (1 << i)) != 0;
+						if (ImGui::IsWindowAppearing())
+							ImGui::SetKeyboardFocusHere();
+						ImGui::InputText("##Search", searchBuffer, sizeof(searchBuffer));
 
-						if (ImGui::Checkbox((std::string("Category-") + std::to_string(i)).c_str(), &active))
+						if (ImGui::Selectable("(World)", !connected))
+							component.ConnectedEntity = 0;
+
+						auto view = m_Context->GetAllEntitiesWith<TagComponent>();
+						for (auto e : view)
 						{
-							if (active)
-								component.Mask |= (1 << i);  // Set the bit to 1
-							else
-								component.Mask &= ~(1 << i); // Clear the bit to 0
+							Entity candidate = { e, m_Context.get() };
+							if (candidate == entity || candidate == m_Context->GetSceneRoot())
+								continue;
+
+							const char* itemText = candidate.GetName().c_str();
+							if (searchBuffer[0] != '\0' && strstr(itemText, searchBuffer) == nullptr)
+								continue;
+
+							ImGui::PushID((int)(uint32_t)e);
+							const bool isSelected = connected == candidate;
+							if (ImGui::Selectable(itemText, isSelected))
+							{
+								component.ConnectedEntity = candidate.GetUUID();
+								searchBuffer[0] = '\0';
+							}
+							if (isSelected)
+								ImGui::SetItemDefaultFocus();
+							ImGui::PopID();
 						}
+
+						ImGui::EndCombo();
 					}
-					ImGui::TreePop();
 				}
-			});
 
-		DrawComponent<CircleCollider2DComponent>("Circle Collider 2D", entity, [](CircleCollider2DComponent& component)
-			{
-				ImGui::DragFloat2("Offset", glm::value_ptr(component.Offset));
-				ImGui::DragFloat("Radius", &component.Radius);
-				ImGui::DragFloat("Density", &component.Density, 0.01f, 0.0f, 1.0f);
-				ImGui::DragFloat("Friction", &component.Friction, 0.01f, 0.0f, 1.0f);
-				ImGui::DragFloat("Restitution", &component.Restitution, 0.01f, 0.0f, 1.0f);
-				ImGui::DragFloat("Restitution Threshold", &component.RestitutionThreshold, 0.01f, 0.0f);
-				if (ImGui::TreeNode("My Categories"))
+				ImGui::DragFloat2("Anchor", glm::value_ptr(component.Anchor), 0.05f);
+				if (!isMouse)
 				{
-					for (int i = 0; i < 16; i++)
-					{
-						// Check if the i-th bit is currently 1
-						bool active = (component.Category & (1 << i)) != 0;
-
-						if (ImGui::Checkbox((std::string("Category-") + std::to_string(i)).c_str(), &active))
-						{
-							if (active)
-								component.Category |= (1 << i);  // Set the bit to 1
-							else
-								component.Category &= ~(1 << i); // Clear the bit to 0
-						}
-					}
-					ImGui::TreePop();
+					ImGui::DragFloat2("Connected Anchor", glm::value_ptr(component.ConnectedAnchor), 0.05f);
+					ImGui::Checkbox("Collide Connected", &component.CollideConnected);
 				}
 
-				// --- MASK: What can I hit? ---
-				if (ImGui::TreeNode("Collidable Categories"))
+				switch (component.Type)
 				{
-					for (int i = 0; i < 16; i++)
-					{
-						// Check if the i-th bit is currently 1
-						bool active = (component.Mask & (1 << i)) != 0;
+				case Joint2DComponent::JointType::Revolute:
+				case Joint2DComponent::JointType::Prismatic:
+				{
+					const bool isRevolute = component.Type == Joint2DComponent::JointType::Revolute;
+					if (!isRevolute)
+						ImGui::DragFloat2("Axis", glm::value_ptr(component.Axis), 0.01f);
 
-						if (ImGui::Checkbox((std::string("Category-") + std::to_string(i)).c_str(), &active))
+					ImGui::Checkbox("Enable Limit", &component.EnableLimit);
+					if (component.EnableLimit)
+					{
+						if (isRevolute)
 						{
-							if (active)
-								component.Mask |= (1 << i);  // Set the bit to 1
-							else
-								component.Mask &= ~(1 << i); // Clear the bit to 0
+							// edited in degrees, stored in radians
+							float lower = glm::degrees(component.LowerLimit), upper = glm::degrees(component.UpperLimit);
+							if (ImGui::DragFloat("Lower Angle", &lower, 1.0f))
+								component.LowerLimit = glm::radians(lower);
+							if (ImGui::DragFloat("Upper Angle", &upper, 1.0f))
+								component.UpperLimit = glm::radians(upper);
 						}
+						else
+						{
+							ImGui::DragFloat("Lower Translation", &component.LowerLimit, 0.05f);
+							ImGui::DragFloat("Upper Translation", &component.UpperLimit, 0.05f);
+						}
+					}
+
+					ImGui::Checkbox("Enable Motor", &component.EnableMotor);
+					if (component.EnableMotor)
+					{
+						ImGui::DragFloat("Motor Speed", &component.MotorSpeed, 0.05f);
+						ImGui::DragFloat(isRevolute ? "Max Motor Torque" : "Max Motor Force", &component.MaxMotorForce, 0.1f, 0.0f);
 					}
-					ImGui::TreePop();
+					break;
+				}
+				case Joint2DComponent::JointType::Distance:
+					ImGui::DragFloat("Length", &component.Length, 0.05f, -1.0f);
+					ImGui::DragFloat("Min Length", &component.MinLength, 0.05f, -1.0f);
+					ImGui::DragFloat("Max Length", &component.MaxLength, 0.05f, -1.0f);
+					ImGui::DragFloat("Frequency", &component.Frequency, 0.05f, 0.0f);
+					ImGui::DragFloat("Damping Ratio", &component.DampingRatio, 0.01f, 0.0f);
+					break;
+				case Joint2DComponent::JointType::Weld:
+					ImGui::DragFloat("Frequency", &component.Frequency, 0.05f, 0.0f);
+					ImGui::DragFloat("Damping Ratio", &component.DampingRatio, 0.01f, 0.0f);
+					break;
+				case Joint2DComponent::JointType::Mouse:
+					ImGui::DragFloat2("Target", glm::value_ptr(component.Target), 0.05f);
+					ImGui::DragFloat("Max Force", &component.MaxForce, 1.0f, 0.0f);
+					ImGui::DragFloat("Frequency", &component.Frequency, 0.05f, 0.0f);
+					ImGui::DragFloat("Damping Ratio", &component.DampingRatio, 0.01f, 0.0f);
+					break;
 				}
 			});
 
@@ -23,6 +23,7 @@ namespace Engine {
 		void DisplayAddComponentEntry(const std::string& entryName);
 
 		void DrawEntityNode(Entity entity);
+		bool DrawEntityTreeNode(Entity entity, Entity& entityToDelete);
 		void DrawComponents(Entity entity);
 	private:
 		std::shared_ptr<Scene> m_Context;
@@ -9,10 +9,12 @@
 
 #include "Engine/Utils/Random.h"
 #include "Engine/Utils/AudioEngine.h"
+#include "Engine/Utils/Timer.h"
 
 #include "Engine/Scene/Components.h"
 #include "Engine/Scene/Entity.h"
 #include "Engine/Scene/Scene.h"
+#include "Engine/Scene/SceneBenchmark.h"
 
 #include "Engine/Window/Input.h"
 #include "Engine/Window/KeyCodes.h"
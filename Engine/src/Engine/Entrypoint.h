@@ -7,6 +7,22 @@ extern Engine::Application* Engine::CreateApplication(ApplicationCommandLineArgs
 int main(int argc, char** argv)
 {
 	Engine::Logger::Init();
+
+	// Headless: replays a physics recording and reports whether it ends in the recorded state
+	if (argc == 3 && std::string(argv[1]) == "--replay-physics")
+	{
+		Engine::PhysicsReplay::Result result = Engine::PhysicsReplay::Run(argv[2]);
+		ENGINE_LOG_INFO("Physics replay: {0} steps in {1:.3f} ms, {2} bodies, {3} mismatches.", result.Steps, result.StepTime, result.Bodies, result.Mismatches);
+		return result.Matches() ? 0 : 1;
+	}
+
+	// Headless: times the scene's hot loops against the approaches they replaced, optional entity count scale
+	if ((argc == 2 || argc == 3) && std::string(argv[1]) == "--benchmark")
+	{
+		Engine::SceneBenchmark::Run(argc == 3 ? std::stof(argv[2]) : 1.0f);
+		return 0;
+	}
+
 	Engine::Random::Init();
 	Engine::AudioEngine::Init();
 
@@ -585,6 +585,47 @@ namespace Engine {
 			DrawQuad(transform, src.Color, entityID);
 	}
 
+	void Renderer2D::DrawParticles(const ParticleEmitterComponent& emitter, float depth, int entityID)
+	{
+		const ParticleBuffer& particles = emitter.Particles;
+		constexpr glm::vec2 textureCoords[] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+		constexpr glm::vec2 corners[] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+
+		uint32_t i = 0;
+		while (i < particles.Count)
+		{
+			if (s_Data.QuadIndexCount >= Renderer2DData::MaxIndices)
+				NextQuadsBatch();
+
+			// as many particles as the current batch has room for, no per quad checks
+			const uint32_t room = (Renderer2DData::MaxIndices - s_Data.QuadIndexCount) / 6;
+			const uint32_t end = std::min(particles.Count, i + room);
+			QuadVertex* vertex = s_Data.QuadVertexBufferPtr;
+			for (; i < end; i++)
+			{
+				// faded by the particle update already
+				const glm::vec4 color = { particles.ColorR[i], particles.ColorG[i], particles.ColorB[i], particles.ColorA[i] };
+				const float size = particles.Size[i];
+
+				for (size_t c = 0; c < 4; c++)
+				{
+					vertex->Position = { particles.PositionX[i] + corners[c].x * size, particles.PositionY[i] + corners[c].y * size, depth };
+					vertex->Color = color;
+					vertex->TexCoord = textureCoords[c];
+					vertex->TexIndex = 0.0f; // White Texture
+					vertex->TilingFactor = 1.0f;
+					vertex->EntityID = entityID;
+					vertex++;
+				}
+			}
+
+			const uint32_t written = (uint32_t)(vertex - s_Data.QuadVertexBufferPtr) / 4;
+			s_Data.QuadVertexBufferPtr = vertex;
+			s_Data.QuadIndexCount += written * 6;
+			s_Data.Stats.QuadCount += written;
+		}
+	}
+
 	void Renderer2D::DrawCircle(const glm::mat4& transform, const glm::vec4& color, float thickness /*= 1.0f*/, float fade /*= 0.005f*/, int entityID /*= -1*/)
 	{
 
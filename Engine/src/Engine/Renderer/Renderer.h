@@ -74,6 +74,9 @@ namespace Engine
 		
 		static void DrawSprite(const glm::mat4& transform, SpriteRendererComponent& src, int entityID);
 
+		// All live particles of the emitter as quads, written straight into the quad batch
+		static void DrawParticles(const ParticleEmitterComponent& emitter, float depth, int entityID = -1);
+
 		static void DrawCircle(const glm::mat4& transform, const glm::vec4& color, float thickness = 1.0f, float fade = 0.005f, int entityID = -1);
 
 		static void DrawLine(const glm::vec3& p0, glm::vec3& p1, const glm::vec4& color, int entityID = -1);
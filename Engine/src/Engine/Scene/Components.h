@@ -32,7 +32,7 @@ namespace Engine {
 
 	struct TagComponent
 	{
-		std::string Tag;
+		std::string Tag; // indexed by the scene, write it through Entity::SetName
 
 		TagComponent() = default;
 		TagComponent(const TagComponent&) = default;
@@ -41,16 +41,6 @@ namespace Engine {
 		}
 	};
 
-	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	/// DisabledComponent ///////////////////////////////////////////////////////////////////////////////////////////////////////////
-	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-	struct DisabledComponent
-	{
-		// no need for any items. if component is present, entity is disabled
-		bool disabled = true;
-	};
-
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// TransformComponent //////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -64,6 +54,16 @@ namespace Engine {
 		// engine only. not to be serialized. represents the global transform matrix. added here for caching to prevent recalculation of transform for each child
 		glm::mat4 GlobalTransform = GetTransform();
 
+		// engine only. not to be serialized. global transform at the start of the last fixed step, used to interpolate rendering between steps.
+		glm::mat4 PreviousGlobalTransform = GlobalTransform;
+		// engine only. set when the entity is created or enabled during runtime so the renderer does not interpolate from a stale position.
+		bool SnapInterpolation = true;
+
+		// the entity's own enabled state, this is what gets serialized.
+		bool Enabled = true;
+		// engine only. cached 'Enabled && parent is active', kept up to date by Scene::UpdateActiveInHierarchy. systems skip entities where this is false.
+		bool ActiveInHierarchy = true;
+
 		TransformComponent() = default;
 		TransformComponent(const TransformComponent&) = default;
 		TransformComponent(const glm::vec3& translation)
@@ -108,9 +108,26 @@ namespace Engine {
 
 	struct ScriptComponent
 	{
+		// How often OnUpdate runs. Script classes declare it with a 'Schedule' field (and 'UpdateInterval' in seconds),
+		// Entity:SetUpdateSchedule changes it at runtime. OnDemand scripts only update when Entity:ScheduleUpdate asks.
+		enum class UpdateSchedule { EveryStep = 0, Interval, OnDemand };
+
 		sol::table Instance;
+		// Resolved once when the instance is created, invalid if the script does not define them. They hold registry
+		// references, calling them skips looking the name up through the instance and its class every time.
+		sol::protected_function OnUpdate;
+		sol::protected_function OnCollisionBegin;
+		sol::protected_function OnCollisionEnd;
+		sol::protected_function OnDestroy;
 
 		std::string ScriptPath;
+
+		// storage for runtime
+		UpdateSchedule RuntimeSchedule = UpdateSchedule::EveryStep;
+		float RuntimeUpdateInterval = 0.0f;
+		double RuntimeLastUpdate = 0.0;		// script time of the last OnUpdate, interval and on demand updates get the time since as ts
+		uint32_t RuntimeScheduleGeneration = 0;	// bumped when rescheduled, updates scheduled before are dropped
+		uint32_t RuntimeStatsIndex = 0;		// into the scene's script statistics
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -155,11 +172,33 @@ namespace Engine {
 
 		// Storage for runtime
 		void* RuntimeBody = nullptr;
+		// body pose last written to the transform, bodies still there are skipped by the write back
+		glm::vec2 RuntimeSyncedPosition = { 0.0f, 0.0f };
+		float RuntimeSyncedAngle = 0.0f;
 
 		Rigidbody2DComponent() = default;
 		Rigidbody2DComponent(const Rigidbody2DComponent&) = default;
 	};
 	
+	// Where a collider's fixtures were built in their body's space, and from which settings. They are only rebuilt
+	// when this changes, moving the body itself leaves them alone.
+	struct ColliderPlacement
+	{
+		glm::vec2 Position = { 0.0f, 0.0f };
+		glm::vec2 Scale = { 0.0f, 0.0f };
+		float Angle = 0.0f;
+		uint64_t SettingsHash = 0; // shape, material, filter and sensor settings of the collider
+	};
+
+	// Contact options of every collider, handled by the contact listener without going through scripts
+	struct ColliderContactOptions
+	{
+		bool IsSensor = false;		// reports contacts but never collides (trigger)
+		bool OneWay = false;		// only collides with what comes from the OneWayDirection side (platforms)
+		glm::vec2 OneWayDirection = { 0.0f, 1.0f };	// in the rigidbody's space
+		float ImpulseThreshold = 0.0f;	// OnCollisionBegin is not reported to this entity's script for softer hits
+	};
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// BoxCollider2DComponent //////////////////////////////////////////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -176,9 +215,12 @@ namespace Engine {
 		uint16_t Category = 0x0001;		// Box2D Default: I am layer 1 (0x0001)
 		uint16_t Mask = 0xFFFF;		// Box2D Default: I collide with everything (0xFFFF)
 
+		ColliderContactOptions ContactOptions;
+
 		// storage for runtime
 		void* RuntimeFixture = nullptr;
 		entt::entity ClosestRigidbodyParent = entt::null;
+		ColliderPlacement RuntimePlacement;
 
 		BoxCollider2DComponent() = default;
 		BoxCollider2DComponent(const BoxCollider2DComponent&) = default;
@@ -200,14 +242,154 @@ namespace Engine {
 		uint16_t Category = 0x0001;		// Box2D Default: I am layer 1 (0x0001)
 		uint16_t Mask = 0xFFFF;		// Box2D Default: I collide with everything (0xFFFF)
 
+		ColliderContactOptions ContactOptions;
+
 		// storage for runtime
 		void* RuntimeFixture = nullptr;
 		entt::entity ClosestRigidbodyParent = entt::null;
+		ColliderPlacement RuntimePlacement;
 
 		CircleCollider2DComponent() = default;
 		CircleCollider2DComponent(const CircleCollider2DComponent&) = default;
 	};
 
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// PolygonCollider2DComponent //////////////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Convex polygon, Box2D computes the hull of the vertices
+	struct PolygonCollider2DComponent
+	{
+		static constexpr uint32_t MaxVertices = 8; // b2_maxPolygonVertices
+
+		glm::vec2 Offset = { 0.0f, 0.0f };
+		std::vector<glm::vec2> Vertices = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.0f, 0.5f } };
+
+		float Density = 1.0f;
+		float Friction = 0.5f;
+		float Restitution = 0.0f;
+		float RestitutionThreshold = 0.5f;
+		uint16_t Category = 0x0001;		// Box2D Default: I am layer 1 (0x0001)
+		uint16_t Mask = 0xFFFF;		// Box2D Default: I collide with everything (0xFFFF)
+
+		ColliderContactOptions ContactOptions;
+
+		// storage for runtime
+		void* RuntimeFixture = nullptr;
+		entt::entity ClosestRigidbodyParent = entt::null;
+		ColliderPlacement RuntimePlacement;
+
+		PolygonCollider2DComponent() = default;
+		PolygonCollider2DComponent(const PolygonCollider2DComponent&) = default;
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// CapsuleCollider2DComponent //////////////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Vertical capsule, Height includes both caps. Built from a box and two circles as Box2D has no capsule shape.
+	struct CapsuleCollider2DComponent
+	{
+		glm::vec2 Offset = { 0.0f, 0.0f };
+		float Radius = 0.5f;
+		float Height = 2.0f;
+
+		float Density = 1.0f;
+		float Friction = 0.5f;
+		float Restitution = 0.0f;
+		float RestitutionThreshold = 0.5f;
+		uint16_t Category = 0x0001;		// Box2D Default: I am layer 1 (0x0001)
+		uint16_t Mask = 0xFFFF;		// Box2D Default: I collide with everything (0xFFFF)
+
+		ColliderContactOptions ContactOptions;
+
+		// storage for runtime. RuntimeFixture is the box, or the only circle when Height leaves no room for it
+		void* RuntimeFixture = nullptr;
+		void* RuntimeCapFixtures[2] = { nullptr, nullptr };
+		entt::entity ClosestRigidbodyParent = entt::null;
+		ColliderPlacement RuntimePlacement;
+
+		CapsuleCollider2DComponent() = default;
+		CapsuleCollider2DComponent(const CapsuleCollider2DComponent&) = default;
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// EdgeChainCollider2DComponent ////////////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Connected edges for level geometry (b2ChainShape). Edges only collide on their right side looking from one point
+	// to the next: loops wound counter clockwise are solid from the outside, open ground lines go from right to left.
+	// Chains have no mass, use them on static bodies.
+	struct EdgeChainCollider2DComponent
+	{
+		glm::vec2 Offset = { 0.0f, 0.0f };
+		std::vector<glm::vec2> Points = { { 2.0f, 0.0f }, { -2.0f, 0.0f } };
+		bool Loop = false; // connects the last point back to the first
+
+		float Density = 1.0f;
+		float Friction = 0.5f;
+		float Restitution = 0.0f;
+		float RestitutionThreshold = 0.5f;
+		uint16_t Category = 0x0001;		// Box2D Default: I am layer 1 (0x0001)
+		uint16_t Mask = 0xFFFF;		// Box2D Default: I collide with everything (0xFFFF)
+
+		ColliderContactOptions ContactOptions;
+
+		// storage for runtime
+		void* RuntimeFixture = nullptr;
+		entt::entity ClosestRigidbodyParent = entt::null;
+		ColliderPlacement RuntimePlacement;
+
+		EdgeChainCollider2DComponent() = default;
+		EdgeChainCollider2DComponent(const EdgeChainCollider2DComponent&) = default;
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// Joint2DComponent ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Box2D joint between the rigidbody of this entity and the rigidbody of ConnectedEntity, or the world if it is 0.
+	// Mouse joints pull this entity's rigidbody towards Target and ignore ConnectedEntity.
+	struct Joint2DComponent
+	{
+		enum class JointType { Revolute = 0, Distance, Prismatic, Weld, Mouse };
+		JointType Type = JointType::Revolute;
+
+		UUID ConnectedEntity = 0;
+		glm::vec2 Anchor = { 0.0f, 0.0f };			// in this entity's space
+		glm::vec2 ConnectedAnchor = { 0.0f, 0.0f };	// in the connected entity's space, world space without one
+		bool CollideConnected = false;
+
+		// Revolute and prismatic. Angles are in radians, prismatic limits are distances along Axis.
+		glm::vec2 Axis = { 1.0f, 0.0f };	// prismatic only, in this entity's space
+		bool EnableLimit = false;
+		float LowerLimit = 0.0f;
+		float UpperLimit = 0.0f;
+		bool EnableMotor = false;
+		float MotorSpeed = 0.0f;
+		float MaxMotorForce = 10.0f;		// torque for revolute joints
+
+		// Distance. A negative Length takes the distance between the anchors when the joint is created,
+		// negative MinLength/MaxLength are the Length. Rope: MinLength 0.
+		float Length = -1.0f;
+		float MinLength = -1.0f;
+		float MaxLength = -1.0f;
+
+		// Distance, weld and mouse softness. 0 Hz is rigid, except for mouse joints which need some spring.
+		float Frequency = 0.0f;
+		float DampingRatio = 0.7f;
+
+		// Mouse
+		glm::vec2 Target = { 0.0f, 0.0f };	// world space
+		float MaxForce = 1000.0f;
+
+		// storage for runtime
+		void* RuntimeJoint = nullptr;
+
+		Joint2DComponent() = default;
+		Joint2DComponent(const Joint2DComponent&) = default;
+	};
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// TextComponent ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -223,6 +405,48 @@ namespace Engine {
 		float LineSpacing = 0.0f;
 	};
 
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// ParticleEmitterComponent ////////////////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Live particles of an emitter, in world space. Stored as a structure of arrays so the update loops run over
+	// plain float arrays the compiler can vectorize. Particles [0, Count) are alive, dead ones are swapped out.
+	struct ParticleBuffer
+	{
+		std::vector<float> PositionX, PositionY;
+		std::vector<float> VelocityX, VelocityY;
+		std::vector<float> Life; // remaining seconds
+		std::vector<float> InverseLifeTime;
+		std::vector<float> SizeBegin;
+		// interpolated over the life of each particle on every update, the renderer only copies them
+		std::vector<float> ColorR, ColorG, ColorB, ColorA;
+		std::vector<float> Size;
+		uint32_t Count = 0;
+		float EmitAccumulator = 0.0f;
+
+		ParticleBuffer() = default;
+		// runtime state only. a copied emitter (duplicate, prefab instance, snapshot) starts without particles
+		ParticleBuffer(const ParticleBuffer& other) {}
+		ParticleBuffer(ParticleBuffer&& other) noexcept = default;
+		ParticleBuffer& operator=(const ParticleBuffer& other) { Count = 0; EmitAccumulator = 0.0f; return *this; }
+		ParticleBuffer& operator=(ParticleBuffer&& other) noexcept = default;
+	};
+
+	struct ParticleEmitterComponent
+	{
+		glm::vec2 Velocity = { 0.0f, 1.0f };
+		glm::vec2 VelocityVariation = { 1.0f, 1.0f };
+		glm::vec4 ColorBegin = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glm::vec4 ColorEnd = { 1.0f, 1.0f, 1.0f, 0.0f };
+		float SizeBegin = 0.1f, SizeEnd = 0.0f, SizeVariation = 0.05f;
+		float LifeTime = 1.0f;
+		float EmissionRate = 0.0f; // particles per second while active, 0 to only emit from scripts
+		uint32_t MaxParticles = 10000;
+
+		// storage for runtime
+		ParticleBuffer Particles;
+	};
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// RelationshipComponent ///////////////////////////////////////////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
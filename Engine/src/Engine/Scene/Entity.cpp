@@ -9,9 +9,127 @@
 #include "box2d/b2_fixture.h"
 #include "box2d/b2_polygon_shape.h"
 #include "box2d/b2_circle_shape.h"
+#include "box2d/b2_chain_shape.h"
 
 namespace Engine {
 
+	// Material, filter and contact settings are the same for every collider component
+	template<typename Collider>
+	static b2FixtureDef MakeFixtureDef(const Collider& collider, const b2Shape* shape, entt::entity owner)
+	{
+		b2FixtureDef fixtureDef;
+		fixtureDef.shape = shape;
+		fixtureDef.density = collider.Density;
+		fixtureDef.friction = collider.Friction;
+		fixtureDef.restitution = collider.Restitution;
+		fixtureDef.restitutionThreshold = collider.RestitutionThreshold;
+		fixtureDef.filter.categoryBits = collider.Category;
+		fixtureDef.filter.maskBits = collider.Mask;
+		fixtureDef.isSensor = collider.ContactOptions.IsSensor;
+		fixtureDef.userData.pointer = (uintptr_t)(uint32_t)owner;
+		return fixtureDef;
+	}
+
+	// Removes the fixture from the body it was attached to
+	static void DestroyColliderFixture(Scene* scene, void*& fixture, entt::entity rigidbodyParent)
+	{
+		if (!fixture || rigidbodyParent == entt::null)
+			return;
+
+		scene->GetPhysicsRecorder().DestroyFixture((b2Fixture*)fixture);
+		fixture = nullptr;
+	}
+
+	// FNV-1a over the raw bytes of plain values
+	static void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+
+	template<typename T>
+	static void HashValue(uint64_t& hash, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be hashed.");
+		HashBytes(hash, &value, sizeof(T));
+	}
+
+	static void HashShape(uint64_t& hash, const BoxCollider2DComponent& collider) { HashValue(hash, collider.Size); }
+	static void HashShape(uint64_t& hash, const CircleCollider2DComponent& collider) { HashValue(hash, collider.Radius); }
+	static void HashShape(uint64_t& hash, const PolygonCollider2DComponent& collider)
+	{
+		HashBytes(hash, collider.Vertices.data(), collider.Vertices.size() * sizeof(glm::vec2));
+	}
+	static void HashShape(uint64_t& hash, const CapsuleCollider2DComponent& collider)
+	{
+		HashValue(hash, collider.Radius);
+		HashValue(hash, collider.Height);
+	}
+	static void HashShape(uint64_t& hash, const EdgeChainCollider2DComponent& collider)
+	{
+		HashBytes(hash, collider.Points.data(), collider.Points.size() * sizeof(glm::vec2));
+		HashValue(hash, collider.Loop);
+	}
+
+	// Everything of the collider its fixtures are built from. A script editing any of it gets new fixtures
+	// the next time the collider is attached, even if it did not move.
+	template<typename Collider>
+	static uint64_t HashColliderSettings(const Collider& collider)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		HashShape(hash, collider);
+		HashValue(hash, collider.Offset);
+		HashValue(hash, collider.Density);
+		HashValue(hash, collider.Friction);
+		HashValue(hash, collider.Restitution);
+		HashValue(hash, collider.RestitutionThreshold);
+		HashValue(hash, collider.Category);
+		HashValue(hash, collider.Mask);
+		HashValue(hash, collider.ContactOptions.IsSensor);
+		return hash;
+	}
+
+	// Placement of the fixtures about to be built for 'collider'
+	template<typename Collider>
+	static ColliderPlacement GetColliderPlacement(const Collider& collider, const ColliderPlacement& placement)
+	{
+		ColliderPlacement colliderPlacement = placement;
+		colliderPlacement.SettingsHash = HashColliderSettings(collider);
+		return colliderPlacement;
+	}
+
+	// Fixtures built on the same body at (nearly) the same placement from the same settings are still right. The
+	// tolerance absorbs the rounding of recomputing the placement from global transforms after the body moved.
+	template<typename Collider>
+	static bool IsFixturePlaced(const Collider& collider, entt::entity rigidbodyParent, const ColliderPlacement& placement)
+	{
+		constexpr float tolerance = 1e-4f;
+		const ColliderPlacement& built = collider.RuntimePlacement;
+		return collider.RuntimeFixture && collider.ClosestRigidbodyParent == rigidbodyParent &&
+			glm::all(glm::lessThanEqual(glm::abs(built.Position - placement.Position), glm::vec2(tolerance))) &&
+			glm::all(glm::lessThanEqual(glm::abs(built.Scale - placement.Scale), glm::vec2(tolerance))) &&
+			std::abs(built.Angle - placement.Angle) <= tolerance &&
+			built.SettingsHash == HashColliderSettings(collider);
+	}
+
+	// Polygons whose points are all (nearly) on a line or on top of each other have no hull
+	static bool IsValidPolygon(const b2Vec2* vertices, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			for (uint32_t j = i + 1; j < count; j++)
+			{
+				for (uint32_t k = j + 1; k < count; k++)
+				{
+					if (std::abs(b2Cross(vertices[j] - vertices[i], vertices[k] - vertices[i])) > b2_linearSlop * b2_linearSlop)
+						return true;
+				}
+			}
+		}
+		return false;
+	}
+
 	Entity::Entity(entt::entity handle, Scene* scene)
 		: m_EntityHandle(handle), m_Scene(scene)
 	{
@@ -36,42 +154,27 @@ namespace Engine {
 		return rbp;
 	}
 
+	void Entity::SetName(const std::string& name)
+	{
+		auto& tag = GetComponent<TagComponent>();
+		if (tag.Tag == name)
+			return;
+
+		// patch publishes on_update, which puts the entity back in the tag index under the new name
+		m_Scene->RemoveFromTagIndex(m_EntityHandle, tag.Tag);
+		m_Scene->m_Registry.patch<TagComponent>(m_EntityHandle, [&name](TagComponent& tc) { tc.Tag = name; });
+	}
+
     void Entity::setEnabled(bool enabled)
     {
         // Prevent redundant updates
-        if (isEnabled() == enabled)
+        auto& transform = GetComponent<TransformComponent>();
+        if (transform.Enabled == enabled)
             return;
 
-        auto& rc = GetComponent<RelationshipComponent>();
-        Entity parent = { rc.Parent, m_Scene };
-        bool status = enabled && parent.isEnabled();
-        if (HasComponent<Rigidbody2DComponent>())
-        {
-            auto& rb2d = GetComponent<Rigidbody2DComponent>();
-            if (rb2d.RuntimeBody)
-            {
-                b2Body* body = static_cast<b2Body*>(rb2d.RuntimeBody);
-                body->SetEnabled(status);
-            }
-        }
-		if (status)
-		{
-            RemoveComponent<DisabledComponent>();
-			AttachFixturesToRigidbodyParent();
-		}
-		else if (isEnabled())
-		{
-            AddComponent<DisabledComponent>();
-			DetachFixturesFromRigidbodyParent();
-		}
-
-
-        Entity child = { rc.FirstChild, m_Scene };
-        while (child)
-        {
-            child.setEnabled(status);
-            child = { child.GetComponent<RelationshipComponent>().NextSibling, m_Scene };
-        }
+        // only flags change, entities below that end up in a new state get their physics toggled
+        transform.Enabled = enabled;
+        m_Scene->UpdateActiveInHierarchy(*this);
     }
 
     void Entity::AttachFixturesToRigidbodyParent()
@@ -86,6 +189,11 @@ namespace Engine {
 		b2Body* body = (b2Body*)rootEntity.GetComponent<Rigidbody2DComponent>().RuntimeBody;
 		if (!body)
 			return;
+		PhysicsRecorder& recorder = m_Scene->GetPhysicsRecorder();
+		auto createFixture = [&](const b2FixtureDef& def) {
+			m_Scene->m_Stats.FixturesCreated++;
+			return recorder.CreateFixture(body, def);
+		};
 
 		// Calculate Relative Transform
 		glm::mat4 parentTransform = rootEntity.GetComponent<TransformComponent>().GlobalTransform;
@@ -109,8 +217,19 @@ namespace Engine {
 		glm::vec3 relativePos, relativeRot, relativeScale;
 		Math::DecomposeTransform(relativeMatrix, relativePos, relativeRot, relativeScale);
 
+		const glm::vec2 scale = { relativeScale.x, relativeScale.y };
+		const ColliderPlacement placement = { { relativePos.x, relativePos.y }, scale, relativeRot.z };
+		const float cosAngle = std::cos(relativeRot.z), sinAngle = std::sin(relativeRot.z);
+		// collider space (offset and scale already applied) to body space
+		auto toBody = [&](const glm::vec2& point) {
+			glm::vec2 scaled = point * scale;
+			return b2Vec2(
+				relativePos.x + cosAngle * scaled.x - sinAngle * scaled.y,
+				relativePos.y + sinAngle * scaled.x + cosAngle * scaled.y);
+		};
+
 		// Attach Box Collider
-		if (HasComponent<BoxCollider2DComponent>())
+		if (HasComponent<BoxCollider2DComponent>() && !IsFixturePlaced(GetComponent<BoxCollider2DComponent>(), rootEntity, placement))
 		{
 			auto& bc2d = GetComponent<BoxCollider2DComponent>();
 			b2PolygonShape boxShape;
@@ -129,31 +248,15 @@ namespace Engine {
 				),
 				relativeRot.z);
 
-			// Define Fixture
-			b2FixtureDef fixtureDef;
-			fixtureDef.shape = &boxShape;
-			fixtureDef.density = bc2d.Density;
-			fixtureDef.friction = bc2d.Friction;
-			fixtureDef.restitution = bc2d.Restitution;
-			fixtureDef.restitutionThreshold = bc2d.RestitutionThreshold;
-			fixtureDef.filter.categoryBits = bc2d.Category;
-			fixtureDef.filter.maskBits = bc2d.Mask;
-			fixtureDef.userData.pointer = (uintptr_t)(uint32_t)m_EntityHandle;
-
-			if (bc2d.RuntimeFixture && bc2d.ClosestRigidbodyParent != entt::null)
-			{
-				Entity oldRigidbodyParent = { bc2d.ClosestRigidbodyParent, m_Scene };
-				b2Body* oldBody = (b2Body*)oldRigidbodyParent.GetComponent<Rigidbody2DComponent>().RuntimeBody;
-				oldBody->DestroyFixture((b2Fixture*)bc2d.RuntimeFixture);
-				bc2d.RuntimeFixture = nullptr;
-			}
-
-			bc2d.RuntimeFixture = body->CreateFixture(&fixtureDef);
+			b2FixtureDef fixtureDef = MakeFixtureDef(bc2d, &boxShape, m_EntityHandle);
+			DestroyColliderFixture(m_Scene, bc2d.RuntimeFixture, bc2d.ClosestRigidbodyParent);
+			bc2d.RuntimeFixture = createFixture(fixtureDef);
 			bc2d.ClosestRigidbodyParent = rootEntity;
+			bc2d.RuntimePlacement = GetColliderPlacement(bc2d, placement);
 		}
 
 		// Attach Circle Collider
-		if (HasComponent<CircleCollider2DComponent>())
+		if (HasComponent<CircleCollider2DComponent>() && !IsFixturePlaced(GetComponent<CircleCollider2DComponent>(), rootEntity, placement))
 		{
 			auto& cc2d = GetComponent<CircleCollider2DComponent>();
 			b2CircleShape circleShape;
@@ -167,56 +270,167 @@ namespace Engine {
 			);
 			circleShape.m_radius = cc2d.Radius * maxScale;
 
-			b2FixtureDef fixtureDef;
-			fixtureDef.shape = &circleShape;
-			fixtureDef.density = cc2d.Density;
-			fixtureDef.friction = cc2d.Friction;
-			fixtureDef.restitution = cc2d.Restitution;
-			fixtureDef.restitutionThreshold = cc2d.RestitutionThreshold;
-			fixtureDef.filter.categoryBits = cc2d.Category;
-			fixtureDef.filter.maskBits = cc2d.Mask;
-			fixtureDef.userData.pointer = (uintptr_t)(uint32_t)m_EntityHandle;
-
-			if (cc2d.RuntimeFixture && cc2d.ClosestRigidbodyParent != entt::null)
+			b2FixtureDef fixtureDef = MakeFixtureDef(cc2d, &circleShape, m_EntityHandle);
+			DestroyColliderFixture(m_Scene, cc2d.RuntimeFixture, cc2d.ClosestRigidbodyParent);
+			cc2d.RuntimeFixture = createFixture(fixtureDef);
+			cc2d.ClosestRigidbodyParent = rootEntity;
+			cc2d.RuntimePlacement = GetColliderPlacement(cc2d, placement);
+		}
+
+		// Attach Polygon Collider
+		if (HasComponent<PolygonCollider2DComponent>() && !IsFixturePlaced(GetComponent<PolygonCollider2DComponent>(), rootEntity, placement))
+		{
+			auto& pc2d = GetComponent<PolygonCollider2DComponent>();
+			DestroyColliderFixture(m_Scene, pc2d.RuntimeFixture, pc2d.ClosestRigidbodyParent);
+
+			const uint32_t count = (uint32_t)pc2d.Vertices.size();
+			b2Vec2 vertices[b2_maxPolygonVertices];
+			if (count >= 3 && count <= PolygonCollider2DComponent::MaxVertices)
 			{
-				Entity oldRigidbodyParent = { cc2d.ClosestRigidbodyParent, m_Scene };
-				b2Body* oldBody = (b2Body*)oldRigidbodyParent.GetComponent<Rigidbody2DComponent>().RuntimeBody;
-				oldBody->DestroyFixture((b2Fixture*)cc2d.RuntimeFixture);
-				cc2d.RuntimeFixture = nullptr;
+				for (uint32_t i = 0; i < count; i++)
+					vertices[i] = toBody(pc2d.Offset + pc2d.Vertices[i]);
 			}
 
-			cc2d.RuntimeFixture = body->CreateFixture(&fixtureDef);
-			cc2d.ClosestRigidbodyParent = rootEntity;
+			// Box2D asserts on degenerate polygons, skip them instead
+			if (count < 3 || count > PolygonCollider2DComponent::MaxVertices || !IsValidPolygon(vertices, count))
+				ENGINE_LOG_WARN("Polygon collider of '{0}' needs 3 to {1} vertices spanning some area, it is not attached.", GetName(), PolygonCollider2DComponent::MaxVertices);
+			else
+			{
+				b2PolygonShape polygonShape;
+				polygonShape.Set(vertices, (int32)count);
+
+				b2FixtureDef fixtureDef = MakeFixtureDef(pc2d, &polygonShape, m_EntityHandle);
+				pc2d.RuntimeFixture = createFixture(fixtureDef);
+				pc2d.ClosestRigidbodyParent = rootEntity;
+				pc2d.RuntimePlacement = GetColliderPlacement(pc2d, placement);
+			}
+		}
+
+		// Attach Capsule Collider
+		if (HasComponent<CapsuleCollider2DComponent>() && !IsFixturePlaced(GetComponent<CapsuleCollider2DComponent>(), rootEntity, placement))
+		{
+			auto& cap2d = GetComponent<CapsuleCollider2DComponent>();
+			DestroyColliderFixture(m_Scene, cap2d.RuntimeFixture, cap2d.ClosestRigidbodyParent);
+			DestroyColliderFixture(m_Scene, cap2d.RuntimeCapFixtures[0], cap2d.ClosestRigidbodyParent);
+			DestroyColliderFixture(m_Scene, cap2d.RuntimeCapFixtures[1], cap2d.ClosestRigidbodyParent);
+
+			float radius = cap2d.Radius * std::abs(relativeScale.x);
+			float halfSegment = 0.5f * cap2d.Height * std::abs(relativeScale.y) - radius;
+			b2Vec2 center = toBody(cap2d.Offset);
+			b2Vec2 axis = b2Vec2(-sinAngle, cosAngle);
+
+			if (radius <= b2_linearSlop)
+				ENGINE_LOG_WARN("Capsule collider of '{0}' has no radius, it is not attached.", GetName());
+			else if (halfSegment <= b2_linearSlop)
+			{
+				// too short for a middle part, a circle is all that is left
+				b2CircleShape circleShape;
+				circleShape.m_p = center;
+				circleShape.m_radius = radius;
+
+				b2FixtureDef fixtureDef = MakeFixtureDef(cap2d, &circleShape, m_EntityHandle);
+				cap2d.RuntimeFixture = createFixture(fixtureDef);
+				cap2d.ClosestRigidbodyParent = rootEntity;
+				cap2d.RuntimePlacement = GetColliderPlacement(cap2d, placement);
+			}
+			else
+			{
+				b2PolygonShape boxShape;
+				boxShape.SetAsBox(radius, halfSegment, center, relativeRot.z);
+				b2FixtureDef fixtureDef = MakeFixtureDef(cap2d, &boxShape, m_EntityHandle);
+				cap2d.RuntimeFixture = createFixture(fixtureDef);
+
+				// half of each cap overlaps the box, half density keeps the total mass right
+				for (int i = 0; i < 2; i++)
+				{
+					b2CircleShape circleShape;
+					circleShape.m_p = center + (i == 0 ? halfSegment : -halfSegment) * axis;
+					circleShape.m_radius = radius;
+
+					b2FixtureDef capDef = MakeFixtureDef(cap2d, &circleShape, m_EntityHandle);
+					capDef.density *= 0.5f;
+					cap2d.RuntimeCapFixtures[i] = createFixture(capDef);
+				}
+				cap2d.ClosestRigidbodyParent = rootEntity;
+				cap2d.RuntimePlacement = GetColliderPlacement(cap2d, placement);
+			}
+		}
+
+		// Attach Edge Chain Collider
+		if (HasComponent<EdgeChainCollider2DComponent>() && !IsFixturePlaced(GetComponent<EdgeChainCollider2DComponent>(), rootEntity, placement))
+		{
+			auto& ec2d = GetComponent<EdgeChainCollider2DComponent>();
+			DestroyColliderFixture(m_Scene, ec2d.RuntimeFixture, ec2d.ClosestRigidbodyParent);
+
+			// Box2D asserts on points closer than the linear slop, drop them
+			std::vector<b2Vec2> points;
+			points.reserve(ec2d.Points.size());
+			for (const auto& point : ec2d.Points)
+			{
+				b2Vec2 p = toBody(ec2d.Offset + point);
+				if (points.empty() || b2DistanceSquared(points.back(), p) > b2_linearSlop * b2_linearSlop)
+					points.push_back(p);
+			}
+			if (ec2d.Loop && points.size() > 1 && b2DistanceSquared(points.front(), points.back()) <= b2_linearSlop * b2_linearSlop)
+				points.pop_back();
+
+			if (points.size() < (ec2d.Loop ? 3u : 2u))
+				ENGINE_LOG_WARN("Edge chain collider of '{0}' needs at least {1} distinct points, it is not attached.", GetName(), ec2d.Loop ? 3 : 2);
+			else
+			{
+				b2ChainShape chainShape;
+				const int32 count = (int32)points.size();
+				if (ec2d.Loop)
+					chainShape.CreateLoop(points.data(), count);
+				else
+				{
+					// ghost vertices continuing the end edges straight, nothing is connected to an open chain
+					b2Vec2 previous = 2.0f * points[0] - points[1];
+					b2Vec2 next = 2.0f * points[count - 1] - points[count - 2];
+					chainShape.CreateChain(points.data(), count, previous, next);
+				}
+
+				b2FixtureDef fixtureDef = MakeFixtureDef(ec2d, &chainShape, m_EntityHandle);
+				ec2d.RuntimeFixture = createFixture(fixtureDef);
+				ec2d.ClosestRigidbodyParent = rootEntity;
+				ec2d.RuntimePlacement = GetColliderPlacement(ec2d, placement);
+			}
 		}
 
     }
     
     void Entity::DetachFixturesFromRigidbodyParent()
     {
-        // destroy box collider
         if (HasComponent<BoxCollider2DComponent>())
         {
             auto& bc2d = GetComponent<BoxCollider2DComponent>();
-            if (bc2d.ClosestRigidbodyParent != entt::null)
-            {
-                Entity oldRigidbodyParent = { bc2d.ClosestRigidbodyParent, m_Scene };
-                b2Body* body = (b2Body*)oldRigidbodyParent.GetComponent<Rigidbody2DComponent>().RuntimeBody;
-                body->DestroyFixture((b2Fixture*)bc2d.RuntimeFixture);
-                bc2d.RuntimeFixture = nullptr;
-            }
+            DestroyColliderFixture(m_Scene, bc2d.RuntimeFixture, bc2d.ClosestRigidbodyParent);
         }
 
-        // destroy circle collider
         if (HasComponent<CircleCollider2DComponent>())
         {
             auto& cc2d = GetComponent<CircleCollider2DComponent>();
-            if (cc2d.ClosestRigidbodyParent != entt::null)
-            {
-                Entity oldRigidbodyParent = { cc2d.ClosestRigidbodyParent, m_Scene };
-                b2Body* body = (b2Body*)oldRigidbodyParent.GetComponent<Rigidbody2DComponent>().RuntimeBody;
-                body->DestroyFixture((b2Fixture*)cc2d.RuntimeFixture);
-                cc2d.RuntimeFixture = nullptr;
-            }
+            DestroyColliderFixture(m_Scene, cc2d.RuntimeFixture, cc2d.ClosestRigidbodyParent);
+        }
+
+        if (HasComponent<PolygonCollider2DComponent>())
+        {
+            auto& pc2d = GetComponent<PolygonCollider2DComponent>();
+            DestroyColliderFixture(m_Scene, pc2d.RuntimeFixture, pc2d.ClosestRigidbodyParent);
+        }
+
+        if (HasComponent<CapsuleCollider2DComponent>())
+        {
+            auto& cap2d = GetComponent<CapsuleCollider2DComponent>();
+            DestroyColliderFixture(m_Scene, cap2d.RuntimeFixture, cap2d.ClosestRigidbodyParent);
+            DestroyColliderFixture(m_Scene, cap2d.RuntimeCapFixtures[0], cap2d.ClosestRigidbodyParent);
+            DestroyColliderFixture(m_Scene, cap2d.RuntimeCapFixtures[1], cap2d.ClosestRigidbodyParent);
+        }
+
+        if (HasComponent<EdgeChainCollider2DComponent>())
+        {
+            auto& ec2d = GetComponent<EdgeChainCollider2DComponent>();
+            DestroyColliderFixture(m_Scene, ec2d.RuntimeFixture, ec2d.ClosestRigidbodyParent);
         }
     }
 
@@ -307,6 +521,21 @@ namespace Engine {
 				// 1. Log to Terminal (Standard)
 				ENGINE_LOG_ERROR("Script Runtime Error: {0}", errorMsg);
 			}
+
+			// OnCreate may have created scripted entities and moved the component, 'sc' is stale from here on
+			auto& script = m_Scene->m_Registry.get<ScriptComponent>(m_EntityHandle);
+
+			// Resolve the callbacks once, updates run every step and contacts can fire hundreds of times per frame.
+			// Done after OnCreate so callbacks assigned there are picked up too.
+			script.OnUpdate = script.Instance["OnUpdate"];
+			script.OnCollisionBegin = script.Instance["OnCollisionBegin"];
+			script.OnCollisionEnd = script.Instance["OnCollisionEnd"];
+			script.OnDestroy = script.Instance["OnDestroy"];
+
+			// Update schedule declared by the script class, every step by default. Scripts without OnUpdate are never scheduled.
+			script.RuntimeSchedule = script.Instance["Schedule"].get_or(ScriptComponent::UpdateSchedule::EveryStep);
+			script.RuntimeUpdateInterval = std::max(script.Instance["UpdateInterval"].get_or(0.0f), 0.0f);
+			m_Scene->ScheduleScript(*this);
 		}
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Scene.h"
 #include "Components.h"
+#include "SceneSnapshot.h"
 
 #include "entt.hpp"
 
@@ -30,6 +31,15 @@ namespace Engine {
 		template<typename T, typename... Args>
 		T& AddOrReplaceComponent(Args&&... args)
 		{
+			// the replaced value has to be tracked before it is overwritten
+			if (m_Scene->m_Snapshot && HasComponent<T>())
+				m_Scene->m_Snapshot->Track<T>(m_EntityHandle, m_Scene->m_Registry.get<T>(m_EntityHandle));
+			// like SetName, on_update puts the entity back in the tag index under the new tag
+			if constexpr (std::is_same_v<T, TagComponent>)
+			{
+				if (HasComponent<TagComponent>())
+					m_Scene->RemoveFromTagIndex(m_EntityHandle, m_Scene->m_Registry.get<TagComponent>(m_EntityHandle).Tag);
+			}
 			T& component = m_Scene->m_Registry.emplace_or_replace<T>(m_EntityHandle, std::forward<Args>(args)...);
 			m_Scene->OnComponentAdded<T>(*this, component);
 			return component;
@@ -40,7 +50,11 @@ namespace Engine {
 		T& GetComponent()
 		{
 			ASSERT(HasComponent<T>(), "Entity does not have component!");
-			return m_Scene->m_Registry.get<T>(m_EntityHandle);
+			T& component = m_Scene->m_Registry.get<T>(m_EntityHandle);
+			// while playing, keep the original value the first time it is handed out so it can be restored on stop
+			if (m_Scene->m_Snapshot)
+				m_Scene->m_Snapshot->Track<T>(m_EntityHandle, component);
+			return component;
 		}
 
 		template<typename T>
@@ -62,6 +76,7 @@ namespace Engine {
 
 		UUID GetUUID() { return GetComponent<IDComponent>().ID; }
 		const std::string& GetName() { return GetComponent<TagComponent>().Tag; }
+		void SetName(const std::string& name);
 
 		bool operator==(const Entity& other) const
 		{
@@ -74,7 +89,10 @@ namespace Engine {
 		}
 
 		Entity ClosestRigidbodyParent();
-		bool isEnabled() { return !this->HasComponent<DisabledComponent>(); }
+		// enabled itself and all its parents are enabled
+		bool isEnabled() { return m_Scene->m_Registry.get<TransformComponent>(m_EntityHandle).ActiveInHierarchy; }
+		// own state, regardless of the parents
+		bool isSelfEnabled() { return m_Scene->m_Registry.get<TransformComponent>(m_EntityHandle).Enabled; }
 		void setEnabled(bool enable);
 		void AttachFixturesToRigidbodyParent();
 		void DetachFixturesFromRigidbodyParent();
@@ -85,6 +103,8 @@ namespace Engine {
 	private:
 		entt::entity m_EntityHandle{ entt::null };
 		Scene* m_Scene = nullptr;
+
+	friend class Hierarchy;
 	};
 
 }
\ No newline at end of file
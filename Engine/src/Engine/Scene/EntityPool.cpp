@@ -0,0 +1,249 @@
+#include "egpch.h"
+#include "EntityPool.h"
+
+#include "Engine/Utils/Math.h"
+
+#include "box2d/b2_body.h"
+
+namespace Engine {
+
+	// Puts the prefab's value back, only for components that carry no runtime handles
+	template<typename Component>
+	static void ResetComponentIfExists(Entity dst, entt::registry& src, entt::entity srcHandle)
+	{
+		if (dst.HasComponent<Component>() && src.has<Component>(srcHandle))
+			dst.GetComponent<Component>() = src.get<Component>(srcHandle);
+	}
+
+	// Puts the prefab's settings back on a collider of a free instance. Its fixtures were detached when the instance
+	// was disabled and are rebuilt from these settings when it is enabled, only the runtime links are kept.
+	template<typename Collider>
+	static void ResetColliderIfExists(Entity dst, entt::registry& src, entt::entity srcHandle)
+	{
+		if (!dst.HasComponent<Collider>() || !src.has<Collider>(srcHandle))
+			return;
+
+		auto& collider = dst.GetComponent<Collider>();
+		void* fixture = collider.RuntimeFixture;
+		entt::entity rigidbodyParent = collider.ClosestRigidbodyParent;
+		ColliderPlacement placement = collider.RuntimePlacement;
+		void* capFixtures[2] = {};
+		if constexpr (std::is_same_v<Collider, CapsuleCollider2DComponent>)
+		{
+			capFixtures[0] = collider.RuntimeCapFixtures[0];
+			capFixtures[1] = collider.RuntimeCapFixtures[1];
+		}
+
+		// assigned in place, vertex and point vectors keep their capacity
+		collider = src.get<Collider>(srcHandle);
+		collider.RuntimeFixture = fixture;
+		collider.ClosestRigidbodyParent = rigidbodyParent;
+		collider.RuntimePlacement = placement;
+		if constexpr (std::is_same_v<Collider, CapsuleCollider2DComponent>)
+		{
+			collider.RuntimeCapFixtures[0] = capFixtures[0];
+			collider.RuntimeCapFixtures[1] = capFixtures[1];
+		}
+	}
+
+	// same mapping as Rigidbody2DTypeToBox2DBody
+	static uint8_t ToBox2DBodyType(Rigidbody2DComponent::BodyType bodyType)
+	{
+		switch (bodyType)
+		{
+		case Rigidbody2DComponent::BodyType::Static:    return (uint8_t)b2_staticBody;
+		case Rigidbody2DComponent::BodyType::Dynamic:   return (uint8_t)b2_dynamicBody;
+		case Rigidbody2DComponent::BodyType::Kinematic: return (uint8_t)b2_kinematicBody;
+		}
+
+		ASSERT(false, "Unknown body type");
+		return (uint8_t)b2_staticBody;
+	}
+
+	EntityPool::EntityPool(Scene* scene, const std::shared_ptr<Prefab>& prefab, uint32_t capacity, Entity parent)
+		: m_Scene(scene), m_Prefab(prefab), m_Capacity(capacity)
+	{
+		ASSERT(prefab, "Cannot create a pool from a null prefab.");
+
+		m_Entities = m_Scene->InstantiatePrefabEntities(*m_Prefab, m_Capacity, parent);
+
+		// nothing has touched the bodies yet, the first instance has the settings every instance starts with
+		const size_t nodeCount = m_Prefab->m_Nodes.size();
+		m_BodySettings.resize(nodeCount);
+		for (size_t n = 0; n < nodeCount && m_Capacity > 0; n++)
+		{
+			auto* rb2d = m_Scene->m_Registry.try_get<Rigidbody2DComponent>(m_Entities[n * m_Capacity]);
+			const b2Body* body = rb2d ? static_cast<const b2Body*>(rb2d->RuntimeBody) : nullptr;
+			if (body)
+				m_BodySettings[n] = { body->GetGravityScale(), body->GetLinearDamping(), body->GetAngularDamping() };
+		}
+
+		m_Free.reserve(m_Capacity);
+		m_InUse.assign(m_Capacity, false);
+		m_RootIndices.reserve(m_Capacity);
+		// reversed, so instances are handed out in creation order
+		for (uint32_t i = m_Capacity; i-- > 0;)
+		{
+			Entity root = { m_Entities[i], m_Scene };
+			root.setEnabled(false);
+			m_Free.push_back(i);
+			m_RootIndices[root] = i;
+		}
+	}
+
+	std::shared_ptr<EntityPool> EntityPool::Create(Scene* scene, const std::shared_ptr<Prefab>& prefab, uint32_t capacity, Entity parent)
+	{
+		return std::make_shared<EntityPool>(scene, prefab, capacity, parent);
+	}
+
+	Entity EntityPool::Acquire()
+	{
+		while (!m_Free.empty())
+		{
+			uint32_t instance = m_Free.back();
+			m_Free.pop_back();
+
+			// instances destroyed by scripts are simply dropped from the pool
+			Entity root = { m_Entities[instance], m_Scene };
+			if (!root)
+				continue;
+
+			ResetInstance(instance);
+			m_InUse[instance] = true;
+			root.setEnabled(true);
+
+			// bodies keep their state while disabled, give them the reset settings and transform and stop them
+			const size_t nodeCount = m_Prefab->m_Nodes.size();
+			for (size_t n = 0; n < nodeCount; n++)
+			{
+				Entity entity = { m_Entities[n * m_Capacity + instance], m_Scene };
+				if (!entity || !entity.HasComponent<Rigidbody2DComponent>())
+					continue;
+
+				const auto& rb2d = entity.GetComponent<Rigidbody2DComponent>();
+				b2Body* body = static_cast<b2Body*>(rb2d.RuntimeBody);
+				if (!body)
+					continue;
+
+				PhysicsRecorder& recorder = m_Scene->GetPhysicsRecorder();
+				// scripts may have changed these on the previous user, back to what the instance started with
+				const BodySettings& settings = m_BodySettings[n];
+				recorder.ApplyBodyCommand(body, BodyCommand::SetType(ToBox2DBodyType(rb2d.Type)));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetFixedRotation(rb2d.FixedRotation));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetGravityScale(settings.GravityScale));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetLinearDamping(settings.LinearDamping));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetAngularDamping(settings.AngularDamping));
+
+				glm::vec3 translation, rotation, scale;
+				if (Math::DecomposeTransform(entity.GetComponent<TransformComponent>().GlobalTransform, translation, rotation, scale))
+					recorder.ApplyBodyCommand(body, BodyCommand::SetTransform({ translation.x, translation.y }, rotation.z));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetLinearVelocity({ 0.0f, 0.0f }));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetAngularVelocity(0.0f));
+				recorder.ApplyBodyCommand(body, BodyCommand::SetAwake(true));
+			}
+
+			// Lua fields are the script's own, OnAcquire(self) resets them. Recreating the instance would allocate on every acquire.
+			for (size_t n = 0; n < nodeCount; n++)
+			{
+				Entity entity = { m_Entities[n * m_Capacity + instance], m_Scene };
+				if (!entity || !entity.HasComponent<ScriptComponent>())
+					continue;
+
+				sol::table instanceTable = entity.GetComponent<ScriptComponent>().Instance;
+				if (!instanceTable.valid())
+					continue;
+
+				// copied, the script may add scripts and move the component
+				sol::protected_function onAcquire = instanceTable["OnAcquire"];
+				if (!onAcquire.valid())
+					continue;
+
+				sol::protected_function_result result = onAcquire(instanceTable);
+				if (!result.valid())
+				{
+					sol::error err = result;
+					ENGINE_LOG_ERROR("Script Error in OnAcquire: {0}", err.what());
+				}
+			}
+			return root;
+		}
+
+		ENGINE_LOG_WARN("Entity pool of '{0}' is exhausted ({1} instances in use).", m_Prefab->GetName(), m_Capacity);
+		return {};
+	}
+
+	void EntityPool::Release(Entity entity)
+	{
+		auto it = m_RootIndices.find(entity);
+		if (it == m_RootIndices.end() || !entity.BelongsToScene(m_Scene))
+		{
+			ENGINE_LOG_WARN("Entity {0} does not belong to the pool of '{1}'.", (uint32_t)entity, m_Prefab->GetName());
+			return;
+		}
+
+		uint32_t instance = it->second;
+		if (!m_InUse[instance])
+			return;
+
+		if (entity)
+			entity.setEnabled(false);
+		m_InUse[instance] = false;
+		m_Free.push_back(instance);
+	}
+
+	void EntityPool::ReleaseAll()
+	{
+		for (uint32_t i = 0; i < m_Capacity; i++)
+		{
+			if (m_InUse[i])
+				Release(Entity{ m_Entities[i], m_Scene });
+		}
+	}
+
+	void EntityPool::ResetInstance(uint32_t instance)
+	{
+		auto& srcRegistry = m_Prefab->m_Scene->m_Registry;
+		const auto& nodes = m_Prefab->m_Nodes;
+
+		for (size_t n = 0; n < nodes.size(); n++)
+		{
+			Entity entity = { m_Entities[n * m_Capacity + instance], m_Scene };
+			if (!entity)
+				continue;
+
+			entt::entity src = nodes[n].Handle;
+
+			// local values only, the instance is still disabled and the root's enabled state is managed by the pool
+			auto& transform = entity.GetComponent<TransformComponent>();
+			const auto& srcTransform = srcRegistry.get<TransformComponent>(src);
+			transform.Translation = srcTransform.Translation;
+			transform.Rotation = srcTransform.Rotation;
+			transform.Scale = srcTransform.Scale;
+			if (n > 0)
+				transform.Enabled = srcTransform.Enabled;
+
+			ResetComponentIfExists<SpriteRendererComponent>(entity, srcRegistry, src);
+			ResetComponentIfExists<CircleRendererComponent>(entity, srcRegistry, src);
+			ResetComponentIfExists<TextComponent>(entity, srcRegistry, src);
+			ResetComponentIfExists<CameraComponent>(entity, srcRegistry, src);
+			// assigning an emitter drops its live particles and keeps the buffers
+			ResetComponentIfExists<ParticleEmitterComponent>(entity, srcRegistry, src);
+
+			if (entity.HasComponent<Rigidbody2DComponent>() && srcRegistry.has<Rigidbody2DComponent>(src))
+			{
+				// settings only, Acquire pushes them to the body
+				auto& rb2d = entity.GetComponent<Rigidbody2DComponent>();
+				const auto& srcRb2d = srcRegistry.get<Rigidbody2DComponent>(src);
+				rb2d.Type = srcRb2d.Type;
+				rb2d.FixedRotation = srcRb2d.FixedRotation;
+			}
+
+			ResetColliderIfExists<BoxCollider2DComponent>(entity, srcRegistry, src);
+			ResetColliderIfExists<CircleCollider2DComponent>(entity, srcRegistry, src);
+			ResetColliderIfExists<PolygonCollider2DComponent>(entity, srcRegistry, src);
+			ResetColliderIfExists<CapsuleCollider2DComponent>(entity, srcRegistry, src);
+			ResetColliderIfExists<EdgeChainCollider2DComponent>(entity, srcRegistry, src);
+		}
+	}
+
+}
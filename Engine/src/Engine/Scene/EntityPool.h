@@ -0,0 +1,60 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Scene.h"
+#include "Entity.h"
+#include "Prefab.h"
+
+namespace Engine {
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// EntityPool ///////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Fixed number of prefab instances created up front. Free instances are disabled, so every system skips them.
+	// Acquire hands out a free instance with its components reset to the prefab's values and calls OnAcquire(self) on its
+	// scripts so they can reset their own fields, Release gives it back.
+	class EntityPool
+	{
+	public:
+		EntityPool(Scene* scene, const std::shared_ptr<Prefab>& prefab, uint32_t capacity, Entity parent);
+
+		static std::shared_ptr<EntityPool> Create(Scene* scene, const std::shared_ptr<Prefab>& prefab, uint32_t capacity, Entity parent = {});
+
+		// Enabled root of a free instance, or a null entity if all of them are in use
+		Entity Acquire();
+		void Release(Entity entity);
+		void ReleaseAll();
+
+		uint32_t GetCapacity() const { return m_Capacity; }
+		uint32_t GetActiveCount() const { return m_Capacity - (uint32_t)m_Free.size(); }
+
+	private:
+		void ResetInstance(uint32_t instance);
+
+	private:
+		Scene* m_Scene = nullptr;
+		std::shared_ptr<Prefab> m_Prefab;
+		uint32_t m_Capacity = 0;
+
+		// every entity of every instance, node major like Scene::InstantiatePrefab creates them. the first m_Capacity are the roots.
+		std::vector<entt::entity> m_Entities;
+		// free instance indices, used as a stack so the most recently released (warm) instance is reused first
+		std::vector<uint32_t> m_Free;
+		std::vector<bool> m_InUse;
+		std::unordered_map<entt::entity, uint32_t> m_RootIndices;
+
+		// Body settings Box2D keeps outside the component, per prefab node. Taken from the first instance's bodies
+		// when the pool is built, Acquire puts them back on the bodies scripts changed.
+		struct BodySettings
+		{
+			float GravityScale = 1.0f;
+			float LinearDamping = 0.0f;
+			float AngularDamping = 0.0f;
+		};
+		std::vector<BodySettings> m_BodySettings;
+	};
+
+}
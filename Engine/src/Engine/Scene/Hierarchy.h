@@ -0,0 +1,99 @@
+#pragma once
+
+#include <type_traits>
+
+#include "Entity.h"
+#include "Components.h"
+
+namespace Engine {
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Hierarchy ////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Non recursive walks over the RelationshipComponent tree. They follow the FirstChild/NextSibling/Parent links
+	// directly, so the depth of a hierarchy is not limited by the call stack and no extra memory is needed.
+	class Hierarchy
+	{
+	public:
+		// Visits 'root' and all its descendants. 'enter' is called before the children of an entity,
+		// returning false from it skips them. 'leave' is called after the children of every entered entity.
+		// The links of an entity are read after 'enter' and before 'leave', so 'enter' may add children
+		// and 'leave' may destroy the entity it is given.
+		template<typename EnterFunc, typename LeaveFunc>
+		static void Traverse(Entity root, EnterFunc&& enter, LeaveFunc&& leave)
+		{
+			Scene* scene = root.m_Scene;
+			entt::registry& registry = scene->m_Registry;
+
+			entt::entity current = root;
+			while (true)
+			{
+				bool entered = Enter(enter, Entity{ current, scene });
+				if (entered)
+				{
+					entt::entity child = registry.get<RelationshipComponent>(current).FirstChild;
+					if (child != entt::null)
+					{
+						current = child;
+						continue;
+					}
+				}
+
+				// 'current' is done, climb until there is a sibling to visit. Every parent on the way up was entered.
+				bool leaveCurrent = entered;
+				while (true)
+				{
+					if (current == root)
+					{
+						if (leaveCurrent)
+							leave(Entity{ current, scene });
+						return;
+					}
+
+					const auto& relation = registry.get<RelationshipComponent>(current);
+					entt::entity next = relation.NextSibling;
+					entt::entity parent = relation.Parent;
+					if (leaveCurrent)
+						leave(Entity{ current, scene });
+
+					if (next != entt::null)
+					{
+						current = next;
+						break;
+					}
+					current = parent;
+					leaveCurrent = true;
+				}
+			}
+		}
+
+		// Parents before children. 'func' may return false to skip the children of an entity.
+		template<typename Func>
+		static void ForEachPreOrder(Entity root, Func&& func)
+		{
+			Traverse(root, std::forward<Func>(func), [](Entity) {});
+		}
+
+		// Children before parents, 'func' may destroy the entity it is given
+		template<typename Func>
+		static void ForEachPostOrder(Entity root, Func&& func)
+		{
+			Traverse(root, [](Entity) { return true; }, std::forward<Func>(func));
+		}
+
+	private:
+		template<typename Func>
+		static bool Enter(Func& func, Entity entity)
+		{
+			if constexpr (std::is_same_v<std::invoke_result_t<Func&, Entity>, void>)
+			{
+				func(entity);
+				return true;
+			}
+			else
+				return func(entity);
+		}
+	};
+
+}
@@ -0,0 +1,801 @@
+#include "egpch.h"
+#include "PhysicsRecording.h"
+
+#include "Components.h"
+#include "Engine/Utils/Timer.h"
+
+#include "box2d/b2_world.h"
+#include "box2d/b2_body.h"
+#include "box2d/b2_fixture.h"
+#include "box2d/b2_contact.h"
+#include "box2d/b2_world_callbacks.h"
+#include "box2d/b2_circle_shape.h"
+#include "box2d/b2_edge_shape.h"
+#include "box2d/b2_polygon_shape.h"
+#include "box2d/b2_chain_shape.h"
+#include "box2d/b2_revolute_joint.h"
+#include "box2d/b2_distance_joint.h"
+#include "box2d/b2_prismatic_joint.h"
+#include "box2d/b2_weld_joint.h"
+#include "box2d/b2_mouse_joint.h"
+
+#include <unordered_set>
+
+namespace Engine {
+
+	static constexpr uint32_t RecordingMagic = 0x50485953; // "PHYS"
+	static constexpr uint32_t RecordingVersion = 1;
+	// the buffer is written to the file once it grows past this
+	static constexpr size_t FlushSize = 64 * 1024;
+
+	enum class RecordType : uint8_t
+	{
+		CreateBody = 0, DestroyBody, CreateFixture, DestroyFixture,
+		CreateJoint, DestroyJoint, UpdateJoint, BodyCommand,
+		Step, DisableContact, End
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Shared by the live world and the replay //////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	static void ExecuteBodyCommand(b2Body* body, const BodyCommand& command)
+	{
+		const b2Vec2 vector = b2Vec2(command.Vector.x, command.Vector.y);
+		const b2Vec2 point = b2Vec2(command.Point.x, command.Point.y);
+		switch (command.Type)
+		{
+		case BodyCommandType::SetTransform:					body->SetTransform(vector, command.Value); break;
+		case BodyCommandType::SetLinearVelocity:			body->SetLinearVelocity(vector); break;
+		case BodyCommandType::SetAngularVelocity:			body->SetAngularVelocity(command.Value); break;
+		case BodyCommandType::ApplyForce:					body->ApplyForce(vector, point, command.Flag); break;
+		case BodyCommandType::ApplyForceToCenter:			body->ApplyForceToCenter(vector, command.Flag); break;
+		case BodyCommandType::ApplyTorque:					body->ApplyTorque(command.Value, command.Flag); break;
+		case BodyCommandType::ApplyLinearImpulse:			body->ApplyLinearImpulse(vector, point, command.Flag); break;
+		case BodyCommandType::ApplyLinearImpulseToCenter:	body->ApplyLinearImpulseToCenter(vector, command.Flag); break;
+		case BodyCommandType::ApplyAngularImpulse:			body->ApplyAngularImpulse(command.Value, command.Flag); break;
+		case BodyCommandType::SetType:						body->SetType((b2BodyType)command.BodyType); break;
+		case BodyCommandType::SetFixedRotation:				body->SetFixedRotation(command.Flag); break;
+		case BodyCommandType::SetEnabled:					body->SetEnabled(command.Flag); break;
+		case BodyCommandType::SetAwake:						body->SetAwake(command.Flag); break;
+		case BodyCommandType::SetGravityScale:				body->SetGravityScale(command.Value); break;
+		case BodyCommandType::SetLinearDamping:				body->SetLinearDamping(command.Value); break;
+		case BodyCommandType::SetAngularDamping:			body->SetAngularDamping(command.Value); break;
+		}
+	}
+
+	static void ApplyJointSettings(b2Joint* joint, const Joint2DComponent& settings)
+	{
+		b2Body* bodyA = joint->GetBodyA();
+		b2Body* bodyB = joint->GetBodyB();
+		float stiffness, damping;
+		switch (settings.Type)
+		{
+		case Joint2DComponent::JointType::Revolute:
+		{
+			b2RevoluteJoint* revolute = (b2RevoluteJoint*)joint;
+			revolute->EnableLimit(settings.EnableLimit);
+			revolute->SetLimits(settings.LowerLimit, std::max(settings.LowerLimit, settings.UpperLimit));
+			revolute->EnableMotor(settings.EnableMotor);
+			revolute->SetMotorSpeed(settings.MotorSpeed);
+			revolute->SetMaxMotorTorque(settings.MaxMotorForce);
+			break;
+		}
+		case Joint2DComponent::JointType::Distance:
+		{
+			// automatic lengths were resolved when the joint was created
+			b2DistanceJoint* distance = (b2DistanceJoint*)joint;
+			if (settings.Length >= 0.0f)
+				distance->SetLength(settings.Length);
+			distance->SetMinLength(settings.MinLength >= 0.0f ? settings.MinLength : distance->GetLength());
+			distance->SetMaxLength(settings.MaxLength >= 0.0f ? settings.MaxLength : distance->GetLength());
+			b2LinearStiffness(stiffness, damping, settings.Frequency, settings.DampingRatio, bodyA, bodyB);
+			distance->SetStiffness(stiffness);
+			distance->SetDamping(damping);
+			break;
+		}
+		case Joint2DComponent::JointType::Prismatic:
+		{
+			b2PrismaticJoint* prismatic = (b2PrismaticJoint*)joint;
+			prismatic->EnableLimit(settings.EnableLimit);
+			prismatic->SetLimits(settings.LowerLimit, std::max(settings.LowerLimit, settings.UpperLimit));
+			prismatic->EnableMotor(settings.EnableMotor);
+			prismatic->SetMotorSpeed(settings.MotorSpeed);
+			prismatic->SetMaxMotorForce(settings.MaxMotorForce);
+			break;
+		}
+		case Joint2DComponent::JointType::Weld:
+		{
+			b2WeldJoint* weld = (b2WeldJoint*)joint;
+			b2AngularStiffness(stiffness, damping, settings.Frequency, settings.DampingRatio, bodyA, bodyB);
+			weld->SetStiffness(stiffness);
+			weld->SetDamping(damping);
+			break;
+		}
+		case Joint2DComponent::JointType::Mouse:
+		{
+			b2MouseJoint* mouse = (b2MouseJoint*)joint;
+			mouse->SetTarget(b2Vec2(settings.Target.x, settings.Target.y));
+			mouse->SetMaxForce(settings.MaxForce);
+			b2LinearStiffness(stiffness, damping, settings.Frequency > 0.0f ? settings.Frequency : 5.0f, settings.DampingRatio, bodyA, bodyB);
+			mouse->SetStiffness(stiffness);
+			mouse->SetDamping(damping);
+			break;
+		}
+		}
+
+		// a sleeping body would not notice the new motor or target
+		bodyA->SetAwake(true);
+		bodyB->SetAwake(true);
+	}
+
+	static size_t GetJointDefSize(b2JointType type)
+	{
+		switch (type)
+		{
+		case e_revoluteJoint:	return sizeof(b2RevoluteJointDef);
+		case e_distanceJoint:	return sizeof(b2DistanceJointDef);
+		case e_prismaticJoint:	return sizeof(b2PrismaticJointDef);
+		case e_weldJoint:		return sizeof(b2WeldJointDef);
+		case e_mouseJoint:		return sizeof(b2MouseJointDef);
+		}
+		return 0;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// PhysicsRecorder //////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	PhysicsRecorder::~PhysicsRecorder()
+	{
+		// a recording that was never stopped has no final state, the replay reports it as not loaded
+		if (IsRecording())
+		{
+			Flush();
+			m_File.close();
+		}
+	}
+
+	bool PhysicsRecorder::Start(const std::filesystem::path& path, const glm::vec2& gravity)
+	{
+		ASSERT(!IsRecording(), "Physics recording already started.");
+
+		if (path.has_parent_path())
+			std::filesystem::create_directories(path.parent_path());
+		m_File.open(path, std::ios::binary | std::ios::trunc);
+		if (!m_File)
+		{
+			ENGINE_LOG_ERROR("Could not open physics recording '{0}'.", path.string());
+			return false;
+		}
+
+		m_Buffer.clear();
+		m_IDs.clear();
+		m_BodyCount = m_FixtureCount = m_JointCount = 0;
+		m_PreSolveIndex = 0;
+
+		Write(RecordingMagic);
+		Write(RecordingVersion);
+		Write(gravity);
+		return true;
+	}
+
+	void PhysicsRecorder::Stop(b2World* world)
+	{
+		if (!IsRecording())
+			return;
+
+		Write(RecordType::End);
+		Write((uint32_t)world->GetBodyCount());
+		for (b2Body* body = world->GetBodyList(); body; body = body->GetNext())
+		{
+			Write(GetID(body));
+			Write(body->GetPosition());
+			Write(body->GetAngle());
+			Write(body->GetLinearVelocity());
+			Write(body->GetAngularVelocity());
+			Write((uint8_t)body->IsAwake());
+		}
+
+		Flush();
+		m_File.close();
+		m_IDs.clear();
+	}
+
+	b2Body* PhysicsRecorder::CreateBody(b2World* world, const b2BodyDef& def)
+	{
+		b2Body* body = world->CreateBody(&def);
+		if (!IsRecording())
+			return body;
+
+		m_IDs[body] = m_BodyCount++;
+		Write(RecordType::CreateBody);
+		Write((uint8_t)def.type);
+		Write(def.position);
+		Write(def.angle);
+		Write(def.linearVelocity);
+		Write(def.angularVelocity);
+		Write(def.linearDamping);
+		Write(def.angularDamping);
+		Write(def.gravityScale);
+		Write((uint8_t)def.allowSleep);
+		Write((uint8_t)def.awake);
+		Write((uint8_t)def.fixedRotation);
+		Write((uint8_t)def.bullet);
+		Write((uint8_t)def.enabled);
+		return body;
+	}
+
+	void PhysicsRecorder::DestroyBody(b2World* world, b2Body* body)
+	{
+		if (IsRecording())
+		{
+			Write(RecordType::DestroyBody);
+			Write(GetID(body));
+			m_IDs.erase(body);
+		}
+		world->DestroyBody(body);
+	}
+
+	b2Fixture* PhysicsRecorder::CreateFixture(b2Body* body, const b2FixtureDef& def)
+	{
+		b2Fixture* fixture = body->CreateFixture(&def);
+		if (!IsRecording())
+			return fixture;
+
+		m_IDs[fixture] = m_FixtureCount++;
+		Write(RecordType::CreateFixture);
+		Write(GetID(body));
+		Write(def.friction);
+		Write(def.restitution);
+		Write(def.restitutionThreshold);
+		Write(def.density);
+		Write((uint8_t)def.isSensor);
+		Write(def.filter);
+
+		// the shape as Box2D stored it, rebuilding it from the same points could still round differently
+		const b2Shape* shape = def.shape;
+		Write((uint8_t)shape->m_type);
+		Write(shape->m_radius);
+		switch (shape->m_type)
+		{
+		case b2Shape::e_circle:
+		{
+			const b2CircleShape* circle = (const b2CircleShape*)shape;
+			Write(circle->m_p);
+			break;
+		}
+		case b2Shape::e_edge:
+		{
+			const b2EdgeShape* edge = (const b2EdgeShape*)shape;
+			Write(edge->m_vertex0);
+			Write(edge->m_vertex1);
+			Write(edge->m_vertex2);
+			Write(edge->m_vertex3);
+			Write((uint8_t)edge->m_oneSided);
+			break;
+		}
+		case b2Shape::e_polygon:
+		{
+			const b2PolygonShape* polygon = (const b2PolygonShape*)shape;
+			Write(polygon->m_count);
+			Write(polygon->m_centroid);
+			WriteBytes(polygon->m_vertices, sizeof(b2Vec2) * polygon->m_count);
+			WriteBytes(polygon->m_normals, sizeof(b2Vec2) * polygon->m_count);
+			break;
+		}
+		case b2Shape::e_chain:
+		{
+			const b2ChainShape* chain = (const b2ChainShape*)shape;
+			Write(chain->m_count);
+			WriteBytes(chain->m_vertices, sizeof(b2Vec2) * chain->m_count);
+			Write(chain->m_prevVertex);
+			Write(chain->m_nextVertex);
+			break;
+		}
+		default:
+			ASSERT(false, "Unknown shape type.");
+			break;
+		}
+		return fixture;
+	}
+
+	void PhysicsRecorder::DestroyFixture(b2Fixture* fixture)
+	{
+		if (IsRecording())
+		{
+			Write(RecordType::DestroyFixture);
+			Write(GetID(fixture));
+			m_IDs.erase(fixture);
+		}
+		fixture->GetBody()->DestroyFixture(fixture);
+	}
+
+	b2Joint* PhysicsRecorder::CreateJoint(b2World* world, const b2JointDef& def)
+	{
+		b2Joint* joint = world->CreateJoint(&def);
+		if (!IsRecording())
+			return joint;
+
+		const size_t size = GetJointDefSize(def.type);
+		ASSERT(size > 0, "Joint type cannot be recorded.");
+
+		m_IDs[joint] = m_JointCount++;
+		Write(RecordType::CreateJoint);
+		Write((uint8_t)def.type);
+		Write(GetID(def.bodyA));
+		Write(GetID(def.bodyB));
+		// the typed definition as is, the body pointers in it are replaced on replay
+		Write((uint32_t)size);
+		WriteBytes(&def, size);
+		return joint;
+	}
+
+	void PhysicsRecorder::DestroyJoint(b2World* world, b2Joint* joint)
+	{
+		if (IsRecording())
+		{
+			Write(RecordType::DestroyJoint);
+			Write(GetID(joint));
+			m_IDs.erase(joint);
+		}
+		world->DestroyJoint(joint);
+	}
+
+	void PhysicsRecorder::UpdateJoint(b2Joint* joint, const Joint2DComponent& settings)
+	{
+		if (IsRecording())
+		{
+			Write(RecordType::UpdateJoint);
+			Write(GetID(joint));
+			Write((uint8_t)settings.Type);
+			Write((uint8_t)settings.EnableLimit);
+			Write(settings.LowerLimit);
+			Write(settings.UpperLimit);
+			Write((uint8_t)settings.EnableMotor);
+			Write(settings.MotorSpeed);
+			Write(settings.MaxMotorForce);
+			Write(settings.Length);
+			Write(settings.MinLength);
+			Write(settings.MaxLength);
+			Write(settings.Frequency);
+			Write(settings.DampingRatio);
+			Write(settings.Target);
+			Write(settings.MaxForce);
+		}
+		ApplyJointSettings(joint, settings);
+	}
+
+	void PhysicsRecorder::ApplyBodyCommand(b2Body* body, const BodyCommand& command)
+	{
+		if (IsRecording())
+		{
+			Write(RecordType::BodyCommand);
+			Write(GetID(body));
+			Write(command);
+		}
+		ExecuteBodyCommand(body, command);
+	}
+
+	void PhysicsRecorder::Step(b2World* world, float ts, int32_t velocityIterations, int32_t positionIterations)
+	{
+		if (IsRecording())
+		{
+			// contacts disabled during the step are written after it
+			Write(RecordType::Step);
+			Write(ts);
+			Write(velocityIterations);
+			Write(positionIterations);
+			m_PreSolveIndex = 0;
+		}
+		world->Step(ts, velocityIterations, positionIterations);
+
+		if (m_Buffer.size() >= FlushSize)
+			Flush();
+	}
+
+	void PhysicsRecorder::OnPreSolve(b2Contact* contact)
+	{
+		if (!IsRecording())
+			return;
+
+		// contacts are visited in the same order on replay, their index in the step identifies them
+		if (!contact->IsEnabled())
+		{
+			Write(RecordType::DisableContact);
+			Write(m_PreSolveIndex);
+		}
+		m_PreSolveIndex++;
+	}
+
+	template<typename T>
+	void PhysicsRecorder::Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only plain data can be recorded.");
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void PhysicsRecorder::WriteBytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		m_Buffer.insert(m_Buffer.end(), bytes, bytes + size);
+	}
+
+	void PhysicsRecorder::Flush()
+	{
+		m_File.write((const char*)m_Buffer.data(), m_Buffer.size());
+		m_Buffer.clear();
+	}
+
+	uint32_t PhysicsRecorder::GetID(const void* object) const
+	{
+		auto it = m_IDs.find(object);
+		ASSERT(it != m_IDs.end(), "Physics object was created before the recording started.");
+		return it->second;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// PhysicsReplay ////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	class RecordingReader
+	{
+	public:
+		RecordingReader(std::vector<uint8_t>&& data)
+			: m_Data(std::move(data))
+		{
+		}
+
+		template<typename T>
+		T Read()
+		{
+			T value{};
+			ReadBytes(&value, sizeof(T));
+			return value;
+		}
+
+		void ReadBytes(void* data, size_t size)
+		{
+			if (m_Position + size > m_Data.size())
+			{
+				m_Failed = true;
+				return;
+			}
+			memcpy(data, m_Data.data() + m_Position, size);
+			m_Position += size;
+		}
+
+		// the next record type, without consuming it
+		bool Peek(RecordType& type) const
+		{
+			if (m_Position >= m_Data.size())
+				return false;
+			type = (RecordType)m_Data[m_Position];
+			return true;
+		}
+
+		bool AtEnd() const { return m_Position >= m_Data.size(); }
+		bool Failed() const { return m_Failed; }
+
+	private:
+		std::vector<uint8_t> m_Data;
+		size_t m_Position = 0;
+		bool m_Failed = false;
+	};
+
+	// Disables the contacts the recording disabled, by their PreSolve index within the step
+	class ReplayContactListener : public b2ContactListener
+	{
+	public:
+		void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override
+		{
+			if (m_Disabled.count(m_Index++))
+				contact->SetEnabled(false);
+		}
+
+		std::unordered_set<uint32_t>& BeginStep()
+		{
+			m_Index = 0;
+			m_Disabled.clear();
+			return m_Disabled;
+		}
+
+	private:
+		std::unordered_set<uint32_t> m_Disabled;
+		uint32_t m_Index = 0;
+	};
+
+	PhysicsReplay::Result PhysicsReplay::Run(const std::filesystem::path& path)
+	{
+		Result result;
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			ENGINE_LOG_ERROR("Could not open physics recording '{0}'.", path.string());
+			return result;
+		}
+		std::vector<uint8_t> data((size_t)file.tellg());
+		file.seekg(0);
+		file.read((char*)data.data(), data.size());
+
+		RecordingReader reader(std::move(data));
+		if (reader.Read<uint32_t>() != RecordingMagic || reader.Read<uint32_t>() != RecordingVersion)
+		{
+			ENGINE_LOG_ERROR("'{0}' is not a physics recording of this version.", path.string());
+			return result;
+		}
+
+		glm::vec2 gravity = reader.Read<glm::vec2>();
+		b2World world(b2Vec2(gravity.x, gravity.y));
+		ReplayContactListener listener;
+		world.SetContactListener(&listener);
+
+		// indexed by recorded id. Objects Box2D destroys implicitly (fixtures and joints of a destroyed body)
+		// stay in here dangling, the recording never refers to them again.
+		std::vector<b2Body*> bodies;
+		std::vector<b2Fixture*> fixtures;
+		std::vector<b2Joint*> joints;
+		auto lookup = [&](auto& objects) {
+			uint32_t id = reader.Read<uint32_t>();
+			if (id >= objects.size() || !objects[id])
+			{
+				ENGINE_LOG_ERROR("Physics recording refers to an unknown object {0}.", id);
+				return (typename std::decay_t<decltype(objects)>::value_type)nullptr;
+			}
+			return objects[id];
+		};
+
+		Timer timer;
+		bool ended = false;
+		while (!ended && !reader.AtEnd() && !reader.Failed())
+		{
+			RecordType type = reader.Read<RecordType>();
+			switch (type)
+			{
+			case RecordType::CreateBody:
+			{
+				b2BodyDef def;
+				def.type = (b2BodyType)reader.Read<uint8_t>();
+				def.position = reader.Read<b2Vec2>();
+				def.angle = reader.Read<float>();
+				def.linearVelocity = reader.Read<b2Vec2>();
+				def.angularVelocity = reader.Read<float>();
+				def.linearDamping = reader.Read<float>();
+				def.angularDamping = reader.Read<float>();
+				def.gravityScale = reader.Read<float>();
+				def.allowSleep = reader.Read<uint8_t>();
+				def.awake = reader.Read<uint8_t>();
+				def.fixedRotation = reader.Read<uint8_t>();
+				def.bullet = reader.Read<uint8_t>();
+				def.enabled = reader.Read<uint8_t>();
+				bodies.push_back(world.CreateBody(&def));
+				break;
+			}
+			case RecordType::DestroyBody:
+			{
+				uint32_t id = reader.Read<uint32_t>();
+				if (id < bodies.size() && bodies[id])
+				{
+					world.DestroyBody(bodies[id]);
+					bodies[id] = nullptr;
+				}
+				break;
+			}
+			case RecordType::CreateFixture:
+			{
+				b2Body* body = lookup(bodies);
+				b2FixtureDef def;
+				def.friction = reader.Read<float>();
+				def.restitution = reader.Read<float>();
+				def.restitutionThreshold = reader.Read<float>();
+				def.density = reader.Read<float>();
+				def.isSensor = reader.Read<uint8_t>();
+				def.filter = reader.Read<b2Filter>();
+
+				b2CircleShape circle;
+				b2EdgeShape edge;
+				b2PolygonShape polygon;
+				b2ChainShape chain;
+				b2Shape::Type shapeType = (b2Shape::Type)reader.Read<uint8_t>();
+				float radius = reader.Read<float>();
+				switch (shapeType)
+				{
+				case b2Shape::e_circle:
+					circle.m_p = reader.Read<b2Vec2>();
+					def.shape = &circle;
+					break;
+				case b2Shape::e_edge:
+					edge.m_vertex0 = reader.Read<b2Vec2>();
+					edge.m_vertex1 = reader.Read<b2Vec2>();
+					edge.m_vertex2 = reader.Read<b2Vec2>();
+					edge.m_vertex3 = reader.Read<b2Vec2>();
+					edge.m_oneSided = reader.Read<uint8_t>();
+					def.shape = &edge;
+					break;
+				case b2Shape::e_polygon:
+					polygon.m_count = std::min(reader.Read<int32>(), (int32)b2_maxPolygonVertices);
+					polygon.m_centroid = reader.Read<b2Vec2>();
+					reader.ReadBytes(polygon.m_vertices, sizeof(b2Vec2) * polygon.m_count);
+					reader.ReadBytes(polygon.m_normals, sizeof(b2Vec2) * polygon.m_count);
+					def.shape = &polygon;
+					break;
+				case b2Shape::e_chain:
+				{
+					std::vector<b2Vec2> vertices(std::max(reader.Read<int32>(), 0));
+					reader.ReadBytes(vertices.data(), sizeof(b2Vec2) * vertices.size());
+					b2Vec2 previous = reader.Read<b2Vec2>();
+					b2Vec2 next = reader.Read<b2Vec2>();
+					if (vertices.size() < 2)
+					{
+						ENGINE_LOG_ERROR("Physics recording holds an invalid chain.");
+						return result;
+					}
+					// gives the same vertices and ghosts a loop was created with
+					chain.CreateChain(vertices.data(), (int32)vertices.size(), previous, next);
+					def.shape = &chain;
+					break;
+				}
+				default:
+					ENGINE_LOG_ERROR("Physics recording holds an unknown shape.");
+					return result;
+				}
+				const_cast<b2Shape*>(def.shape)->m_radius = radius;
+
+				if (!body || reader.Failed())
+					return result;
+				fixtures.push_back(body->CreateFixture(&def));
+				break;
+			}
+			case RecordType::DestroyFixture:
+			{
+				uint32_t id = reader.Read<uint32_t>();
+				if (id < fixtures.size() && fixtures[id])
+				{
+					fixtures[id]->GetBody()->DestroyFixture(fixtures[id]);
+					fixtures[id] = nullptr;
+				}
+				break;
+			}
+			case RecordType::CreateJoint:
+			{
+				b2JointType jointType = (b2JointType)reader.Read<uint8_t>();
+				b2Body* bodyA = lookup(bodies);
+				b2Body* bodyB = lookup(bodies);
+				uint32_t size = reader.Read<uint32_t>();
+
+				b2RevoluteJointDef revolute;
+				b2DistanceJointDef distance;
+				b2PrismaticJointDef prismatic;
+				b2WeldJointDef weld;
+				b2MouseJointDef mouse;
+				b2JointDef* def = nullptr;
+				switch (jointType)
+				{
+				case e_revoluteJoint:	def = &revolute; break;
+				case e_distanceJoint:	def = &distance; break;
+				case e_prismaticJoint:	def = &prismatic; break;
+				case e_weldJoint:		def = &weld; break;
+				case e_mouseJoint:		def = &mouse; break;
+				}
+				if (!def || size != GetJointDefSize(jointType) || !bodyA || !bodyB)
+				{
+					ENGINE_LOG_ERROR("Physics recording holds an invalid joint.");
+					return result;
+				}
+
+				reader.ReadBytes(def, size);
+				def->bodyA = bodyA;
+				def->bodyB = bodyB;
+				def->userData.pointer = 0;
+				joints.push_back(world.CreateJoint(def));
+				break;
+			}
+			case RecordType::DestroyJoint:
+			{
+				uint32_t id = reader.Read<uint32_t>();
+				if (id < joints.size() && joints[id])
+				{
+					world.DestroyJoint(joints[id]);
+					joints[id] = nullptr;
+				}
+				break;
+			}
+			case RecordType::UpdateJoint:
+			{
+				b2Joint* joint = lookup(joints);
+				Joint2DComponent settings;
+				settings.Type = (Joint2DComponent::JointType)reader.Read<uint8_t>();
+				settings.EnableLimit = reader.Read<uint8_t>();
+				settings.LowerLimit = reader.Read<float>();
+				settings.UpperLimit = reader.Read<float>();
+				settings.EnableMotor = reader.Read<uint8_t>();
+				settings.MotorSpeed = reader.Read<float>();
+				settings.MaxMotorForce = reader.Read<float>();
+				settings.Length = reader.Read<float>();
+				settings.MinLength = reader.Read<float>();
+				settings.MaxLength = reader.Read<float>();
+				settings.Frequency = reader.Read<float>();
+				settings.DampingRatio = reader.Read<float>();
+				settings.Target = reader.Read<glm::vec2>();
+				settings.MaxForce = reader.Read<float>();
+				if (joint)
+					ApplyJointSettings(joint, settings);
+				break;
+			}
+			case RecordType::BodyCommand:
+			{
+				b2Body* body = lookup(bodies);
+				BodyCommand command = reader.Read<BodyCommand>();
+				if (body)
+					ExecuteBodyCommand(body, command);
+				break;
+			}
+			case RecordType::Step:
+			{
+				float ts = reader.Read<float>();
+				int32_t velocityIterations = reader.Read<int32_t>();
+				int32_t positionIterations = reader.Read<int32_t>();
+
+				// the contacts to disable follow the step, they are needed while it runs
+				std::unordered_set<uint32_t>& disabled = listener.BeginStep();
+				RecordType next;
+				while (reader.Peek(next) && next == RecordType::DisableContact)
+				{
+					reader.Read<RecordType>();
+					disabled.insert(reader.Read<uint32_t>());
+				}
+
+				world.Step(ts, velocityIterations, positionIterations);
+				result.Steps++;
+				break;
+			}
+			case RecordType::End:
+			{
+				result.StepTime = timer.ElapsedMillis();
+				result.Bodies = reader.Read<uint32_t>();
+				for (uint32_t i = 0; i < result.Bodies && !reader.Failed(); i++)
+				{
+					uint32_t id = reader.Read<uint32_t>();
+					b2Vec2 position = reader.Read<b2Vec2>();
+					float angle = reader.Read<float>();
+					b2Vec2 linearVelocity = reader.Read<b2Vec2>();
+					float angularVelocity = reader.Read<float>();
+					bool awake = reader.Read<uint8_t>();
+
+					b2Body* body = id < bodies.size() ? bodies[id] : nullptr;
+					if (!body)
+					{
+						result.Mismatches++;
+						continue;
+					}
+
+					// bit for bit, a -0.0 where 0.0 was recorded counts as a difference
+					float replayAngle = body->GetAngle();
+					float replayAngularVelocity = body->GetAngularVelocity();
+					if (memcmp(&body->GetPosition(), &position, sizeof(b2Vec2)) != 0 ||
+						memcmp(&replayAngle, &angle, sizeof(float)) != 0 ||
+						memcmp(&body->GetLinearVelocity(), &linearVelocity, sizeof(b2Vec2)) != 0 ||
+						memcmp(&replayAngularVelocity, &angularVelocity, sizeof(float)) != 0 ||
+						body->IsAwake() != awake)
+						result.Mismatches++;
+				}
+
+				if (world.GetBodyCount() != (int32)result.Bodies)
+					result.Mismatches++;
+				ended = true;
+				break;
+			}
+			default:
+				ENGINE_LOG_ERROR("Physics recording '{0}' is corrupted.", path.string());
+				return result;
+			}
+		}
+
+		result.Loaded = ended && !reader.Failed();
+		if (!result.Loaded)
+			ENGINE_LOG_ERROR("Physics recording '{0}' ends early, it was not stopped.", path.string());
+		return result;
+	}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class b2World;
+class b2Body;
+class b2Fixture;
+class b2Joint;
+class b2Contact;
+struct b2BodyDef;
+struct b2FixtureDef;
+struct b2JointDef;
+
+namespace Engine {
+
+	struct Joint2DComponent;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// BodyCommand //////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	enum class BodyCommandType : uint8_t
+	{
+		SetTransform = 0, SetLinearVelocity, SetAngularVelocity,
+		ApplyForce, ApplyForceToCenter, ApplyTorque,
+		ApplyLinearImpulse, ApplyLinearImpulseToCenter, ApplyAngularImpulse,
+		SetType, SetFixedRotation, SetEnabled, SetAwake,
+		SetGravityScale, SetLinearDamping, SetAngularDamping
+	};
+
+	// One change made to a body from outside the solver (scripts, transform sync, enabling, pooling)
+	struct BodyCommand
+	{
+		BodyCommandType Type = BodyCommandType::SetAwake;
+		bool Flag = false;			// wake, enabled, awake or fixed rotation
+		uint8_t BodyType = 0;		// b2BodyType
+		float Value = 0.0f;			// angle, angular velocity, torque, angular impulse, gravity scale or damping
+		glm::vec2 Vector = { 0.0f, 0.0f };	// position, velocity, force or impulse
+		glm::vec2 Point = { 0.0f, 0.0f };	// world point a force or impulse is applied at
+
+		static BodyCommand SetTransform(const glm::vec2& position, float angle) { return { BodyCommandType::SetTransform, false, 0, angle, position }; }
+		static BodyCommand SetLinearVelocity(const glm::vec2& velocity) { return { BodyCommandType::SetLinearVelocity, false, 0, 0.0f, velocity }; }
+		static BodyCommand SetAngularVelocity(float velocity) { return { BodyCommandType::SetAngularVelocity, false, 0, velocity }; }
+		static BodyCommand ApplyForce(const glm::vec2& force, const glm::vec2& point, bool wake) { return { BodyCommandType::ApplyForce, wake, 0, 0.0f, force, point }; }
+		static BodyCommand ApplyForceToCenter(const glm::vec2& force, bool wake) { return { BodyCommandType::ApplyForceToCenter, wake, 0, 0.0f, force }; }
+		static BodyCommand ApplyTorque(float torque, bool wake) { return { BodyCommandType::ApplyTorque, wake, 0, torque }; }
+		static BodyCommand ApplyLinearImpulse(const glm::vec2& impulse, const glm::vec2& point, bool wake) { return { BodyCommandType::ApplyLinearImpulse, wake, 0, 0.0f, impulse, point }; }
+		static BodyCommand ApplyLinearImpulseToCenter(const glm::vec2& impulse, bool wake) { return { BodyCommandType::ApplyLinearImpulseToCenter, wake, 0, 0.0f, impulse }; }
+		static BodyCommand ApplyAngularImpulse(float impulse, bool wake) { return { BodyCommandType::ApplyAngularImpulse, wake, 0, impulse }; }
+		static BodyCommand SetType(uint8_t bodyType) { return { BodyCommandType::SetType, false, bodyType }; }
+		static BodyCommand SetFixedRotation(bool fixed) { return { BodyCommandType::SetFixedRotation, fixed }; }
+		static BodyCommand SetEnabled(bool enabled) { return { BodyCommandType::SetEnabled, enabled }; }
+		static BodyCommand SetAwake(bool awake) { return { BodyCommandType::SetAwake, awake }; }
+		static BodyCommand SetGravityScale(float scale) { return { BodyCommandType::SetGravityScale, false, 0, scale }; }
+		static BodyCommand SetLinearDamping(float damping) { return { BodyCommandType::SetLinearDamping, false, 0, damping }; }
+		static BodyCommand SetAngularDamping(float damping) { return { BodyCommandType::SetAngularDamping, false, 0, damping }; }
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// PhysicsRecorder //////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Every change to the physics world goes through here. The change is applied and, while recording, appended to
+	// a binary log. The log starts with the world's creation, so replaying it runs the exact same Box2D calls against
+	// a fresh world and ends in the same state bit for bit (same build, same machine).
+	class PhysicsRecorder
+	{
+	public:
+		PhysicsRecorder() = default;
+		~PhysicsRecorder();
+
+		PhysicsRecorder(const PhysicsRecorder&) = delete;
+		PhysicsRecorder& operator=(const PhysicsRecorder&) = delete;
+
+		// Call before the world is created
+		bool Start(const std::filesystem::path& path, const glm::vec2& gravity);
+		// Writes the final state of every body, the replay compares against it. Call before the world is destroyed.
+		void Stop(b2World* world);
+		bool IsRecording() const { return m_File.is_open(); }
+
+		b2Body* CreateBody(b2World* world, const b2BodyDef& def);
+		// also destroys the body's fixtures and joints
+		void DestroyBody(b2World* world, b2Body* body);
+		b2Fixture* CreateFixture(b2Body* body, const b2FixtureDef& def);
+		void DestroyFixture(b2Fixture* fixture);
+		b2Joint* CreateJoint(b2World* world, const b2JointDef& def);
+		void DestroyJoint(b2World* world, b2Joint* joint);
+		// Pushes the motor, limit, softness and target settings of the component to the joint
+		void UpdateJoint(b2Joint* joint, const Joint2DComponent& settings);
+		void ApplyBodyCommand(b2Body* body, const BodyCommand& command);
+		void Step(b2World* world, float ts, int32_t velocityIterations, int32_t positionIterations);
+
+		// Called by the contact listener at the end of every PreSolve, disabled contacts are logged
+		void OnPreSolve(b2Contact* contact);
+
+	private:
+		template<typename T>
+		void Write(const T& value);
+		void WriteBytes(const void* data, size_t size);
+		void Flush();
+		uint32_t GetID(const void* object) const;
+
+	private:
+		std::ofstream m_File;
+		std::vector<uint8_t> m_Buffer;
+
+		// Objects are identified by creation order, per kind. The replay creates them in the same order.
+		std::unordered_map<const void*, uint32_t> m_IDs;
+		uint32_t m_BodyCount = 0;
+		uint32_t m_FixtureCount = 0;
+		uint32_t m_JointCount = 0;
+		uint32_t m_PreSolveIndex = 0; // PreSolve calls so far in the current step
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// PhysicsReplay ////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Runs a recording against a fresh world, without a scene, scripts or a window
+	class PhysicsReplay
+	{
+	public:
+		struct Result
+		{
+			bool Loaded = false;
+			uint32_t Steps = 0;
+			uint32_t Bodies = 0;		// bodies alive at the end
+			uint32_t Mismatches = 0;	// bodies whose final state differs from the recorded one in any bit
+			float StepTime = 0.0f;		// all steps, in milliseconds
+
+			bool Matches() const { return Loaded && Mismatches == 0; }
+		};
+
+		static Result Run(const std::filesystem::path& path);
+	};
+
+}
@@ -0,0 +1,185 @@
+#include "egpch.h"
+#include "Prefab.h"
+
+#include "SceneSerializer.h"
+#include "Hierarchy.h"
+
+namespace Engine {
+
+	template<typename Component>
+	static void CopyComponentIfExists(Entity dst, Entity src)
+	{
+		if (src.HasComponent<Component>())
+			dst.AddOrReplaceComponent<Component>(src.GetComponent<Component>());
+	}
+
+	Prefab::Prefab()
+		: m_Scene(std::make_shared<Scene>())
+	{
+	}
+
+	std::shared_ptr<Prefab> Prefab::Create(Entity root)
+	{
+		ASSERT(root, "Cannot create prefab from a null entity.");
+
+		std::shared_ptr<Prefab> prefab = std::make_shared<Prefab>();
+		Entity prefabRoot = { prefab->m_Scene->m_SceneRoot, prefab->m_Scene.get() };
+		prefab->CopyTree(root, prefabRoot);
+
+		prefab->BuildNodes(Entity{ prefabRoot.GetComponent<RelationshipComponent>().FirstChild, prefab->m_Scene.get() });
+
+		return prefab;
+	}
+
+	std::shared_ptr<Prefab> Prefab::Load(const std::filesystem::path& filepath)
+	{
+		std::shared_ptr<Prefab> prefab = std::make_shared<Prefab>();
+		SceneSerializer serializer(prefab->m_Scene);
+		Entity root = serializer.DeserializePrefab(filepath.string());
+		if (!root)
+		{
+			ENGINE_LOG_ERROR("Could not load prefab '{0}'.", filepath.string());
+			return nullptr;
+		}
+
+		prefab->BuildNodes(root);
+		return prefab;
+	}
+
+	void Prefab::Save(const std::filesystem::path& filepath)
+	{
+		SceneSerializer serializer(m_Scene);
+		serializer.SerializePrefab(GetRoot(), filepath.string());
+	}
+
+	const std::string& Prefab::GetName() const
+	{
+		return m_Scene->m_Registry.get<TagComponent>(m_Nodes[0].Handle).Tag;
+	}
+
+	void Prefab::CopyTree(Entity srcRoot, Entity dstParent)
+	{
+		// source entity -> its copy, parents and previous siblings are always copied before an entity
+		std::unordered_map<entt::entity, entt::entity> copies;
+
+		Hierarchy::ForEachPreOrder(srcRoot, [&](Entity src) {
+			Entity dst = m_Scene->CreateEntityWithUUID(src.GetUUID(), src.GetName());
+			copies[src] = dst;
+
+			auto& srcRelation = src.GetComponent<RelationshipComponent>();
+			auto& dstRelation = dst.GetComponent<RelationshipComponent>();
+			if (src == srcRoot)
+			{
+				auto& parentRelation = dstParent.GetComponent<RelationshipComponent>();
+				dstRelation.Parent = dstParent;
+				dstRelation.NextSibling = parentRelation.FirstChild;
+				if (parentRelation.FirstChild != entt::null)
+					m_Scene->m_Registry.get<RelationshipComponent>(parentRelation.FirstChild).PrevSibling = dst;
+				parentRelation.FirstChild = dst;
+			}
+			else
+			{
+				dstRelation.Parent = copies[srcRelation.Parent];
+				if (srcRelation.PrevSibling != entt::null)
+				{
+					dstRelation.PrevSibling = copies[srcRelation.PrevSibling];
+					m_Scene->m_Registry.get<RelationshipComponent>(dstRelation.PrevSibling).NextSibling = dst;
+				}
+				else
+					m_Scene->m_Registry.get<RelationshipComponent>(dstRelation.Parent).FirstChild = dst;
+			}
+
+			CopyComponentIfExists<TransformComponent>(dst, src);
+			CopyComponentIfExists<CameraComponent>(dst, src);
+			CopyComponentIfExists<SpriteRendererComponent>(dst, src);
+			CopyComponentIfExists<CircleRendererComponent>(dst, src);
+			CopyComponentIfExists<Rigidbody2DComponent>(dst, src);
+			CopyComponentIfExists<BoxCollider2DComponent>(dst, src);
+			CopyComponentIfExists<CircleCollider2DComponent>(dst, src);
+			CopyComponentIfExists<PolygonCollider2DComponent>(dst, src);
+			CopyComponentIfExists<CapsuleCollider2DComponent>(dst, src);
+			CopyComponentIfExists<EdgeChainCollider2DComponent>(dst, src);
+			CopyComponentIfExists<Joint2DComponent>(dst, src);
+			CopyComponentIfExists<TextComponent>(dst, src);
+			CopyComponentIfExists<ParticleEmitterComponent>(dst, src);
+			CopyComponentIfExists<ScriptComponent>(dst, src);
+			CopyComponentIfExists<AudioSourcesComponent>(dst, src);
+
+			// the source may be running, runtime handles must not leak into the prefab
+			if (dst.HasComponent<Rigidbody2DComponent>())
+				dst.GetComponent<Rigidbody2DComponent>().RuntimeBody = nullptr;
+			if (dst.HasComponent<BoxCollider2DComponent>())
+			{
+				auto& bc2d = dst.GetComponent<BoxCollider2DComponent>();
+				bc2d.RuntimeFixture = nullptr;
+				bc2d.ClosestRigidbodyParent = entt::null;
+			}
+			if (dst.HasComponent<CircleCollider2DComponent>())
+			{
+				auto& cc2d = dst.GetComponent<CircleCollider2DComponent>();
+				cc2d.RuntimeFixture = nullptr;
+				cc2d.ClosestRigidbodyParent = entt::null;
+			}
+			if (dst.HasComponent<PolygonCollider2DComponent>())
+			{
+				auto& pc2d = dst.GetComponent<PolygonCollider2DComponent>();
+				pc2d.RuntimeFixture = nullptr;
+				pc2d.ClosestRigidbodyParent = entt::null;
+			}
+			if (dst.HasComponent<CapsuleCollider2DComponent>())
+			{
+				auto& cap2d = dst.GetComponent<CapsuleCollider2DComponent>();
+				cap2d.RuntimeFixture = nullptr;
+				cap2d.RuntimeCapFixtures[0] = cap2d.RuntimeCapFixtures[1] = nullptr;
+				cap2d.ClosestRigidbodyParent = entt::null;
+			}
+			if (dst.HasComponent<EdgeChainCollider2DComponent>())
+			{
+				auto& ec2d = dst.GetComponent<EdgeChainCollider2DComponent>();
+				ec2d.RuntimeFixture = nullptr;
+				ec2d.ClosestRigidbodyParent = entt::null;
+			}
+			if (dst.HasComponent<Joint2DComponent>())
+				dst.GetComponent<Joint2DComponent>().RuntimeJoint = nullptr;
+			if (dst.HasComponent<ScriptComponent>())
+			{
+				auto& sc = dst.GetComponent<ScriptComponent>();
+				sc.Instance = sol::nil;
+				sc.OnUpdate = sol::nil;
+				sc.OnCollisionBegin = sol::nil;
+				sc.OnCollisionEnd = sol::nil;
+				sc.OnDestroy = sol::nil;
+			}
+		});
+	}
+
+	void Prefab::BuildNodes(Entity root)
+	{
+		auto& registry = m_Scene->m_Registry;
+		std::unordered_map<entt::entity, int32_t> indices;
+
+		// pre-order, so the parent and previous sibling of a node already have their index
+		Hierarchy::ForEachPreOrder(root, [&](Entity entity) {
+			int32_t index = (int32_t)m_Nodes.size();
+			Node node;
+			node.Handle = entity;
+
+			if (entity != root)
+			{
+				const auto& relation = registry.get<RelationshipComponent>(entity);
+				node.Parent = indices[relation.Parent];
+				if (relation.PrevSibling != entt::null)
+				{
+					node.PrevSibling = indices[relation.PrevSibling];
+					m_Nodes[node.PrevSibling].NextSibling = index;
+				}
+				else
+					m_Nodes[node.Parent].FirstChild = index;
+			}
+
+			indices[entity] = index;
+			m_Nodes.push_back(node);
+		});
+	}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "Scene.h"
+#include "Entity.h"
+
+namespace Engine {
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Prefab ///////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// A reusable entity tree. The prefab keeps the source components in a private scene, instances are
+	// created in bulk by Scene::InstantiatePrefab. Assets (textures, fonts) are shared between all instances.
+	class Prefab
+	{
+	public:
+		// Flattened tree, nodes are in pre-order so a parent always comes before its children.
+		// Links are indices into the node list, -1 if there is none.
+		struct Node
+		{
+			entt::entity Handle = entt::null;
+			int32_t Parent = -1;
+			int32_t FirstChild = -1;
+			int32_t NextSibling = -1;
+			int32_t PrevSibling = -1;
+		};
+
+		Prefab();
+
+		// Copies the tree of 'root' (any scene) into a new prefab
+		static std::shared_ptr<Prefab> Create(Entity root);
+		static std::shared_ptr<Prefab> Load(const std::filesystem::path& filepath);
+		void Save(const std::filesystem::path& filepath);
+
+		Entity GetRoot() const { return { m_Nodes[0].Handle, m_Scene.get() }; }
+		const std::string& GetName() const;
+		uint32_t GetNodeCount() const { return (uint32_t)m_Nodes.size(); }
+
+	private:
+		void CopyTree(Entity srcRoot, Entity dstParent);
+		void BuildNodes(Entity root);
+
+	private:
+		std::shared_ptr<Scene> m_Scene;
+		std::vector<Node> m_Nodes;
+
+	friend class Scene;
+	friend class EntityPool;
+	};
+
+}
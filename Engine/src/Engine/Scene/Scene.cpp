@@ -2,72 +2,59 @@
 #include "Scene.h"
 
 #include "ScriptGlue.h"
+#include "SceneSnapshot.h"
+#include "Prefab.h"
+#include "Hierarchy.h"
 
 #include "Engine/Utils/Math.h"
+#include "Engine/Utils/Timer.h"
+#include "Engine/Utils/WorkerThread.h"
+#include "Engine/Utils/Random.h"
 #include "Engine/Utils/AudioEngine.h"
 #include "Engine/Renderer/Renderer.h"
 #include "Engine/Project/Project.h"
 
+#include "box2d/b2_revolute_joint.h"
+#include "box2d/b2_distance_joint.h"
+#include "box2d/b2_prismatic_joint.h"
+#include "box2d/b2_weld_joint.h"
+#include "box2d/b2_mouse_joint.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
 
 
 namespace Engine {
 
+	// Copies one component type from every prefab node that has it to all instances of that node.
+	// 'instances' is node major: the copies of node n are instances[n * count, (n + 1) * count).
 	template<typename Component>
-	static void CopyComponent(entt::registry& dst, entt::registry& src, const std::unordered_map<UUID, entt::entity>& enttMap)
+	static void InstantiatePrefabPool(entt::registry& dst, entt::registry& src, const std::vector<Prefab::Node>& nodes, const std::vector<entt::entity>& instances, uint32_t count)
 	{
-		auto view = src.view<Component>();
-		for (auto e : view)
+		if (src.size<Component>() == 0)
+			return;
+
+		size_t nodesWithComponent = 0;
+		for (const auto& node : nodes)
+			nodesWithComponent += src.has<Component>(node.Handle) ? 1 : 0;
+		if (nodesWithComponent == 0)
+			return;
+
+		dst.reserve<Component>(dst.size<Component>() + nodesWithComponent * count);
+		for (size_t n = 0; n < nodes.size(); n++)
 		{
-			UUID uuid = src.get<IDComponent>(e).ID;
-			ASSERT(enttMap.find(uuid) != enttMap.end(), "Entity from source not found in the map.");
-			entt::entity dstEnttID = enttMap.at(uuid);
+			if (!src.has<Component>(nodes[n].Handle))
+				continue;
 
-			auto& component = src.get<Component>(e);
-			dst.emplace_or_replace<Component>(dstEnttID, component);
+			auto first = instances.begin() + n * count;
+			dst.insert<Component>(first, first + count, src.get<Component>(nodes[n].Handle));
 		}
 	}
 
-	// relationship component requires a special copy function as the entt::entity handles may be different in src and dst registries
-	template<>
-	static void CopyComponent<RelationshipComponent>(entt::registry& dst, entt::registry& src, const std::unordered_map<UUID, entt::entity>& enttMap)
+	template<typename... Component>
+	static void InstantiatePrefabPools(entt::registry& dst, entt::registry& src, const std::vector<Prefab::Node>& nodes, const std::vector<entt::entity>& instances, uint32_t count)
 	{
-		auto view = src.view<RelationshipComponent>();
-		for (auto e : view)
-		{
-			UUID uuid = src.get<IDComponent>(e).ID;
-			ASSERT(enttMap.find(uuid) != enttMap.end(), "Entity from source not found in the map.");
-			entt::entity dstEnttID = enttMap.at(uuid);
-
-			auto& srcRelation = src.get<RelationshipComponent>(e);
-			auto& dstRelation = dst.get<RelationshipComponent>(dstEnttID);
-			
-			auto GetMappedEntity = [&](entt::entity originalHandle) -> entt::entity
-				{
-					// Check for null BEFORE accessing the registry
-					if (originalHandle == entt::null)
-						return entt::null;
-
-					// ensure the handle is actually valid in source
-					if (!src.valid(originalHandle))
-						return entt::null;
-
-					UUID originalUUID = src.get<IDComponent>(originalHandle).ID;
-
-					// If the linked entity wasn't copied (e.g. it's outside the selection), return null
-					if (enttMap.find(originalUUID) == enttMap.end())
-						return entt::null;
-
-					return enttMap.at(originalUUID);
-				};
-
-			// Assign to the correct member variables
-			dstRelation.Parent = GetMappedEntity(srcRelation.Parent);
-			dstRelation.FirstChild = GetMappedEntity(srcRelation.FirstChild);
-			dstRelation.NextSibling = GetMappedEntity(srcRelation.NextSibling);
-			dstRelation.PrevSibling = GetMappedEntity(srcRelation.PrevSibling);
-		}
+		(InstantiatePrefabPool<Component>(dst, src, nodes, instances, count), ...);
 	}
 
 	template<typename Component>
@@ -86,24 +73,14 @@ namespace Engine {
 	// Helper to transform child data into parent's local space
 	static void AttachColliders(Entity rootEntity, Entity currentEntity, Scene* scene)
 	{
-		currentEntity.AttachFixturesToRigidbodyParent();
-		
-		// 6. Recursion
-		if (currentEntity.HasComponent<RelationshipComponent>())
-		{
-			auto& rel = currentEntity.GetComponent<RelationshipComponent>();
-			entt::entity childHandle = rel.FirstChild;
-
-			while (childHandle != entt::null)
-			{
-				Entity child = { childHandle, scene };
-				if (!child.HasComponent<Rigidbody2DComponent>())
-				{
-					AttachColliders(rootEntity, child, scene);
-				}
-				childHandle = child.GetComponent<RelationshipComponent>().NextSibling;
-			}
-		}
+		Hierarchy::ForEachPreOrder(currentEntity, [&](Entity entity) {
+			// children with their own rigidbody keep their colliders on it
+			if (entity != currentEntity && entity.HasComponent<Rigidbody2DComponent>())
+				return false;
+
+			entity.AttachFixturesToRigidbodyParent();
+			return true;
+		});
 	}
 
 	static void CreateRigidbody(Entity entity, b2World* physicsWorld, Scene* scene)
@@ -125,10 +102,14 @@ namespace Engine {
 		bodyDef.angle = rotation.z;
 		bodyDef.userData.pointer = (uintptr_t)(uint32_t)entity;
 
-		b2Body* body = physicsWorld->CreateBody(&bodyDef);
-		body->SetFixedRotation(rb2d.FixedRotation);
-		body->SetEnabled(entity.isEnabled());
+		PhysicsRecorder& recorder = scene->GetPhysicsRecorder();
+		b2Body* body = recorder.CreateBody(physicsWorld, bodyDef);
+		recorder.ApplyBodyCommand(body, BodyCommand::SetFixedRotation(rb2d.FixedRotation));
+		recorder.ApplyBodyCommand(body, BodyCommand::SetEnabled(entity.isEnabled()));
 		rb2d.RuntimeBody = body;
+		// the transform already matches the body
+		rb2d.RuntimeSyncedPosition = { translation.x, translation.y };
+		rb2d.RuntimeSyncedAngle = rotation.z;
 
 		AttachColliders(entity, entity, scene);
 	}
@@ -136,25 +117,171 @@ namespace Engine {
 
 	static void DestroyUnlinkedFixtureRecursive(Entity& entity, Scene* scene)
 	{
-		// if entity is a rigidbody, children are gauranteed to be linked to it
-		if (entity.HasComponent<Rigidbody2DComponent>())
-			return;
+		Hierarchy::ForEachPreOrder(entity, [](Entity current) {
+			// if entity is a rigidbody, children are gauranteed to be linked to it
+			if (current.HasComponent<Rigidbody2DComponent>())
+				return false;
+
+			current.DetachFixturesFromRigidbodyParent();
+			return true;
+		});
+	}
+
+	// Box2D destroys the joints of a body with it, the joint components must forget them
+	class JointDestructionListener : public b2DestructionListener
+	{
+	public:
+		JointDestructionListener(entt::registry& registry)
+			: m_Registry(registry)
+		{
+		}
+
+		void SayGoodbye(b2Joint* joint) override
+		{
+			entt::entity entity = (entt::entity)(uint32_t)joint->GetUserData().pointer;
+			if (!m_Registry.valid(entity))
+				return;
+
+			auto* component = m_Registry.try_get<Joint2DComponent>(entity);
+			if (component && component->RuntimeJoint == joint)
+				component->RuntimeJoint = nullptr;
+		}
+
+		// fixtures are released with their collider components
+		void SayGoodbye(b2Fixture* fixture) override {}
+
+	private:
+		entt::registry& m_Registry;
+	};
+
+	static b2Vec2 ToWorldPoint(const glm::mat4& transform, const glm::vec2& point)
+	{
+		glm::vec4 world = transform * glm::vec4(point, 0.0f, 1.0f);
+		return b2Vec2(world.x, world.y);
+	}
+
+	// Blend between the state of the last two fixed steps. Translation and scale are lerped, rotation is slerped.
+	static glm::mat4 InterpolateTransform(const glm::mat4& previous, const glm::mat4& current, float alpha)
+	{
+		// most entities do not move between steps, skip the decomposition for them
+		if (previous == current)
+			return current;
+
+		glm::vec3 prevTranslation, prevRotation, prevScale;
+		glm::vec3 currTranslation, currRotation, currScale;
+		if (!Math::DecomposeTransform(previous, prevTranslation, prevRotation, prevScale) ||
+			!Math::DecomposeTransform(current, currTranslation, currRotation, currScale))
+			return current;
+
+		glm::quat rotation = glm::slerp(glm::quat(prevRotation), glm::quat(currRotation), alpha);
+
+		return glm::translate(glm::mat4(1.0f), glm::mix(prevTranslation, currTranslation, alpha))
+			* glm::toMat4(rotation)
+			* glm::scale(glm::mat4(1.0f), glm::mix(prevScale, currScale, alpha));
+	}
+
+	// World AABB of the unit quad every renderable is drawn with
+	static void GetWorldBounds(const glm::mat4& transform, glm::vec2& min, glm::vec2& max)
+	{
+		glm::vec2 center = transform[3];
+		glm::vec2 halfExtent = 0.5f * glm::vec2(
+			std::abs(transform[0][0]) + std::abs(transform[1][0]),
+			std::abs(transform[0][1]) + std::abs(transform[1][1]));
+		min = center - halfExtent;
+		max = center + halfExtent;
+	}
 
-		entity.DetachFixturesFromRigidbodyParent();
+	// Appends up to 'count' particles at 'position', as many as the emitter has room for
+	static void EmitParticles(ParticleEmitterComponent& emitter, uint32_t count, const glm::vec2& position)
+	{
+		ParticleBuffer& particles = emitter.Particles;
+		if (particles.PositionX.size() != emitter.MaxParticles)
+		{
+			for (auto* array : { &particles.PositionX, &particles.PositionY, &particles.VelocityX, &particles.VelocityY, &particles.Life, &particles.InverseLifeTime, &particles.SizeBegin,
+				&particles.ColorR, &particles.ColorG, &particles.ColorB, &particles.ColorA, &particles.Size })
+				array->resize(emitter.MaxParticles);
+			particles.Count = std::min(particles.Count, emitter.MaxParticles);
+		}
 
-		// recursion
-		if (entity.HasComponent<RelationshipComponent>())
+		const uint32_t end = std::min(particles.Count + count, emitter.MaxParticles);
+		const float lifeTime = std::max(emitter.LifeTime, 0.0001f);
+		for (uint32_t i = particles.Count; i < end; i++)
 		{
-			auto& rel = entity.GetComponent<RelationshipComponent>();
-			entt::entity childHandle = rel.FirstChild;
+			particles.PositionX[i] = position.x;
+			particles.PositionY[i] = position.y;
+			particles.VelocityX[i] = emitter.Velocity.x + emitter.VelocityVariation.x * (Random::Float() - 0.5f);
+			particles.VelocityY[i] = emitter.Velocity.y + emitter.VelocityVariation.y * (Random::Float() - 0.5f);
+			particles.Life[i] = lifeTime;
+			particles.InverseLifeTime[i] = 1.0f / lifeTime;
+			particles.SizeBegin[i] = emitter.SizeBegin + emitter.SizeVariation * (Random::Float() - 0.5f);
+			// drawable before the next update, scripts may emit after the particles were updated this frame
+			particles.ColorR[i] = emitter.ColorBegin.r;
+			particles.ColorG[i] = emitter.ColorBegin.g;
+			particles.ColorB[i] = emitter.ColorBegin.b;
+			particles.ColorA[i] = emitter.ColorBegin.a;
+			particles.Size[i] = particles.SizeBegin[i];
+		}
+		particles.Count = end;
+	}
+
+	// out = end at the end of a particle's life, begin when it was emitted
+	static void InterpolateOverLife(float* out, const float* life, const float* inverseLifeTime, uint32_t count, float begin, float end)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = end + (begin - end) * (life[i] * inverseLifeTime[i]);
+	}
 
-			while (childHandle != entt::null)
+	// Integrates all live particles, swaps the dead ones out of [0, Count), then fades the color and size of the rest
+	static void SimulateParticles(ParticleEmitterComponent& emitter, float ts)
+	{
+		ParticleBuffer& particles = emitter.Particles;
+		const uint32_t count = particles.Count;
+		float* positionX = particles.PositionX.data();
+		float* positionY = particles.PositionY.data();
+		const float* velocityX = particles.VelocityX.data();
+		const float* velocityY = particles.VelocityY.data();
+		float* life = particles.Life.data();
+
+		// one array per loop, no branches, so each of them vectorizes
+		for (uint32_t i = 0; i < count; i++)
+			life[i] -= ts;
+		for (uint32_t i = 0; i < count; i++)
+			positionX[i] += velocityX[i] * ts;
+		for (uint32_t i = 0; i < count; i++)
+			positionY[i] += velocityY[i] * ts;
+
+		uint32_t alive = count;
+		for (uint32_t i = 0; i < alive;)
+		{
+			if (life[i] > 0.0f)
 			{
-				Entity child = { childHandle, scene };
-				DestroyUnlinkedFixtureRecursive(child, scene);	
-				childHandle = child.GetComponent<RelationshipComponent>().NextSibling;
+				i++;
+				continue;
 			}
+
+			alive--;
+			particles.PositionX[i] = particles.PositionX[alive];
+			particles.PositionY[i] = particles.PositionY[alive];
+			particles.VelocityX[i] = particles.VelocityX[alive];
+			particles.VelocityY[i] = particles.VelocityY[alive];
+			particles.Life[i] = particles.Life[alive];
+			particles.InverseLifeTime[i] = particles.InverseLifeTime[alive];
+			particles.SizeBegin[i] = particles.SizeBegin[alive];
 		}
+		particles.Count = alive;
+
+		const float* inverseLifeTime = particles.InverseLifeTime.data();
+		InterpolateOverLife(particles.ColorR.data(), life, inverseLifeTime, alive, emitter.ColorBegin.r, emitter.ColorEnd.r);
+		InterpolateOverLife(particles.ColorG.data(), life, inverseLifeTime, alive, emitter.ColorBegin.g, emitter.ColorEnd.g);
+		InterpolateOverLife(particles.ColorB.data(), life, inverseLifeTime, alive, emitter.ColorBegin.b, emitter.ColorEnd.b);
+		InterpolateOverLife(particles.ColorA.data(), life, inverseLifeTime, alive, emitter.ColorBegin.a, emitter.ColorEnd.a);
+
+		// sizes begin per particle
+		float* size = particles.Size.data();
+		const float* sizeBegin = particles.SizeBegin.data();
+		const float sizeEnd = emitter.SizeEnd;
+		for (uint32_t i = 0; i < alive; i++)
+			size[i] = sizeEnd + (sizeBegin[i] - sizeEnd) * (life[i] * inverseLifeTime[i]);
 	}
 
 	// To be ued only for debugging
@@ -197,6 +324,12 @@ namespace Engine {
 
 	Scene::Scene()
 	{
+		ConnectIndices();
+		// RenderScene's groups exist from the start. Creating a group sorts the pools it owns, done lazily on the first
+		// rendered frame it would reorder pools the pipelined physics worker may be reading.
+		m_Registry.group<TransformComponent, SpriteRendererComponent>();
+		m_Registry.group<CircleRendererComponent>(entt::get<TransformComponent>);
+		m_Registry.group<TextComponent>(entt::get<TransformComponent>);
 		m_SceneRoot = CreateEntity("::SCENE_ROOT::");
 	}
 
@@ -221,51 +354,25 @@ namespace Engine {
 		}
 	}
 
-	std::shared_ptr<Scene> Scene::Copy(std::shared_ptr<Scene> other)
+	void Scene::TakeSnapshot()
 	{
-		std::shared_ptr<Scene> newScene = std::make_shared<Scene>();
-
-		newScene->m_ViewportWidth = other->m_ViewportWidth;
-		newScene->m_ViewportHeight = other->m_ViewportHeight;
-		newScene->m_Acc = other->m_Acc;
-		newScene->m_SceneName = other->m_SceneName;
-
-		auto& srcSceneRegistry = other->m_Registry;
-		auto& dstSceneRegistry = newScene->m_Registry;
-		std::unordered_map<UUID, entt::entity> enttMap;
-
-		// Create entities in new scene
-		auto idView = srcSceneRegistry.view<IDComponent>();
-		for (auto e : idView)
-		{
-			UUID uuid = srcSceneRegistry.get<IDComponent>(e).ID;
-			if (e != other->m_SceneRoot)
-			{
-				const auto& name = srcSceneRegistry.get<TagComponent>(e).Tag;
-				Entity newEntity = newScene->CreateEntityWithUUID(uuid, name);
-				enttMap[uuid] = (entt::entity)newEntity;
-			}
-			else
-			{
-				enttMap[uuid] = newScene->m_SceneRoot;
-			}
-		}
-
-		// Copy components (except IDComponent and TagComponent)
-		CopyComponent<TransformComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<SpriteRendererComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<CameraComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<ScriptComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<CircleRendererComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<Rigidbody2DComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<BoxCollider2DComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<CircleCollider2DComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<TextComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<RelationshipComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<DisabledComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
-		CopyComponent<AudioSourcesComponent>(dstSceneRegistry, srcSceneRegistry, enttMap);
+		ASSERT(!m_Snapshot, "Scene already has a snapshot.");
+		m_Snapshot = std::make_unique<SceneSnapshot>(this);
+	}
 
-		return newScene;
+	void Scene::RestoreSnapshot()
+	{
+		ASSERT(m_Snapshot, "Scene has no snapshot to restore.");
+		Timer timer;
+		size_t trackedCount = m_Snapshot->GetTrackedCount();
+		m_Snapshot->Restore();
+		m_Snapshot.reset();
+
+		// restored tags replaced the played ones without removing them from the index
+		RebuildTagIndex();
+		// global transforms are not tracked, recalculate them from the restored local transforms
+		UpdateGlobalTransforms();
+		ENGINE_LOG_INFO("Restored scene '{0}' snapshot ({1} changes) in {2}ms.", m_SceneName, trackedCount, timer.ElapsedMillis());
 	}
 
 	Entity Scene::DuplicateEntity(Entity entity)
@@ -313,6 +420,27 @@ namespace Engine {
 		if (nextsibling)
 			nextsibling.GetComponent<RelationshipComponent>().PrevSibling = newEntity;
 
+		// Joints are copied once the copies are linked, so they attach to the right rigidbodies.
+		// Joints between duplicated entities connect the copies to each other.
+		if (m_Registry.size<Joint2DComponent>() > 0)
+		{
+			std::unordered_map<UUID, UUID> duplicatedIDs;
+			for (auto& [originalHandle, cloneHandle] : duplicationMap)
+				duplicatedIDs[m_Registry.get<IDComponent>(originalHandle).ID] = m_Registry.get<IDComponent>(cloneHandle).ID;
+
+			for (auto& [originalHandle, cloneHandle] : duplicationMap)
+			{
+				if (!m_Registry.has<Joint2DComponent>(originalHandle))
+					continue;
+
+				Joint2DComponent joint = m_Registry.get<Joint2DComponent>(originalHandle);
+				auto it = duplicatedIDs.find(joint.ConnectedEntity);
+				if (it != duplicatedIDs.end())
+					joint.ConnectedEntity = it->second;
+				Entity{ cloneHandle, this }.AddOrReplaceComponent<Joint2DComponent>(joint);
+			}
+		}
+
 		// The tree is now 100% built and stitched. It is completely safe to run Lua!
 		if (m_Lua)
 		{
@@ -329,40 +457,230 @@ namespace Engine {
 		return newEntity;
 	}
 
-	void Scene::CreateDuplicationMap(Entity& entity, std::unordered_map<entt::entity, entt::entity>& map)
+	std::vector<Entity> Scene::InstantiatePrefab(const Prefab& prefab, uint32_t count, Entity parent)
 	{
-		if (entity == m_SceneRoot)
+		std::vector<entt::entity> instances = InstantiatePrefabEntities(prefab, count, parent);
+
+		std::vector<Entity> roots;
+		if (instances.empty())
+			return roots;
+
+		roots.reserve(count);
+		for (uint32_t i = 0; i < count; i++)
+			roots.emplace_back(instances[i], this);
+		return roots;
+	}
+
+	std::vector<entt::entity> Scene::InstantiatePrefabEntities(const Prefab& prefab, uint32_t count, Entity parent)
+	{
+		if (count == 0 || prefab.m_Nodes.empty())
+			return {};
+
+		if (!parent)
+			parent = Entity{ m_SceneRoot, this };
+		ASSERT(parent.BelongsToScene(this), "This Scene cannot instantiate a prefab under a parent of other scene.")
+
+		Timer timer;
+		auto& srcRegistry = prefab.m_Scene->m_Registry;
+		const auto& nodes = prefab.m_Nodes;
+		const size_t total = nodes.size() * count;
+
+		// All entities in one go. Node major, the first 'count' entities are the instance roots.
+		std::vector<entt::entity> instances(total);
+		m_Registry.create(instances.begin(), instances.end());
+		auto instance = [&](int32_t node, uint32_t i) -> entt::entity {
+			return node < 0 ? entt::null : instances[(size_t)node * count + i];
+		};
+
+		// Components that differ per instance
 		{
-			ASSERT(false, "Trying duplicate root is not valid.")
-			return;
+			std::vector<IDComponent> ids(total);
+			for (auto& id : ids)
+				id.ID = UUID();
+			m_Registry.insert<IDComponent>(instances.begin(), instances.end(), ids.begin(), ids.end());
+		}
+
+		entt::entity oldFirstChild = parent.GetComponent<RelationshipComponent>().FirstChild;
+		{
+			std::vector<RelationshipComponent> relations(total);
+			for (size_t n = 0; n < nodes.size(); n++)
+			{
+				const auto& node = nodes[n];
+				for (uint32_t i = 0; i < count; i++)
+				{
+					auto& relation = relations[n * count + i];
+					relation.Parent = instance(node.Parent, i);
+					relation.FirstChild = instance(node.FirstChild, i);
+					relation.NextSibling = instance(node.NextSibling, i);
+					relation.PrevSibling = instance(node.PrevSibling, i);
+				}
+			}
+
+			// Chain the roots in front of the parent's existing children
+			for (uint32_t i = 0; i < count; i++)
+			{
+				auto& relation = relations[i];
+				relation.Parent = parent;
+				relation.PrevSibling = i > 0 ? instances[i - 1] : entt::null;
+				relation.NextSibling = i + 1 < count ? instances[i + 1] : oldFirstChild;
+			}
+			m_Registry.insert<RelationshipComponent>(instances.begin(), instances.end(), relations.begin(), relations.end());
 		}
 
-		std::string name = entity.GetName();
-		ENGINE_LOG_INFO("Duplicating entity {}", name);
-		Entity newEntity = CreateEntity(name);
+		// fetched again, the insert above may have moved the pool
+		if (oldFirstChild != entt::null)
+			Entity(oldFirstChild, this).GetComponent<RelationshipComponent>().PrevSibling = instances[count - 1];
+		parent.GetComponent<RelationshipComponent>().FirstChild = instances[0];
+
+		// Components shared by all instances of a node
+		InstantiatePrefabPools<
+			TagComponent,
+			TransformComponent,
+			SpriteRendererComponent,
+			CameraComponent,
+			ScriptComponent,
+			CircleRendererComponent,
+			Rigidbody2DComponent,
+			BoxCollider2DComponent,
+			CircleCollider2DComponent,
+			PolygonCollider2DComponent,
+			CapsuleCollider2DComponent,
+			EdgeChainCollider2DComponent,
+			Joint2DComponent,
+			TextComponent,
+			ParticleEmitterComponent,
+			AudioSourcesComponent
+		>(m_Registry, srcRegistry, nodes, instances, count);
+
+		// joints between nodes of the prefab connect the nodes of the same instance
+		if (m_Registry.size<Joint2DComponent>() > 0)
+		{
+			std::unordered_map<UUID, size_t> nodeIndices;
+			for (size_t n = 0; n < nodes.size(); n++)
+				nodeIndices[srcRegistry.get<IDComponent>(nodes[n].Handle).ID] = n;
+
+			for (size_t n = 0; n < nodes.size(); n++)
+			{
+				if (!srcRegistry.has<Joint2DComponent>(nodes[n].Handle))
+					continue;
+
+				auto it = nodeIndices.find(srcRegistry.get<Joint2DComponent>(nodes[n].Handle).ConnectedEntity);
+				if (it == nodeIndices.end())
+					continue;
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					auto& joint = Entity(instance((int32_t)n, i), this).GetComponent<Joint2DComponent>();
+					joint.ConnectedEntity = m_Registry.get<IDComponent>(instance((int32_t)it->second, i)).ID;
+				}
+			}
+		}
 
-		CopyComponentIfExists<TransformComponent>(newEntity, entity);
-		CopyComponentIfExists<DisabledComponent>(newEntity, entity);
-		CopyComponentIfExists<CameraComponent>(newEntity, entity);
-		CopyComponentIfExists<SpriteRendererComponent>(newEntity, entity);
-		CopyComponentIfExists<CircleRendererComponent>(newEntity, entity);
-		CopyComponentIfExists<Rigidbody2DComponent>(newEntity, entity);
-		CopyComponentIfExists<BoxCollider2DComponent>(newEntity, entity);
-		CopyComponentIfExists<CircleCollider2DComponent>(newEntity, entity);
-		CopyComponentIfExists<TextComponent>(newEntity, entity);
-		CopyComponentIfExists<ScriptComponent>(newEntity, entity);
-		CopyComponentIfExists<AudioSourcesComponent>(newEntity, entity);
+		for (uint32_t i = 0; i < count; i++)
+			UpdateActiveInHierarchy(Entity{ instances[i], this });
 
-		auto& srcRelation = entity.GetComponent<RelationshipComponent>();
+		const glm::mat4& parentTransform = parent.GetComponent<TransformComponent>().GlobalTransform;
+		for (uint32_t i = 0; i < count; i++)
+			UpdateTransformRecursive(instances[i], parentTransform);
+		for (auto e : instances)
+		{
+			auto& transform = m_Registry.get<TransformComponent>(e);
+			transform.PreviousGlobalTransform = transform.GlobalTransform;
+			transform.SnapInterpolation = true;
+		}
 
-		Entity child = Entity(srcRelation.FirstChild, this);
-		while (child)
+		// Per entity setup, same as OnComponentAdded. Nodes are in pre-order so parents are handled before children.
+		for (auto e : instances)
 		{
-			CreateDuplicationMap(child, map);
-			child = Entity(child.GetComponent<RelationshipComponent>().NextSibling, this);
+			if (m_ViewportWidth > 0 && m_ViewportHeight > 0 && m_Registry.has<CameraComponent>(e))
+				m_Registry.get<CameraComponent>(e).Camera.SetViewportSize(m_ViewportWidth, m_ViewportHeight);
 		}
-		
-		map[entity] = newEntity;
+
+		if (m_PhysicsWorld)
+		{
+			for (auto e : instances)
+			{
+				if (m_Registry.has<Rigidbody2DComponent>(e))
+					CreateRigidbody(Entity{ e, this }, m_PhysicsWorld, this);
+			}
+
+			// colliders without a rigidbody in the prefab attach to one above the instance root
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Entity root = { instances[i], this };
+				if (!root.HasComponent<Rigidbody2DComponent>())
+					AttachColliders(root, root, this);
+			}
+
+			for (auto e : instances)
+			{
+				if (m_Registry.has<Joint2DComponent>(e))
+					CreateJoint(Entity{ e, this });
+			}
+		}
+
+		if (m_Lua)
+		{
+			for (auto e : instances)
+			{
+				if (!m_Registry.has<AudioSourcesComponent>(e))
+					continue;
+
+				for (auto& source : m_Registry.get<AudioSourcesComponent>(e).Sounds)
+				{
+					source.SoundHandle = AudioEngine::LoadSound(Project::GetAssetFileSystemPath(source.FilePath).string(), source.Loop);
+					if (source.PlayOnAwake)
+					{
+						AudioEngine::StartSound(source.SoundHandle, source.Volume, source.Pitch);
+						source.IsPlaying = true;
+					}
+				}
+			}
+
+			// The tree is fully built, safe to run OnCreate
+			for (auto e : instances)
+			{
+				if (m_Registry.has<ScriptComponent>(e))
+					Entity{ e, this }.OnScriptStart();
+			}
+		}
+
+		ENGINE_LOG_INFO("Instantiated prefab '{0}' {1} times ({2} entities) in {3}ms.", prefab.GetName(), count, total, timer.ElapsedMillis());
+
+		return instances;
+	}
+
+	void Scene::CreateDuplicationMap(Entity& entity, std::unordered_map<entt::entity, entt::entity>& map)
+	{
+		if (entity == m_SceneRoot)
+		{
+			ASSERT(false, "Trying duplicate root is not valid.")
+			return;
+		}
+
+		// the new entities are not linked into the tree yet, so they are never visited
+		Hierarchy::ForEachPreOrder(entity, [&](Entity src) {
+			std::string name = src.GetName();
+			ENGINE_LOG_INFO("Duplicating entity {}", name);
+			Entity newEntity = CreateEntity(name);
+
+			CopyComponentIfExists<TransformComponent>(newEntity, src);
+			CopyComponentIfExists<CameraComponent>(newEntity, src);
+			CopyComponentIfExists<SpriteRendererComponent>(newEntity, src);
+			CopyComponentIfExists<CircleRendererComponent>(newEntity, src);
+			CopyComponentIfExists<Rigidbody2DComponent>(newEntity, src);
+			CopyComponentIfExists<BoxCollider2DComponent>(newEntity, src);
+			CopyComponentIfExists<CircleCollider2DComponent>(newEntity, src);
+			CopyComponentIfExists<PolygonCollider2DComponent>(newEntity, src);
+			CopyComponentIfExists<CapsuleCollider2DComponent>(newEntity, src);
+			CopyComponentIfExists<EdgeChainCollider2DComponent>(newEntity, src);
+			CopyComponentIfExists<TextComponent>(newEntity, src);
+			CopyComponentIfExists<ParticleEmitterComponent>(newEntity, src);
+			CopyComponentIfExists<ScriptComponent>(newEntity, src);
+			CopyComponentIfExists<AudioSourcesComponent>(newEntity, src);
+
+			map[src] = newEntity;
+		});
 	}
 
 
@@ -389,6 +707,7 @@ namespace Engine {
 		childRelation.NextSibling = parentRelation.FirstChild;
 		parentRelation.FirstChild = childEntity;
 
+		UpdateActiveInHierarchy(childEntity);
 		UpdateTransformRecursive(childEntity, parentEntity.GetComponent<TransformComponent>().GlobalTransform);
 
 		return childEntity;
@@ -398,8 +717,8 @@ namespace Engine {
 	{
 		Entity entity = { m_Registry.create(), this };
 		entity.AddComponent<IDComponent>(uuid);
-		auto& tag = entity.AddComponent<TagComponent>();
-		tag.Tag = name.empty() ? "Entity" : name;
+		// construct with the name so the tag index sees it
+		entity.AddComponent<TagComponent>(name.empty() ? "Entity" : name);
 		auto& relation = entity.AddComponent<RelationshipComponent>();
 		relation.Parent = m_SceneRoot;
 		entity.AddComponent<TransformComponent>();
@@ -414,22 +733,51 @@ namespace Engine {
 		if (entity == m_SceneRoot)
 			return;
 
-		auto& entityRelation = entity.GetComponent<RelationshipComponent>();
-		
-		if (entityRelation.FirstChild != entt::null)
-		{
-			Entity child = Entity(entityRelation.FirstChild, this);
-			while (child)
-			{
-				// If delete the child, 'child' becomes invalid, and trying to get 'child.GetComponent' in the next line would CRASH.
-				Entity next = { child.GetComponent<RelationshipComponent>().NextSibling, this };
+		std::vector<entt::entity> entities;
+		CollectForDestruction(entity, entities);
+		DestroyEntities(entities);
+	}
 
-				DestroyEntity(child);
+	void Scene::QueueDestroyEntity(Entity entity)
+	{
+		ASSERT(entity.BelongsToScene(this), "This Scene cannot destroy entity of other scene.")
 
-				child = next;
-			}
+		if (entity == m_SceneRoot)
+			return;
+
+		m_DestroyQueue.push_back(entity);
+	}
+
+	void Scene::FlushDestroyQueue()
+	{
+		if (m_DestroyQueue.empty())
+			return;
+
+		std::vector<entt::entity> queue;
+		std::swap(queue, m_DestroyQueue);
+
+		// An entity can be queued more than once, or together with one of its ancestors
+		std::vector<bool> collected(m_Registry.size(), false);
+		std::vector<entt::entity> entities;
+		for (auto handle : queue)
+		{
+			if (!m_Registry.valid(handle) || collected[entt::to_integral(entt::registry::entity(handle))])
+				continue;
+
+			size_t first = entities.size();
+			CollectForDestruction(Entity{ handle, this }, entities);
+			for (size_t i = first; i < entities.size(); i++)
+				collected[entt::to_integral(entt::registry::entity(entities[i]))] = true;
 		}
 
+		DestroyEntities(entities);
+	}
+
+	void Scene::CollectForDestruction(Entity entity, std::vector<entt::entity>& entities)
+	{
+		auto& entityRelation = entity.GetComponent<RelationshipComponent>();
+
+		// Unlink from the parent and siblings, the subtree below is destroyed as a whole
 		if (entityRelation.PrevSibling != entt::null)
 		{
 			Entity prev = Entity(entityRelation.PrevSibling, this);
@@ -448,7 +796,88 @@ namespace Engine {
 			parent.GetComponent<RelationshipComponent>().FirstChild = entityRelation.NextSibling;
 		}
 
-		m_Registry.destroy(entity);
+		// children first
+		Hierarchy::ForEachPostOrder(entity, [&entities](Entity e) {
+			entities.push_back(e);
+		});
+	}
+
+	void Scene::DestroyEntities(const std::vector<entt::entity>& entities)
+	{
+		if (entities.empty())
+			return;
+
+		std::vector<bool> destroyed(m_Registry.size(), false);
+		for (auto e : entities)
+			destroyed[entt::to_integral(entt::registry::entity(e))] = true;
+
+		// Release runtime data. Fixtures attached to a body that survives are removed from it,
+		// destroying a body takes all of its fixtures with it.
+		if (m_PhysicsWorld)
+		{
+			auto destroyFixture = [&](void*& fixture, entt::entity rigidbodyParent) {
+				if (!fixture || rigidbodyParent == entt::null || destroyed[entt::to_integral(entt::registry::entity(rigidbodyParent))])
+					return;
+				if (m_Registry.valid(rigidbodyParent) && m_Registry.has<Rigidbody2DComponent>(rigidbodyParent))
+				{
+					b2Body* body = (b2Body*)m_Registry.get<Rigidbody2DComponent>(rigidbodyParent).RuntimeBody;
+					if (body)
+						m_PhysicsRecorder.DestroyFixture((b2Fixture*)fixture);
+				}
+				fixture = nullptr;
+			};
+
+			for (auto e : entities)
+			{
+				if (auto* bc2d = m_Registry.try_get<BoxCollider2DComponent>(e))
+					destroyFixture(bc2d->RuntimeFixture, bc2d->ClosestRigidbodyParent);
+				if (auto* cc2d = m_Registry.try_get<CircleCollider2DComponent>(e))
+					destroyFixture(cc2d->RuntimeFixture, cc2d->ClosestRigidbodyParent);
+				if (auto* pc2d = m_Registry.try_get<PolygonCollider2DComponent>(e))
+					destroyFixture(pc2d->RuntimeFixture, pc2d->ClosestRigidbodyParent);
+				if (auto* cap2d = m_Registry.try_get<CapsuleCollider2DComponent>(e))
+				{
+					destroyFixture(cap2d->RuntimeFixture, cap2d->ClosestRigidbodyParent);
+					destroyFixture(cap2d->RuntimeCapFixtures[0], cap2d->ClosestRigidbodyParent);
+					destroyFixture(cap2d->RuntimeCapFixtures[1], cap2d->ClosestRigidbodyParent);
+				}
+				if (auto* ec2d = m_Registry.try_get<EdgeChainCollider2DComponent>(e))
+					destroyFixture(ec2d->RuntimeFixture, ec2d->ClosestRigidbodyParent);
+				// joints owned by a destroyed entity may hold bodies that survive
+				if (auto* joint = m_Registry.try_get<Joint2DComponent>(e))
+					DestroyJoint(*joint);
+			}
+
+			for (auto e : entities)
+			{
+				auto* rb2d = m_Registry.try_get<Rigidbody2DComponent>(e);
+				if (rb2d && rb2d->RuntimeBody)
+				{
+					m_PhysicsRecorder.DestroyBody(m_PhysicsWorld, (b2Body*)rb2d->RuntimeBody);
+					rb2d->RuntimeBody = nullptr;
+				}
+			}
+		}
+
+		for (auto e : entities)
+		{
+			auto* audio = m_Registry.try_get<AudioSourcesComponent>(e);
+			if (!audio)
+				continue;
+
+			for (auto& source : audio->Sounds)
+			{
+				if (!source.SoundHandle)
+					continue;
+				if (AudioEngine::IsSoundPlaying(source.SoundHandle))
+					AudioEngine::StopSound(source.SoundHandle);
+				AudioEngine::UnloadSound(source.SoundHandle);
+				source.SoundHandle = nullptr;
+				source.IsPlaying = false;
+			}
+		}
+
+		m_Registry.destroy(entities.begin(), entities.end());
 	}
 
 	bool Scene::IsDescendant(Entity potentialAncestor, Entity potentialDescendant)
@@ -510,6 +939,9 @@ namespace Engine {
 			childRelation.Parent = newParent;
 		}
 
+		// the new parent may be in a different enabled state
+		UpdateActiveInHierarchy(child);
+
 		// update local transform if world transform is to be kept same
 		if (keepWorldTransform)
 		{
@@ -561,26 +993,82 @@ namespace Engine {
 
 	void Scene::UpdateTransformRecursive(entt::entity entity, const glm::mat4& parentTransform)
 	{
-		// Optimization: dont propogate down disabled hierarchy
-		if (m_Registry.has<DisabledComponent>(entity))
-			return;
-		// Calculate Global = Parent * Local
-		// (Optimization: If entity == m_SceneRoot, we know it's Identity, but the math holds up anyway)
-		auto& tc = m_Registry.get<TransformComponent>(entity);
-		tc.GlobalTransform = parentTransform * tc.GetTransform();
+		Hierarchy::ForEachPreOrder(Entity{ entity, this }, [&](Entity current) {
+			// Optimization: dont propogate down disabled hierarchy
+			auto& tc = m_Registry.get<TransformComponent>(current);
+			if (!tc.ActiveInHierarchy)
+				return false;
+
+			// Calculate Global = Parent * Local. Parents are visited first, so their global transform is already up to date.
+			// (Optimization: If entity == m_SceneRoot, we know it's Identity, but the math holds up anyway)
+			const glm::mat4 previous = tc.GlobalTransform;
+			if (current == entity)
+				tc.GlobalTransform = parentTransform * tc.GetTransform();
+			else
+				tc.GlobalTransform = m_Registry.get<TransformComponent>(m_Registry.get<RelationshipComponent>(current).Parent).GlobalTransform * tc.GetTransform();
+
+			// The spatial index is only queried by scripts, it is kept while they run. Only entities that moved
+			// (or are not indexed yet) are updated, static ones cost the comparison.
+			if (m_Lua && current != m_SceneRoot && (tc.GlobalTransform != previous || !m_SpatialIndex.Contains(current)))
+			{
+				glm::vec2 min, max;
+				GetWorldBounds(tc.GlobalTransform, min, max);
+				m_SpatialIndex.Update(current, min, max);
+			}
+			return true;
+		});
+	}
 
-		// Iterate the Linked List of Children
-		auto& rel = m_Registry.get<RelationshipComponent>(entity);
-		entt::entity child = rel.FirstChild;
+	void Scene::UpdateActiveInHierarchy(Entity entity)
+	{
+		Hierarchy::ForEachPreOrder(entity, [&](Entity current) {
+			const auto& tc = m_Registry.get<TransformComponent>(current);
+			entt::entity parent = m_Registry.get<RelationshipComponent>(current).Parent;
+			bool parentActive = parent == entt::null || m_Registry.get<TransformComponent>(parent).ActiveInHierarchy;
+			bool active = tc.Enabled && parentActive;
 
-		while (child != entt::null)
-		{
-			// Recursion
-			UpdateTransformRecursive(child, tc.GlobalTransform);
+			// Parents are visited first. If the state did not change, nothing below can change either.
+			if (tc.ActiveInHierarchy == active)
+				return false;
 
-			// Next Sibling
-			child = m_Registry.get<RelationshipComponent>(child).NextSibling;
-		}
+			// fetched through the entity so the snapshot sees the change
+			auto& transform = current.GetComponent<TransformComponent>();
+			transform.ActiveInHierarchy = active;
+
+			if (current.HasComponent<Rigidbody2DComponent>())
+			{
+				b2Body* body = static_cast<b2Body*>(current.GetComponent<Rigidbody2DComponent>().RuntimeBody);
+				if (body)
+					m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetEnabled(active));
+			}
+
+			if (active)
+			{
+				// global transform was not updated while inactive
+				const glm::mat4 parentTransform = parent == entt::null ? glm::mat4(1.0f) : m_Registry.get<TransformComponent>(parent).GlobalTransform;
+				transform.GlobalTransform = parentTransform * transform.GetTransform();
+				// and must not be interpolated from either
+				transform.SnapInterpolation = true;
+
+				if (m_Lua)
+				{
+					glm::vec2 min, max;
+					GetWorldBounds(transform.GlobalTransform, min, max);
+					m_SpatialIndex.Update(current, min, max);
+				}
+
+				if (m_PhysicsWorld)
+					current.AttachFixturesToRigidbodyParent();
+			}
+			else
+			{
+				// inactive entities are not found by spatial queries
+				m_SpatialIndex.Remove(current);
+				if (m_PhysicsWorld)
+					current.DetachFixturesFromRigidbodyParent();
+			}
+			return true;
+		});
 	}
 
 	void Scene::SyncPhysicsToTransform(Entity entity)
@@ -606,16 +1094,20 @@ namespace Engine {
 					ASSERT(false, "Could not decompose transform.");
 					return;
 				}
-				body->SetTransform(b2Vec2(translation.x, translation.y), rotation.z);
-				body->SetAwake(true);
+				m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetTransform({ translation.x, translation.y }, rotation.z));
+				m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetAwake(true));
+				rb2d.RuntimeSyncedPosition = { translation.x, translation.y };
+				rb2d.RuntimeSyncedAngle = rotation.z;
 
+				// a teleport moves the fixtures with the body, only colliders whose placement on it changed
+				// (scale, or children moved relative to it) are rebuilt
 				AttachColliders(entity, entity, this);
 			}
 			return;
 		}
 
-		entity.AttachFixturesToRigidbodyParent();
-		
+		// the entity moved relative to its body, and its descendants with it
+		AttachColliders(entity, entity, this);
 	}
 
 	void Scene::OnRuntimeStart()
@@ -648,10 +1140,13 @@ namespace Engine {
 
 		OnScriptingStart();
 		UpdateGlobalTransforms();
+		SnapshotTransforms();
+		m_FixedTimeAccumulator = 0.0f;
 	}
 
 	void Scene::OnRuntimeStop()
 	{
+		m_DestroyQueue.clear();
 		OnScriptingStop();
 		OnPhysics2DStop();
 		// Clean up memory when the scene ends to prevent memory leaks!
@@ -674,6 +1169,8 @@ namespace Engine {
 	{
 		UpdateGlobalTransforms();
 		OnPhysics2DStart();
+		SnapshotTransforms();
+		m_FixedTimeAccumulator = 0.0f;
 	}
 
 	void Scene::OnSimulationStop()
@@ -683,17 +1180,21 @@ namespace Engine {
 
 	void Scene::OnUpdateRuntime(float ts)
 	{
-		// Update scripts
-		RunScripts(ts);
+		Timer updateTimer;
+		m_Stats = Statistics();
+		for (auto& script : m_ScriptStats)
+		{
+			script.Updates = 0;
+			script.UpdateTime = 0.0f;
+		}
 
-		// Update global transforms
-		UpdateGlobalTransforms();
+		// Scripts and physics
+		m_Stats.FixedSteps = StepFixed(ts, true);
 
-		// Physics
-		OnUpdatePhysics2D(ts);
+		// Entities destroyed by scripts or collision callbacks during the steps above
+		FlushDestroyQueue();
 
-		// Update global transforms
-		UpdateGlobalTransforms();
+		UpdateParticles(ts);
 
 		auto audioView = m_Registry.view<AudioSourcesComponent>();
 		for (auto entityID : audioView)
@@ -722,39 +1223,65 @@ namespace Engine {
 			if (primaryCamera)
 			{
 				mainCamera = &primaryCamera.GetComponent<CameraComponent>().Camera;
-				cameraTransform = primaryCamera.GetComponent<TransformComponent>().GlobalTransform;
+				cameraTransform = GetRenderTransform(primaryCamera.GetComponent<TransformComponent>());
 			}
 		}
 
+		// Nothing below touches the physics world, step it while the frame renders
+		LaunchPhysicsStep();
+
 		if (mainCamera)
 		{
 			// Render
+			Timer renderTimer;
 			Renderer2D::BeginScene(*mainCamera, cameraTransform);
 
 			RenderScene();
 
 			Renderer2D::EndScene();
+			m_Stats.RenderTime = renderTimer.ElapsedMillis();
 		}
+
+		// the world is free again once the frame is done, the editor and scripts can use it
+		WaitForPhysicsStep();
+
+		m_Stats.UpdateTime = updateTimer.ElapsedMillis();
 	}
 
 	void Scene::OnUpdateSimulation(float ts, EditorCamera& camera)
 	{
+		Timer updateTimer;
+		m_Stats = Statistics();
+
 		// Physics
-		OnUpdatePhysics2D(ts);
-		
-		// Update global transforms
+		m_Stats.FixedSteps = StepFixed(ts, false);
+		FlushDestroyQueue();
+		UpdateParticles(ts);
+
+		// Update global transforms (entities can still be moved from the editor while simulating)
 		UpdateGlobalTransforms();
+
+		LaunchPhysicsStep();
 		
 		// Render
+		Timer renderTimer;
 		Renderer2D::BeginScene(camera);
 
 		RenderScene();
 
 		Renderer2D::EndScene();
+		m_Stats.RenderTime = renderTimer.ElapsedMillis();
+
+		WaitForPhysicsStep();
+
+		m_Stats.UpdateTime = updateTimer.ElapsedMillis();
 	}
 
 	void Scene::OnUpdateEditor(float ts, EditorCamera& camera)
 	{
+		// Nothing is simulated in editor, always render the current state
+		m_InterpolationAlpha = 1.0f;
+
 		// Update global transforms
 		UpdateGlobalTransforms();
 
@@ -766,11 +1293,88 @@ namespace Engine {
 		Renderer2D::EndScene();
 	}
 
+	uint32_t Scene::StepFixed(float ts, bool runScripts)
+	{
+		const float fixedTs = 1.0f / (float)std::max(m_FixedUpdateRate, 1u);
+		const uint32_t maxSubSteps = std::max(m_MaxSubSteps, 1u);
+		m_FixedTimeAccumulator += ts;
+
+		uint32_t steps = 0;
+		while (m_FixedTimeAccumulator >= fixedTs && steps < maxSubSteps)
+		{
+			// the previous step may still have its physics results to apply (pipelined mode)
+			if (m_QueuedPhysicsStep > 0.0f || m_PhysicsResultsPending)
+				CompletePhysicsStep();
+			else
+				SnapshotTransforms();
+
+			if (runScripts)
+			{
+				Timer scriptTimer;
+				RunScripts(fixedTs);
+				UpdateGlobalTransforms();
+				m_Stats.ScriptTime += scriptTimer.ElapsedMillis();
+			}
+
+			if (m_PipelinedPhysics)
+			{
+				// stepped on the worker by LaunchPhysicsStep, or right here by the next fixed step
+				m_QueuedPhysicsStep = fixedTs;
+			}
+			else
+			{
+				Timer physicsTimer;
+				OnUpdatePhysics2D(fixedTs);
+				UpdateGlobalTransforms();
+				m_Stats.PhysicsTime += physicsTimer.ElapsedMillis();
+			}
+
+			m_FixedTimeAccumulator -= fixedTs;
+			steps++;
+		}
+
+		// Ran out of sub steps: drop the time we could not simulate instead of carrying it into the next frame
+		if (m_FixedTimeAccumulator >= fixedTs)
+			m_FixedTimeAccumulator = std::fmod(m_FixedTimeAccumulator, fixedTs);
+
+		m_InterpolationAlpha = m_InterpolateTransforms ? m_FixedTimeAccumulator / fixedTs : 1.0f;
+		return steps;
+	}
+
+	void Scene::SnapshotTransforms()
+	{
+		auto view = m_Registry.view<TransformComponent>();
+		for (auto e : view)
+		{
+			auto& transform = view.get<TransformComponent>(e);
+			transform.PreviousGlobalTransform = transform.GlobalTransform;
+			transform.SnapInterpolation = false;
+		}
+	}
+
+	glm::mat4 Scene::GetRenderTransform(const TransformComponent& transform) const
+	{
+		if (m_InterpolationAlpha >= 1.0f || transform.SnapInterpolation)
+			return transform.GlobalTransform;
+
+		return InterpolateTransform(transform.PreviousGlobalTransform, transform.GlobalTransform, m_InterpolationAlpha);
+	}
+
 	void Scene::OnPhysics2DStart()
 	{
+		// the recording starts with the world, so it holds everything needed to rebuild it
+		if (!m_PhysicsRecordingPath.empty())
+			m_PhysicsRecorder.Start(m_PhysicsRecordingPath, m_Acc);
+
 		m_PhysicsWorld = new b2World({ m_Acc.x, m_Acc.y });
 		m_ContactListener = new PhysicsContactListener(this);
 		m_PhysicsWorld->SetContactListener(m_ContactListener);
+		m_DestructionListener = new JointDestructionListener(m_Registry);
+		m_PhysicsWorld->SetDestructionListener(m_DestructionListener);
+
+		// static anchor for joints connected to the world and for mouse joints
+		b2BodyDef groundDef;
+		m_GroundBody = m_PhysicsRecorder.CreateBody(m_PhysicsWorld, groundDef);
 
 		auto view = m_Registry.view<Rigidbody2DComponent>();
 		for (auto e : view)
@@ -778,43 +1382,290 @@ namespace Engine {
 			Entity entity = { e, this };
 			CreateRigidbody(entity, m_PhysicsWorld, this);
 		}
+
+		// joints last, they need the bodies on both sides
+		for (auto e : m_Registry.view<Joint2DComponent>())
+			CreateJoint(Entity{ e, this });
 	}
 
 	void Scene::OnPhysics2DStop()
 	{
+		// a step still queued or not applied is dropped with the world
+		WaitForPhysicsStep();
+		m_QueuedPhysicsStep = 0.0f;
+		m_PhysicsResultsPending = false;
+
+		m_PhysicsRecorder.Stop(m_PhysicsWorld);
 		delete m_PhysicsWorld;
 		m_PhysicsWorld = nullptr;
+		m_GroundBody = nullptr;
 
 		delete m_ContactListener;
 		m_ContactListener = nullptr;
+
+		delete m_DestructionListener;
+		m_DestructionListener = nullptr;
+	}
+
+	void Scene::CreateJoint(Entity entity)
+	{
+		auto& joint = entity.GetComponent<Joint2DComponent>();
+		DestroyJoint(joint);
+
+		Entity bodyEntity = entity.ClosestRigidbodyParent();
+		b2Body* body = bodyEntity ? (b2Body*)bodyEntity.GetComponent<Rigidbody2DComponent>().RuntimeBody : nullptr;
+		if (!body)
+		{
+			ENGINE_LOG_WARN("Joint of '{0}' has no rigidbody to attach to.", entity.GetName());
+			return;
+		}
+
+		const glm::mat4& transform = entity.GetComponent<TransformComponent>().GlobalTransform;
+		b2Vec2 anchor = ToWorldPoint(transform, joint.Anchor);
+
+		b2Body* connectedBody = m_GroundBody;
+		b2Vec2 connectedAnchor = b2Vec2(joint.ConnectedAnchor.x, joint.ConnectedAnchor.y);
+		if (joint.Type != Joint2DComponent::JointType::Mouse && joint.ConnectedEntity != 0)
+		{
+			Entity connected = FindEntityByUUID(joint.ConnectedEntity);
+			Entity connectedBodyEntity = connected ? connected.ClosestRigidbodyParent() : Entity{};
+			connectedBody = connectedBodyEntity ? (b2Body*)connectedBodyEntity.GetComponent<Rigidbody2DComponent>().RuntimeBody : nullptr;
+			if (!connectedBody)
+			{
+				ENGINE_LOG_WARN("Joint of '{0}' is connected to an entity without a rigidbody.", entity.GetName());
+				return;
+			}
+			connectedAnchor = ToWorldPoint(connected.GetComponent<TransformComponent>().GlobalTransform, joint.ConnectedAnchor);
+		}
+
+		if (connectedBody == body)
+		{
+			ENGINE_LOG_WARN("Joint of '{0}' connects a rigidbody to itself.", entity.GetName());
+			return;
+		}
+
+		b2Joint* created = nullptr;
+		switch (joint.Type)
+		{
+		case Joint2DComponent::JointType::Revolute:
+		{
+			b2RevoluteJointDef def;
+			def.bodyA = body;
+			def.bodyB = connectedBody;
+			def.localAnchorA = body->GetLocalPoint(anchor);
+			def.localAnchorB = connectedBody->GetLocalPoint(connectedAnchor);
+			def.referenceAngle = connectedBody->GetAngle() - body->GetAngle();
+			def.enableLimit = joint.EnableLimit;
+			def.lowerAngle = joint.LowerLimit;
+			def.upperAngle = joint.UpperLimit;
+			def.enableMotor = joint.EnableMotor;
+			def.motorSpeed = joint.MotorSpeed;
+			def.maxMotorTorque = joint.MaxMotorForce;
+			def.collideConnected = joint.CollideConnected;
+			def.userData.pointer = (uintptr_t)(uint32_t)entity;
+			created = m_PhysicsRecorder.CreateJoint(m_PhysicsWorld, def);
+			break;
+		}
+		case Joint2DComponent::JointType::Distance:
+		{
+			b2DistanceJointDef def;
+			def.bodyA = body;
+			def.bodyB = connectedBody;
+			def.localAnchorA = body->GetLocalPoint(anchor);
+			def.localAnchorB = connectedBody->GetLocalPoint(connectedAnchor);
+			def.length = joint.Length >= 0.0f ? joint.Length : b2Distance(anchor, connectedAnchor);
+			def.minLength = joint.MinLength >= 0.0f ? joint.MinLength : def.length;
+			def.maxLength = joint.MaxLength >= 0.0f ? joint.MaxLength : def.length;
+			b2LinearStiffness(def.stiffness, def.damping, joint.Frequency, joint.DampingRatio, body, connectedBody);
+			def.collideConnected = joint.CollideConnected;
+			def.userData.pointer = (uintptr_t)(uint32_t)entity;
+			created = m_PhysicsRecorder.CreateJoint(m_PhysicsWorld, def);
+			break;
+		}
+		case Joint2DComponent::JointType::Prismatic:
+		{
+			glm::vec2 axis = glm::mat2(transform) * joint.Axis;
+			if (glm::dot(axis, axis) < b2_epsilon)
+				axis = { 1.0f, 0.0f };
+
+			b2PrismaticJointDef def;
+			def.bodyA = body;
+			def.bodyB = connectedBody;
+			def.localAnchorA = body->GetLocalPoint(anchor);
+			def.localAnchorB = connectedBody->GetLocalPoint(connectedAnchor);
+			def.localAxisA = body->GetLocalVector(b2Vec2(axis.x, axis.y));
+			def.localAxisA.Normalize();
+			def.referenceAngle = connectedBody->GetAngle() - body->GetAngle();
+			def.enableLimit = joint.EnableLimit;
+			def.lowerTranslation = joint.LowerLimit;
+			def.upperTranslation = joint.UpperLimit;
+			def.enableMotor = joint.EnableMotor;
+			def.motorSpeed = joint.MotorSpeed;
+			def.maxMotorForce = joint.MaxMotorForce;
+			def.collideConnected = joint.CollideConnected;
+			def.userData.pointer = (uintptr_t)(uint32_t)entity;
+			created = m_PhysicsRecorder.CreateJoint(m_PhysicsWorld, def);
+			break;
+		}
+		case Joint2DComponent::JointType::Weld:
+		{
+			b2WeldJointDef def;
+			def.bodyA = body;
+			def.bodyB = connectedBody;
+			def.localAnchorA = body->GetLocalPoint(anchor);
+			def.localAnchorB = connectedBody->GetLocalPoint(connectedAnchor);
+			def.referenceAngle = connectedBody->GetAngle() - body->GetAngle();
+			b2AngularStiffness(def.stiffness, def.damping, joint.Frequency, joint.DampingRatio, body, connectedBody);
+			def.collideConnected = joint.CollideConnected;
+			def.userData.pointer = (uintptr_t)(uint32_t)entity;
+			created = m_PhysicsRecorder.CreateJoint(m_PhysicsWorld, def);
+			break;
+		}
+		case Joint2DComponent::JointType::Mouse:
+		{
+			// grabs the body at the anchor, then pulls it to the target
+			b2MouseJointDef def;
+			def.bodyA = m_GroundBody;
+			def.bodyB = body;
+			def.target = anchor;
+			def.maxForce = joint.MaxForce;
+			b2LinearStiffness(def.stiffness, def.damping, joint.Frequency > 0.0f ? joint.Frequency : 5.0f, joint.DampingRatio, m_GroundBody, body);
+			def.collideConnected = joint.CollideConnected;
+			def.userData.pointer = (uintptr_t)(uint32_t)entity;
+			created = m_PhysicsRecorder.CreateJoint(m_PhysicsWorld, def);
+			m_PhysicsRecorder.UpdateJoint(created, joint);
+			break;
+		}
+		}
+
+		joint.RuntimeJoint = created;
+	}
+
+	void Scene::DestroyJoint(Joint2DComponent& joint)
+	{
+		if (joint.RuntimeJoint && m_PhysicsWorld)
+			m_PhysicsRecorder.DestroyJoint(m_PhysicsWorld, (b2Joint*)joint.RuntimeJoint);
+		joint.RuntimeJoint = nullptr;
+	}
+
+	void Scene::UpdateJoint(Joint2DComponent& joint)
+	{
+		if (joint.RuntimeJoint)
+			m_PhysicsRecorder.UpdateJoint((b2Joint*)joint.RuntimeJoint, joint);
 	}
 
 	void Scene::OnUpdatePhysics2D(float ts)
 	{
-		
+		StepPhysicsWorld(ts);
+		ApplyPhysicsResults();
+	}
+
+	void Scene::StepPhysicsWorld(float ts)
+	{
 		const int32_t velocityIterations = 6;
 		const int32_t positionIterations = 2;
-		m_PhysicsWorld->Step(ts, velocityIterations, positionIterations);
+		m_PhysicsRecorder.Step(m_PhysicsWorld, ts, velocityIterations, positionIterations);
+	}
+
+	void Scene::LaunchPhysicsStep()
+	{
+		if (m_QueuedPhysicsStep <= 0.0f || !m_PhysicsWorld)
+			return;
+
+		if (!m_PhysicsWorker)
+			m_PhysicsWorker = std::make_unique<WorkerThread>();
+
+		// The contact listener reads collider components from the worker. Make sure their pools exist,
+		// creating one from the worker would modify the registry while the frame is rendered.
+		m_Registry.size<BoxCollider2DComponent>();
+		m_Registry.size<CircleCollider2DComponent>();
+		m_Registry.size<PolygonCollider2DComponent>();
+		m_Registry.size<CapsuleCollider2DComponent>();
+		m_Registry.size<EdgeChainCollider2DComponent>();
+
+		const float ts = m_QueuedPhysicsStep;
+		m_QueuedPhysicsStep = 0.0f;
+		m_PhysicsResultsPending = true;
+		m_PhysicsWorker->Submit([this, ts]() {
+			Timer workerTimer;
+			StepPhysicsWorld(ts);
+			m_Stats.PhysicsWorkerTime += workerTimer.ElapsedMillis();
+		});
+	}
+
+	void Scene::WaitForPhysicsStep()
+	{
+		if (!m_PhysicsWorker)
+			return;
+
+		Timer waitTimer;
+		m_PhysicsWorker->Wait();
+		m_Stats.PhysicsWaitTime += waitTimer.ElapsedMillis();
+	}
+
+	void Scene::CompletePhysicsStep()
+	{
+		WaitForPhysicsStep();
+
+		Timer physicsTimer;
+		// queued by a fixed step of this frame, nothing rendered in between so there is nothing to overlap with
+		if (m_QueuedPhysicsStep > 0.0f && m_PhysicsWorld)
+		{
+			StepPhysicsWorld(m_QueuedPhysicsStep);
+			m_PhysicsResultsPending = true;
+		}
+		m_QueuedPhysicsStep = 0.0f;
+
+		// interpolate from the last presented physics state to the one being applied
+		SnapshotTransforms();
+		if (m_PhysicsResultsPending && m_PhysicsWorld)
+		{
+			ApplyPhysicsResults();
+			UpdateGlobalTransforms();
+		}
+		m_PhysicsResultsPending = false;
+		m_Stats.PhysicsTime += physicsTimer.ElapsedMillis();
+	}
+
+	void Scene::ApplyPhysicsResults()
+	{
 		// Fire pending callbacks
-		m_ContactListener->FireCallbacks();
+		m_Stats.ContactEvents += m_ContactListener->FireCallbacks();
 
-		// Retrieve transform from Box2D
-		auto view = m_Registry.view<Rigidbody2DComponent>();
-		for (auto e : view)
+		// Retrieve transform from Box2D.
+		// Only awake bodies can have moved, and Box2D keeps its own body list, so sleeping and static bodies cost nothing here.
+		m_ParentSpaceCache.clear();
+		for (b2Body* body = m_PhysicsWorld->GetBodyList(); body; body = body->GetNext())
 		{
-			Entity entity = { e, this };
-			auto& rb2d = entity.GetComponent<Rigidbody2DComponent>();
-			
-			if (rb2d.Type == Rigidbody2DComponent::BodyType::Static)
-				continue;	// skip calculations for static body for optimization
+			if (body->GetType() == b2_staticBody || !body->IsAwake() || !body->IsEnabled())
+				continue;
 
-			auto& transform = entity.GetComponent<TransformComponent>();
-			auto& parentTransform = Entity(entity.GetComponent<RelationshipComponent>().Parent, this).GetComponent<TransformComponent>();
+			entt::entity e = (entt::entity)(uint32_t)body->GetUserData().pointer;
+			auto& rb2d = m_Registry.get<Rigidbody2DComponent>(e);
 
-			b2Body* body = (b2Body*)rb2d.RuntimeBody;
-			const auto& position = body->GetPosition();
+			const b2Vec2& position = body->GetPosition();
+			const float angle = body->GetAngle();
+			if (position.x == rb2d.RuntimeSyncedPosition.x && position.y == rb2d.RuntimeSyncedPosition.y && angle == rb2d.RuntimeSyncedAngle)
+				continue;	// awake but resting
+			rb2d.RuntimeSyncedPosition = { position.x, position.y };
+			rb2d.RuntimeSyncedAngle = angle;
 
-			glm::mat4 inverseParent = glm::inverse(parentTransform.GlobalTransform);
+			// siblings share the parent's inverse, compute it once per step
+			entt::entity parent = m_Registry.get<RelationshipComponent>(e).Parent;
+			auto it = m_ParentSpaceCache.find(parent);
+			if (it == m_ParentSpaceCache.end())
+			{
+				const glm::mat4& parentGlobal = m_Registry.get<TransformComponent>(parent).GlobalTransform;
+
+				// We don't care about Position/Scale here, just Rotation.
+				glm::vec3 pPos, pRot, pScale;
+				Math::DecomposeTransform(parentGlobal, pPos, pRot, pScale);
+				it = m_ParentSpaceCache.emplace(parent, std::make_pair(glm::inverse(parentGlobal), pRot.z)).first;
+			}
+			const auto& [inverseParent, parentAngle] = it->second;
+
+			// through Entity so the snapshot sees the change
+			auto& transform = Entity(e, this).GetComponent<TransformComponent>();
 
 			// Apply Inverse to the Box2D World Position. This subtracts the parent's position, rotation, and scale mathematically
 			glm::vec4 localPos = inverseParent * glm::vec4(glm::vec3{position.x, position.y, transform.Translation.z}, 1.0f);
@@ -822,14 +1673,11 @@ namespace Engine {
 			transform.Translation.x = localPos.x;
 			transform.Translation.y = localPos.y;
 
-			// We don't care about Position/Scale here, just Rotation.
-			glm::vec3 pPos, pRot, pScale;
-			Math::DecomposeTransform(parentTransform.GlobalTransform, pPos, pRot, pScale);
-
 			// New Local = Child World - Parent World
-			transform.Rotation.z = body->GetAngle() - pRot.z;
+			transform.Rotation.z = angle - parentAngle;
+			m_Stats.SyncedBodies++;
 		}
-		
+
 	}
 
 	void Scene::OnScriptingStart()
@@ -853,6 +1701,9 @@ namespace Engine {
 		// bind lua types and functions
 		BindLuaTypesAndFunctions(m_Lua, this);
 
+		// index every active entity for the spatial queries, before scripts can run them
+		UpdateGlobalTransforms();
+
 		// Iterate all entities with scripts
 		auto view = m_Registry.view<ScriptComponent, TagComponent>();
 		for (auto e : view)
@@ -867,97 +1718,335 @@ namespace Engine {
 		auto view = m_Registry.view<ScriptComponent>();
 		for (auto e : view)
 		{
-			auto& sc = view.get<ScriptComponent>(e);
-
 			// Check if instance exists
-			if (sc.Instance.valid())
+			if (view.get<ScriptComponent>(e).Instance.valid())
 			{
-				// Call OnDestroy(self)
-				if (sc.Instance["OnDestroy"].valid())
+				// Call OnDestroy(self), copied as the component may move while it runs
+				sol::protected_function onDestroy = view.get<ScriptComponent>(e).OnDestroy;
+				if (onDestroy.valid())
 				{
 					// We must pass 'sc.Instance' as the first argument to simulate ':' call
-					sc.Instance["OnDestroy"](sc.Instance);
+					sol::protected_function_result result = onDestroy(view.get<ScriptComponent>(e).Instance);
+					if (!result.valid())
+					{
+						sol::error err = result;
+						ENGINE_LOG_ERROR("Script Error in OnDestroy: {0}", err.what());
+					}
 				}
 			}
 
 			// Assigning a default (empty) table disconnects it from the Lua State.
+			auto& sc = view.get<ScriptComponent>(e);
 			sc.Instance = sol::nil;
+			sc.OnUpdate = sol::nil;
+			sc.OnCollisionBegin = sol::nil;
+			sc.OnCollisionEnd = sol::nil;
+			sc.OnDestroy = sol::nil;
 		}
 
+		m_ScriptTime = 0.0;
+		m_EveryStepScripts.clear();
+		m_ScheduledScripts = {};
+		m_ScriptStats.clear();
+		m_ScriptStatsIndex.clear();
+		m_ScriptBatches.clear();
+		m_ScriptBatchIndex.clear();
+		m_SpatialIndex.Clear();
+
 		// IMPORTANT : DO NOT REMOVE
 		// clear runtime function registry
 		RuntimeData::ClearFunctionRegistry();
 		m_ScriptCache.clear();
+		m_PrefabCache.clear();
 		delete m_Lua;
 		m_Lua = nullptr;
 	}
 
 	void Scene::RunScripts(float ts)
 	{
-		// Update Scripts
-		auto view = m_Registry.view<ScriptComponent>();
-		for (auto e : view)
+		m_ScriptTime += ts;
+
+		// the script still scheduled as 'update' was, null if it was destroyed or rescheduled since
+		auto getScheduled = [&](const ScriptUpdate& update) -> ScriptComponent* {
+			auto* sc = m_Registry.valid(update.Entity) ? m_Registry.try_get<ScriptComponent>(update.Entity) : nullptr;
+			if (!sc || !sc->Instance.valid() || sc->RuntimeScheduleGeneration != update.Generation)
+				return nullptr;
+			return sc;
+		};
+
+		auto callUpdate = [&](entt::entity e, ScriptComponent& sc, float scriptTs) {
+			// disabled (and pooled) entities are not updated
+			if (!m_Registry.get<TransformComponent>(e).ActiveInHierarchy)
+				return;
+
+			sc.RuntimeLastUpdate = m_ScriptTime;
+			// the script may add scripts, 'sc' is not to be used once it runs
+			const uint32_t statsIndex = sc.RuntimeStatsIndex;
+			Timer timer;
+
+			// Copied, the component moves if the script adds scripts. A copy is a registry reference, not a lookup.
+			sol::protected_function onUpdate = sc.OnUpdate;
+
+			// Call the function and capture the result
+			sol::protected_function_result result = onUpdate(sc.Instance, scriptTs);
+
+			// Check if the script crashed
+			if (!result.valid())
+			{
+				sol::error err = result;
+				// LOG_ERROR("Lua Error: {0}", err.what()); // Use your engine logger
+				std::cout << "Lua Error: " << err.what() << std::endl;
+			}
+
+			ScriptStatistics& stats = m_ScriptStats[statsIndex];
+			stats.Updates++;
+			stats.UpdateTime += timer.ElapsedMillis();
+		};
+
+		// Every step scripts, in the order they were scheduled. Scripts scheduled by these start next step.
+		const size_t count = m_EveryStepScripts.size();
+		size_t kept = 0;
+		for (size_t i = 0; i < count; i++)
 		{
-			auto& sc = view.get<ScriptComponent>(e);
+			const ScriptUpdate update = m_EveryStepScripts[i];
+			ScriptComponent* sc = getScheduled(update);
+			if (!sc)
+				continue;
 
-			// Check if instance exists
-			if (!sc.Instance.valid())
+			m_EveryStepScripts[kept++] = update;
+			callUpdate(update.Entity, *sc, ts);
+		}
+		m_EveryStepScripts.erase(m_EveryStepScripts.begin() + kept, m_EveryStepScripts.begin() + count);
+
+		// Batched classes, one OnUpdateAll call with the instances of their active every step scripts.
+		// Indexed, scripts may add classes (they start next step) and move the batches.
+		const size_t batchCount = m_ScriptBatches.size();
+		for (size_t b = 0; b < batchCount; b++)
+		{
+			ScriptBatch& batch = m_ScriptBatches[b];
+
+			m_BatchScratch.clear();
+			size_t members = 0;
+			for (const ScriptUpdate& update : batch.Members)
+			{
+				if (!getScheduled(update))
+					continue;
+
+				batch.Members[members++] = update;
+				// disabled (and pooled) entities are left out
+				if (m_Registry.get<TransformComponent>(update.Entity).ActiveInHierarchy)
+					m_BatchScratch.emplace_back(update.Entity, update.Generation);
+			}
+			batch.Members.resize(members);
+
+			// The array stays the same from step to step unless scripts come, go, restart, or are enabled or disabled.
+			// A length change means a script broke the read only contract, the array is rebuilt rather than handed back.
+			const size_t arrayLength = batch.Instances.size();
+			if (m_BatchScratch != batch.Active || arrayLength != batch.Active.size())
+			{
+				for (size_t i = 0; i < m_BatchScratch.size(); i++)
+					batch.Instances[i + 1] = m_Registry.get<ScriptComponent>(m_BatchScratch[i].first).Instance;
+				for (size_t i = m_BatchScratch.size(); i < std::max(batch.Active.size(), arrayLength); i++)
+					batch.Instances[i + 1] = sol::nil;
+				batch.Active.swap(m_BatchScratch);
+			}
+
+			if (batch.Active.empty())
+				continue;
+
+			const uint32_t statsIndex = batch.StatsIndex;
+			const uint32_t updates = (uint32_t)batch.Active.size();
+			Timer timer;
+
+			// Copied, the batch moves if the script adds a batched class
+			sol::protected_function onUpdateAll = batch.OnUpdateAll;
+			sol::protected_function_result result = onUpdateAll(batch.Class, batch.Instances, ts);
+
+			if (!result.valid())
+			{
+				sol::error err = result;
+				ENGINE_LOG_ERROR("Script Error in OnUpdateAll: {0}", err.what());
+			}
+
+			ScriptStatistics& stats = m_ScriptStats[statsIndex];
+			stats.Updates += updates;
+			stats.UpdateTime += timer.ElapsedMillis();
+		}
+
+		// Interval and on demand scripts that are due. Taken out first, so updates they schedule wait for the next step.
+		m_DueScripts.clear();
+		while (!m_ScheduledScripts.empty() && m_ScheduledScripts.top().Due <= m_ScriptTime)
+		{
+			m_DueScripts.push_back(m_ScheduledScripts.top());
+			m_ScheduledScripts.pop();
+		}
+
+		for (const ScriptUpdate& update : m_DueScripts)
+		{
+			ScriptComponent* sc = getScheduled(update);
+			if (!sc)
 				continue;
 
-			// Use protected_function to catch errors
-			if (sc.Instance["OnUpdate"].valid())
+			// scheduled before running, so a script changing its schedule from OnUpdate drops it again
+			if (update.Repeats)
 			{
-				sol::protected_function onUpdate = sc.Instance["OnUpdate"];
+				ScriptUpdate next = update;
+				next.Due = std::max(update.Due + sc->RuntimeUpdateInterval, m_ScriptTime);
+				m_ScheduledScripts.push(next);
+			}
+			callUpdate(update.Entity, *sc, (float)(m_ScriptTime - sc->RuntimeLastUpdate));
+		}
+	}
 
-				// Call the function and capture the result
-				sol::protected_function_result result = onUpdate(sc.Instance, ts);
+	void Scene::ScheduleScript(Entity entity)
+	{
+		auto& sc = entity.GetComponent<ScriptComponent>();
+		sc.RuntimeScheduleGeneration++;
+		sc.RuntimeLastUpdate = m_ScriptTime;
 
-				// Check if the script crashed
-				if (!result.valid())
+		auto [it, inserted] = m_ScriptStatsIndex.try_emplace(sc.ScriptPath, (uint32_t)m_ScriptStats.size());
+		if (inserted)
+			m_ScriptStats.push_back({ sc.ScriptPath });
+		sc.RuntimeStatsIndex = it->second;
+
+		if (sc.RuntimeSchedule == ScriptComponent::UpdateSchedule::EveryStep)
+		{
+			// looked up once per script file, the class is cached by OnScriptStart before it schedules
+			auto [batchIt, batchInserted] = m_ScriptBatchIndex.try_emplace(sc.ScriptPath, NoScriptBatch);
+			if (batchInserted)
+			{
+				auto cached = m_ScriptCache.find(Project::GetAssetFileSystemPath(sc.ScriptPath));
+				if (cached != m_ScriptCache.end() && cached->second["OnUpdateAll"].get_type() == sol::type::function)
 				{
-					sol::error err = result;
-					// LOG_ERROR("Lua Error: {0}", err.what()); // Use your engine logger
-					std::cout << "Lua Error: " << err.what() << std::endl;
+					batchIt->second = (uint32_t)m_ScriptBatches.size();
+
+					ScriptBatch& batch = m_ScriptBatches.emplace_back();
+					batch.Class = cached->second;
+					batch.OnUpdateAll = cached->second["OnUpdateAll"];
+					batch.StatsIndex = sc.RuntimeStatsIndex;
+					batch.Instances = m_Lua->create_table();
 				}
 			}
 
+			if (batchIt->second != NoScriptBatch)
+			{
+				m_ScriptBatches[batchIt->second].Members.push_back({ 0.0, entity, sc.RuntimeScheduleGeneration, false });
+				return;
+			}
+		}
+
+		if (!sc.OnUpdate.valid())
+			return;
+
+		switch (sc.RuntimeSchedule)
+		{
+		case ScriptComponent::UpdateSchedule::EveryStep:
+			m_EveryStepScripts.push_back({ 0.0, entity, sc.RuntimeScheduleGeneration, false });
+			break;
+		case ScriptComponent::UpdateSchedule::Interval:
+			m_ScheduledScripts.push({ m_ScriptTime + sc.RuntimeUpdateInterval, entity, sc.RuntimeScheduleGeneration, true });
+			break;
+		case ScriptComponent::UpdateSchedule::OnDemand:
+			// waits for ScheduleScriptUpdate
+			break;
 		}
 	}
 
-	void Scene::RenderScene()
+	void Scene::ScheduleScriptUpdate(Entity entity, float delay)
 	{
+		auto& sc = entity.GetComponent<ScriptComponent>();
+		if (!sc.OnUpdate.valid() || !sc.Instance.valid())
+			return;
 
-		// Draw sprites
+		m_ScheduledScripts.push({ m_ScriptTime + std::max(delay, 0.0f), entity, sc.RuntimeScheduleGeneration, false });
+	}
+
+	void Scene::UpdateParticles(float ts)
+	{
+		Timer timer;
+		auto view = m_Registry.view<ParticleEmitterComponent, TransformComponent>();
+		for (auto entity : view)
 		{
-			auto view = m_Registry.view<TransformComponent,SpriteRendererComponent>(entt::exclude<DisabledComponent>);
-			for (auto entity : view)
-			{
-				auto [transform, sprite] = view.get<TransformComponent, SpriteRendererComponent>(entity);
+			auto [emitter, transform] = view.get<ParticleEmitterComponent, TransformComponent>(entity);
+			// inactive emitters keep their particles frozen
+			if (!transform.ActiveInHierarchy)
+				continue;
 
-				Renderer2D::DrawSprite(transform.GlobalTransform, sprite, (int)entity);
+			if (emitter.EmissionRate > 0.0f)
+			{
+				ParticleBuffer& particles = emitter.Particles;
+				particles.EmitAccumulator += emitter.EmissionRate * ts;
+				uint32_t count = (uint32_t)particles.EmitAccumulator;
+				particles.EmitAccumulator -= (float)count;
+				if (count > 0)
+					Engine::EmitParticles(emitter, count, glm::vec2(transform.GlobalTransform[3]));
 			}
+
+			SimulateParticles(emitter, ts);
+			m_Stats.ParticleCount += emitter.Particles.Count;
+		}
+		m_Stats.ParticleTime = timer.ElapsedMillis();
+	}
+
+	void Scene::EmitParticles(Entity entity, uint32_t count)
+	{
+		const glm::mat4& transform = entity.GetComponent<TransformComponent>().GlobalTransform;
+		EmitParticles(entity, count, glm::vec2(transform[3]));
+	}
+
+	void Scene::EmitParticles(Entity entity, uint32_t count, const glm::vec2& position)
+	{
+		ASSERT(entity.BelongsToScene(this), "This Scene cannot emit particles of entity of other scene.")
+		Engine::EmitParticles(entity.GetComponent<ParticleEmitterComponent>(), count, position);
+	}
+
+	void Scene::RenderScene()
+	{
+		// Renderables are iterated through owning groups: the group keeps the owned pools sorted so that its
+		// members are packed at the front, iteration walks them in lockstep without probing other pools.
+		// Sprites are the common case and own their transform too, a transform can only be owned by one group.
+		// Inactive entities stay in the groups, toggling them only flips TransformComponent::ActiveInHierarchy.
+		// The groups are created by the constructor, here they are only looked up.
+
+		// Draw sprites
+		{
+			auto group = m_Registry.group<TransformComponent, SpriteRendererComponent>();
+			group.each([&](auto entity, auto& transform, auto& sprite) {
+				if (!transform.ActiveInHierarchy)
+					return;
+				Renderer2D::DrawSprite(GetRenderTransform(transform), sprite, (int)entity);
+			});
 		}
 
 		// Draw circles
 		{
-			auto view = m_Registry.view<TransformComponent, CircleRendererComponent>(entt::exclude<DisabledComponent>);
+			auto group = m_Registry.group<CircleRendererComponent>(entt::get<TransformComponent>);
+			group.each([&](auto entity, auto& circle, auto& transform) {
+				if (!transform.ActiveInHierarchy)
+					return;
+				Renderer2D::DrawCircle(GetRenderTransform(transform), circle.Color, circle.Thickness, circle.Fade, (int)entity);
+			});
+		}
+
+		// Draw particles, they are already in world space
+		{
+			auto view = m_Registry.view<ParticleEmitterComponent, TransformComponent>();
 			for (auto entity : view)
 			{
-				auto [transform, circle] = view.get<TransformComponent, CircleRendererComponent>(entity);
-
-				Renderer2D::DrawCircle(transform.GlobalTransform, circle.Color, circle.Thickness, circle.Fade, (int)entity);
+				auto [emitter, transform] = view.get<ParticleEmitterComponent, TransformComponent>(entity);
+				if (transform.ActiveInHierarchy && emitter.Particles.Count > 0)
+					Renderer2D::DrawParticles(emitter, transform.GlobalTransform[3].z, (int)entity);
 			}
 		}
 
 		// Draw text
 		{
-			auto view = m_Registry.view<TransformComponent, TextComponent>(entt::exclude<DisabledComponent>);
-			for (auto entity : view)
-			{
-				auto [transform, text] = view.get<TransformComponent, TextComponent>(entity);
-
-				Renderer2D::DrawString(text.TextString, transform.GlobalTransform, text, (int)entity);
-			}
+			auto group = m_Registry.group<TextComponent>(entt::get<TransformComponent>);
+			group.each([&](auto entity, auto& text, auto& transform) {
+				if (!transform.ActiveInHierarchy)
+					return;
+				Renderer2D::DrawString(text.TextString, GetRenderTransform(transform), text, (int)entity);
+			});
 		}
 
 	}
@@ -978,6 +2067,121 @@ namespace Engine {
 		}
 	}
 
+	Entity Scene::FindEntityByUUID(UUID uuid)
+	{
+		entt::entity entity = m_UUIDIndex.Find(uuid);
+		if (entity == entt::null)
+			return {};
+		return Entity{ entity, this };
+	}
+
+	Entity Scene::GetEntityByTag(const std::string& tag)
+	{
+		auto it = m_TagIndex.find(tag);
+		if (it == m_TagIndex.end())
+			return {};
+
+		// entries can be stale if a tag was written directly instead of through Entity::SetName
+		for (auto e : it->second)
+		{
+			if (m_Registry.valid(e) && m_Registry.get<TagComponent>(e).Tag == tag)
+				return Entity{ e, this };
+		}
+		return {};
+	}
+
+	std::vector<Entity> Scene::GetEntitiesByTag(const std::string& tag)
+	{
+		std::vector<Entity> entities;
+		auto it = m_TagIndex.find(tag);
+		if (it == m_TagIndex.end())
+			return entities;
+
+		entities.reserve(it->second.size());
+		for (auto e : it->second)
+		{
+			if (m_Registry.valid(e) && m_Registry.get<TagComponent>(e).Tag == tag)
+				entities.emplace_back(e, this);
+		}
+		return entities;
+	}
+
+	void Scene::ConnectIndices()
+	{
+		m_Registry.on_construct<IDComponent>().connect<&Scene::OnIDConstruct>(*this);
+		m_Registry.on_destroy<IDComponent>().connect<&Scene::OnIDDestroy>(*this);
+		m_Registry.on_construct<TagComponent>().connect<&Scene::OnTagConstruct>(*this);
+		m_Registry.on_update<TagComponent>().connect<&Scene::OnTagUpdate>(*this);
+		m_Registry.on_destroy<TagComponent>().connect<&Scene::OnTagDestroy>(*this);
+		m_Registry.on_destroy<TransformComponent>().connect<&Scene::OnTransformDestroy>(*this);
+	}
+
+	void Scene::RebuildTagIndex()
+	{
+		m_TagIndex.clear();
+		auto view = m_Registry.view<TagComponent>();
+		for (auto entity : view)
+			AddToTagIndex(entity, view.get<TagComponent>(entity).Tag);
+	}
+
+	void Scene::OnTransformDestroy(entt::registry& registry, entt::entity entity)
+	{
+		m_SpatialIndex.Remove(entity);
+	}
+
+	void Scene::OnIDConstruct(entt::registry& registry, entt::entity entity)
+	{
+		m_UUIDIndex.Insert(registry.get<IDComponent>(entity).ID, entity);
+	}
+
+	void Scene::OnIDDestroy(entt::registry& registry, entt::entity entity)
+	{
+		UUID uuid = registry.get<IDComponent>(entity).ID;
+		if (m_UUIDIndex.Find(uuid) == entity)
+			m_UUIDIndex.Erase(uuid);
+	}
+
+	void Scene::AddToTagIndex(entt::entity entity, const std::string& tag)
+	{
+		m_TagIndex[tag].push_back(entity);
+	}
+
+	void Scene::RemoveFromTagIndex(entt::entity entity, const std::string& tag)
+	{
+		auto it = m_TagIndex.find(tag);
+		if (it == m_TagIndex.end())
+			return;
+
+		auto& entities = it->second;
+		auto e = std::find(entities.begin(), entities.end(), entity);
+		if (e != entities.end())
+		{
+			*e = entities.back();
+			entities.pop_back();
+		}
+		if (entities.empty())
+			m_TagIndex.erase(it);
+	}
+
+	void Scene::OnTagConstruct(entt::registry& registry, entt::entity entity)
+	{
+		AddToTagIndex(entity, registry.get<TagComponent>(entity).Tag);
+	}
+
+	void Scene::OnTagUpdate(entt::registry& registry, entt::entity entity)
+	{
+		// the old tag is already gone at this point, Entity::SetName and AddOrReplaceComponent remove it before writing
+		const std::string& tag = registry.get<TagComponent>(entity).Tag;
+		auto& entities = m_TagIndex[tag];
+		if (std::find(entities.begin(), entities.end(), entity) == entities.end())
+			entities.push_back(entity);
+	}
+
+	void Scene::OnTagDestroy(entt::registry& registry, entt::entity entity)
+	{
+		RemoveFromTagIndex(entity, registry.get<TagComponent>(entity).Tag);
+	}
+
 	Entity Scene::GetPrimaryCameraEntity()
 	{
 		auto view = m_Registry.view<CameraComponent>();
@@ -990,6 +2194,189 @@ namespace Engine {
 		return {};
 	}
 
+	std::vector<Entity> Scene::QueryAABB(const glm::vec2& min, const glm::vec2& max)
+	{
+		std::vector<entt::entity> found;
+		m_SpatialIndex.QueryAABB(min, max, found);
+		std::vector<Entity> result;
+		result.reserve(found.size());
+		for (auto entity : found)
+			result.emplace_back(entity, this);
+		return result;
+	}
+
+	std::vector<Entity> Scene::QueryRadius(const glm::vec2& center, float radius)
+	{
+		std::vector<entt::entity> found;
+		m_SpatialIndex.QueryRadius(center, radius, found);
+		std::vector<Entity> result;
+		result.reserve(found.size());
+		for (auto entity : found)
+			result.emplace_back(entity, this);
+		return result;
+	}
+
+	std::vector<Entity> Scene::QueryNearest(const glm::vec2& point, uint32_t count)
+	{
+		std::vector<entt::entity> found;
+		m_SpatialIndex.QueryNearest(point, count, found);
+		std::vector<Entity> result;
+		result.reserve(found.size());
+		for (auto entity : found)
+			result.emplace_back(entity, this);
+		return result;
+	}
+
+	// Ray cast callback collecting either the closest hit or all of them
+	class RaycastCollector : public b2RayCastCallback
+	{
+	public:
+		RaycastCollector(uint16_t mask, bool closestOnly)
+			: m_Mask(mask), m_ClosestOnly(closestOnly)
+		{
+		}
+
+		virtual float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+		{
+			if ((fixture->GetFilterData().categoryBits & m_Mask) == 0)
+				return -1.0f; // filtered, ignore this fixture and continue
+
+			Scene::RaycastHit hit;
+			hit.Entity = (entt::entity)(uint32_t)fixture->GetUserData().pointer;
+			hit.Point = { point.x, point.y };
+			hit.Normal = { normal.x, normal.y };
+			hit.Fraction = fraction;
+
+			if (m_ClosestOnly)
+			{
+				// clip the ray, Box2D only reports closer fixtures from now on
+				Hits.assign(1, hit);
+				return fraction;
+			}
+			Hits.push_back(hit);
+			return 1.0f;
+		}
+
+		std::vector<Scene::RaycastHit> Hits;
+
+	private:
+		uint16_t m_Mask;
+		bool m_ClosestOnly;
+	};
+
+	// Exact overlap test of 'shape' against the fixtures whose bounds overlap its AABB
+	class OverlapCollector : public b2QueryCallback
+	{
+	public:
+		OverlapCollector(const b2Shape& shape, uint16_t mask)
+			: m_Shape(shape), m_Mask(mask)
+		{
+			m_Transform.SetIdentity();
+		}
+
+		virtual bool ReportFixture(b2Fixture* fixture) override
+		{
+			if ((fixture->GetFilterData().categoryBits & m_Mask) == 0)
+				return true;
+
+			// the broadphase works on fattened bounds, test the actual shapes
+			const b2Shape* shape = fixture->GetShape();
+			for (int32 child = 0; child < shape->GetChildCount(); child++)
+			{
+				if (b2TestOverlap(&m_Shape, 0, shape, child, m_Transform, fixture->GetBody()->GetTransform()))
+				{
+					// an entity can have several colliders, report it once
+					entt::entity entity = (entt::entity)(uint32_t)fixture->GetUserData().pointer;
+					if (std::find(Entities.begin(), Entities.end(), entity) == Entities.end())
+						Entities.push_back(entity);
+					break;
+				}
+			}
+			return true;
+		}
+
+		std::vector<entt::entity> Entities;
+
+	private:
+		const b2Shape& m_Shape;
+		b2Transform m_Transform;
+		uint16_t m_Mask;
+	};
+
+	bool Scene::Raycast(const glm::vec2& from, const glm::vec2& to, uint16_t mask, RaycastHit& hit)
+	{
+		// Box2D asserts on zero length rays
+		if (!m_PhysicsWorld || from == to)
+			return false;
+
+		RaycastCollector collector(mask, true);
+		m_PhysicsWorld->RayCast(&collector, b2Vec2(from.x, from.y), b2Vec2(to.x, to.y));
+		if (collector.Hits.empty())
+			return false;
+
+		hit = collector.Hits[0];
+		return true;
+	}
+
+	std::vector<Scene::RaycastHit> Scene::RaycastAll(const glm::vec2& from, const glm::vec2& to, uint16_t mask)
+	{
+		if (!m_PhysicsWorld || from == to)
+			return {};
+
+		// Box2D reports fixtures in no particular order
+		RaycastCollector collector(mask, false);
+		m_PhysicsWorld->RayCast(&collector, b2Vec2(from.x, from.y), b2Vec2(to.x, to.y));
+		std::sort(collector.Hits.begin(), collector.Hits.end(), [](const RaycastHit& a, const RaycastHit& b) { return a.Fraction < b.Fraction; });
+		return std::move(collector.Hits);
+	}
+
+	std::vector<Entity> Scene::OverlapAABB(const glm::vec2& min, const glm::vec2& max, uint16_t mask)
+	{
+		std::vector<Entity> result;
+		if (!m_PhysicsWorld || min.x > max.x || min.y > max.y)
+			return result;
+
+		glm::vec2 center = (min + max) * 0.5f;
+		glm::vec2 halfExtent = (max - min) * 0.5f;
+		b2PolygonShape box;
+		box.SetAsBox(std::max(halfExtent.x, b2_linearSlop), std::max(halfExtent.y, b2_linearSlop), b2Vec2(center.x, center.y), 0.0f);
+
+		b2AABB aabb;
+		aabb.lowerBound = b2Vec2(min.x, min.y);
+		aabb.upperBound = b2Vec2(max.x, max.y);
+
+		OverlapCollector collector(box, mask);
+		m_PhysicsWorld->QueryAABB(&collector, aabb);
+
+		result.reserve(collector.Entities.size());
+		for (auto entity : collector.Entities)
+			result.emplace_back(entity, this);
+		return result;
+	}
+
+	std::vector<Entity> Scene::OverlapCircle(const glm::vec2& center, float radius, uint16_t mask)
+	{
+		std::vector<Entity> result;
+		if (!m_PhysicsWorld || radius < 0.0f)
+			return result;
+
+		b2CircleShape circle;
+		circle.m_p.Set(center.x, center.y);
+		circle.m_radius = radius;
+
+		b2AABB aabb;
+		aabb.lowerBound = b2Vec2(center.x - radius, center.y - radius);
+		aabb.upperBound = b2Vec2(center.x + radius, center.y + radius);
+
+		OverlapCollector collector(circle, mask);
+		m_PhysicsWorld->QueryAABB(&collector, aabb);
+
+		result.reserve(collector.Entities.size());
+		for (auto entity : collector.Entities)
+			result.emplace_back(entity, this);
+		return result;
+	}
+
 	template<typename T>
 	void Scene::OnComponentAdded(Entity entity, T& component)
 	{
@@ -1009,7 +2396,9 @@ namespace Engine {
 			component.GlobalTransform = parent.GetComponent<TransformComponent>().GlobalTransform * component.GetTransform();
 		else // it's scene root
 			component.GlobalTransform = glm::mat4(1);
-		
+
+		component.PreviousGlobalTransform = component.GlobalTransform;
+		component.SnapInterpolation = true;
 	}
 
 	template<>
@@ -1069,18 +2458,60 @@ namespace Engine {
 		}
 	}
 
+	template<>
+	void Scene::OnComponentAdded<PolygonCollider2DComponent>(Entity entity, PolygonCollider2DComponent& component)
+	{
+		if (m_PhysicsWorld)
+		{
+			component.ClosestRigidbodyParent = entity.ClosestRigidbodyParent();
+			component.RuntimeFixture = nullptr;
+			SyncPhysicsToTransform(entity);
+		}
+	}
+
+	template<>
+	void Scene::OnComponentAdded<CapsuleCollider2DComponent>(Entity entity, CapsuleCollider2DComponent& component)
+	{
+		if (m_PhysicsWorld)
+		{
+			component.ClosestRigidbodyParent = entity.ClosestRigidbodyParent();
+			component.RuntimeFixture = nullptr;
+			component.RuntimeCapFixtures[0] = component.RuntimeCapFixtures[1] = nullptr;
+			SyncPhysicsToTransform(entity);
+		}
+	}
+
+	template<>
+	void Scene::OnComponentAdded<EdgeChainCollider2DComponent>(Entity entity, EdgeChainCollider2DComponent& component)
+	{
+		if (m_PhysicsWorld)
+		{
+			component.ClosestRigidbodyParent = entity.ClosestRigidbodyParent();
+			component.RuntimeFixture = nullptr;
+			SyncPhysicsToTransform(entity);
+		}
+	}
+
+	template<>
+	void Scene::OnComponentAdded<Joint2DComponent>(Entity entity, Joint2DComponent& component)
+	{
+		component.RuntimeJoint = nullptr;
+		if (m_PhysicsWorld)
+			CreateJoint(entity);
+	}
+
 	template<>
 	void Scene::OnComponentAdded<TextComponent>(Entity entity, TextComponent& component)
 	{
 	}
 
 	template<>
-	void Scene::OnComponentAdded<RelationshipComponent>(Entity entity, RelationshipComponent& component)
+	void Scene::OnComponentAdded<ParticleEmitterComponent>(Entity entity, ParticleEmitterComponent& component)
 	{
 	}
 
 	template<>
-	void Scene::OnComponentAdded<DisabledComponent>(Entity entity, DisabledComponent& component)
+	void Scene::OnComponentAdded<RelationshipComponent>(Entity entity, RelationshipComponent& component)
 	{
 	}
 
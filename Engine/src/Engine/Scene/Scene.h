@@ -1,23 +1,68 @@
 #pragma once
 
 #include <filesystem>
+#include <queue>
 #include <unordered_map> // Must come after filesystem
 
 #include "Engine/Utils/UUID.h"
 #include "Engine/Renderer/EditorCamera.h"
+#include "UUIDIndex.h"
+#include "SpatialHash.h"
+#include "PhysicsRecording.h"
 #include "entt.hpp"
 #include "sol/sol.hpp"
 
 class b2World;
+class b2Body;
+class b2DestructionListener;
 
 namespace Engine {
 
 	// Forward declaration. do not import actual Entity class as it will cause circular dependency loop.
 	class Entity;
 	class PhysicsContactListener;
+	class Prefab;
+	class SceneSnapshot;
+	class WorkerThread;
+	struct TransformComponent;
+	struct Joint2DComponent;
 
 	class Scene
 	{
+	public:
+		// Per frame timings of the runtime/simulation update, in milliseconds
+		struct Statistics
+		{
+			float UpdateTime = 0.0f;
+			float ScriptTime = 0.0f;
+			float PhysicsTime = 0.0f;
+			float PhysicsWorkerTime = 0.0f; // pipelined physics: stepping the world on the worker, overlapped with the frame
+			float PhysicsWaitTime = 0.0f;	// pipelined physics: main thread blocked on the worker
+			float RenderTime = 0.0f;
+			float ParticleTime = 0.0f;
+			uint32_t FixedSteps = 0;
+			uint32_t SyncedBodies = 0; // bodies written back to their transform, over all fixed steps
+			uint32_t ContactEvents = 0; // contact begin/end events dispatched to scripts, over all fixed steps
+			uint32_t FixturesCreated = 0; // Box2D fixtures built for colliders, moving a body does not rebuild its fixtures
+			uint32_t ParticleCount = 0;
+		};
+
+		// OnUpdate calls and time of every script file, over the last frame
+		struct ScriptStatistics
+		{
+			std::string Script;
+			uint32_t Updates = 0;
+			float UpdateTime = 0.0f; // milliseconds
+		};
+
+		struct RaycastHit
+		{
+			entt::entity Entity = entt::null;
+			glm::vec2 Point = { 0.0f, 0.0f };
+			glm::vec2 Normal = { 0.0f, 0.0f };
+			float Fraction = 1.0f; // along the ray, 0 at 'from' and 1 at 'to'
+		};
+
 	public:
 		Scene();
 		~Scene();
@@ -26,8 +71,14 @@ namespace Engine {
 		Entity CreateNewChildEntity(Entity parentEntity);
 		Entity CreateEntityWithUUID(UUID uuid, const std::string& name = std::string());
 		void DestroyEntity(Entity entity);
+		// Destroys the entity and its children at the end of the frame. Safe to use from scripts and physics callbacks.
+		void QueueDestroyEntity(Entity entity);
+		void FlushDestroyQueue();
 
-		static std::shared_ptr<Scene> Copy(std::shared_ptr<Scene> other);
+		// Play mode snapshot. Everything changed after TakeSnapshot is undone by RestoreSnapshot.
+		void TakeSnapshot();
+		void RestoreSnapshot();
+		bool HasSnapshot() const { return m_Snapshot != nullptr; }
 
 		bool IsDescendant(Entity potentialAncestor, Entity potentialDescendant);
 		void UpdateParent(Entity& child, Entity& newParent, bool keepWorldTransform=false);
@@ -44,36 +95,121 @@ namespace Engine {
 		void OnViewportResize(uint32_t width, uint32_t height);
 		
 		Entity DuplicateEntity(Entity entity);
+		// Emits 'count' particles from the entity's ParticleEmitterComponent, at its position unless one is given
+		void EmitParticles(Entity entity, uint32_t count);
+		void EmitParticles(Entity entity, uint32_t count, const glm::vec2& position);
+		// Creates 'count' copies of the prefab as children of 'parent' (scene root if null) and returns their roots
+		std::vector<Entity> InstantiatePrefab(const Prefab& prefab, uint32_t count, Entity parent);
 
 		const entt::entity& GetSceneRoot() { return m_SceneRoot; }
+		Entity FindEntityByUUID(UUID uuid);
+		// Tag lookups use an index kept up to date by the registry, rename entities through Entity::SetName
+		Entity GetEntityByTag(const std::string& tag);
+		std::vector<Entity> GetEntitiesByTag(const std::string& tag);
 		Entity GetPrimaryCameraEntity();
 
+		// Spatial queries over active entities, by the world AABB of a unit quad under their global transform.
+		// The index follows transform propagation, so it is as current as the global transforms are.
+		std::vector<Entity> QueryAABB(const glm::vec2& min, const glm::vec2& max);
+		std::vector<Entity> QueryRadius(const glm::vec2& center, float radius);
+		// closest first
+		std::vector<Entity> QueryNearest(const glm::vec2& point, uint32_t count);
+
+		// Physics queries against the colliders of the running physics world, they find nothing while it is not running.
+		// Only colliders whose Category shares a bit with 'mask' are considered.
+		bool Raycast(const glm::vec2& from, const glm::vec2& to, uint16_t mask, RaycastHit& hit);
+		// every collider crossed by the ray, closest first
+		std::vector<RaycastHit> RaycastAll(const glm::vec2& from, const glm::vec2& to, uint16_t mask);
+		std::vector<Entity> OverlapAABB(const glm::vec2& min, const glm::vec2& max, uint16_t mask);
+		std::vector<Entity> OverlapCircle(const glm::vec2& center, float radius, uint16_t mask);
+
 		template<typename... Components, typename... Args>
 		auto GetAllEntitiesWith(Args&&... args)
 		{
 			return m_Registry.view<Components...>(std::forward<Args>(args)...);
 		}
 
+		const Statistics& GetStats() const { return m_Stats; }
+		const std::vector<ScriptStatistics>& GetScriptStats() const { return m_ScriptStats; }
+		// Every change to the running physics world goes through the recorder
+		PhysicsRecorder& GetPhysicsRecorder() { return m_PhysicsRecorder; }
+
 		std::string m_SceneName = "Untitled Scene";
 		glm::vec2 m_Acc = { 0.0f, -9.8f };
 		glm::vec2 m_VieportLocation = { 0.0f,0.0f };
 
+		// Fixed timestep settings. Scripts and physics are stepped at m_FixedUpdateRate Hz,
+		// at most m_MaxSubSteps times per frame so a long frame cannot snowball into longer ones.
+		uint32_t m_FixedUpdateRate = 60;
+		uint32_t m_MaxSubSteps = 5;
+		bool m_InterpolateTransforms = true;
+		// Steps the physics world on a worker thread while the frame renders. Physics results are applied at the
+		// start of the next fixed step, so they show up one step later than in serial mode.
+		bool m_PipelinedPhysics = false;
+		// Records the physics world from start to stop into this file, empty to not record. Replay it with PhysicsReplay::Run.
+		std::filesystem::path m_PhysicsRecordingPath;
+
 	private:
 		template<typename T>
 		void OnComponentAdded(Entity entity, T& component);
 
+		// Unlinks 'entity' from its parent and appends it and its descendants to 'entities', children first
+		void CollectForDestruction(Entity entity, std::vector<entt::entity>& entities);
+		void DestroyEntities(const std::vector<entt::entity>& entities);
+		// Every entity of every instance, node major: entity of node n of instance i is at [n * count + i]
+		std::vector<entt::entity> InstantiatePrefabEntities(const Prefab& prefab, uint32_t count, Entity parent);
 		void CreateDuplicationMap(Entity& entity, std::unordered_map<entt::entity, entt::entity>& map);
 		void UpdateGlobalTransforms();
 		void UpdateTransformRecursive(entt::entity entity, const glm::mat4& parentTransform);
+		// Recomputes TransformComponent::ActiveInHierarchy for 'entity' and the part of its subtree whose state changed,
+		// enabling/disabling their physics along the way
+		void UpdateActiveInHierarchy(Entity entity);
 		void SyncPhysicsToTransform(Entity entity);
 
+		void ConnectIndices();
+		// Indexes every entity under its current tag again, after tags were written past the index
+		void RebuildTagIndex();
+		void AddToTagIndex(entt::entity entity, const std::string& tag);
+		void RemoveFromTagIndex(entt::entity entity, const std::string& tag);
+		void OnTagConstruct(entt::registry& registry, entt::entity entity);
+		void OnTagUpdate(entt::registry& registry, entt::entity entity);
+		void OnTagDestroy(entt::registry& registry, entt::entity entity);
+		void OnIDConstruct(entt::registry& registry, entt::entity entity);
+		void OnIDDestroy(entt::registry& registry, entt::entity entity);
+		void OnTransformDestroy(entt::registry& registry, entt::entity entity);
+
+		uint32_t StepFixed(float ts, bool runScripts);
+		void SnapshotTransforms();
+		glm::mat4 GetRenderTransform(const TransformComponent& transform) const;
+
 		void OnPhysics2DStart();
 		void OnPhysics2DStop();
 		void OnUpdatePhysics2D(float ts);
+		void StepPhysicsWorld(float ts);
+		// Fires contact callbacks and writes body poses back to the transforms
+		void ApplyPhysicsResults();
+
+		// Pipelined physics. A fixed step queues its physics step, it is launched on the worker right before
+		// rendering and waited for once the frame is rendered, so the world is only used by one thread at a time.
+		void LaunchPhysicsStep();
+		void WaitForPhysicsStep();
+		// Brings the scene up to date with the last physics step, before the next fixed step starts
+		void CompletePhysicsStep();
+
+		// Joints are created once the bodies on both sides exist. UpdateJoint pushes the motor, limit, softness
+		// and target settings of the component to its Box2D joint.
+		void CreateJoint(Entity entity);
+		void DestroyJoint(Joint2DComponent& joint);
+		void UpdateJoint(Joint2DComponent& joint);
 
 		void OnScriptingStart();
 		void OnScriptingStop();
 		void RunScripts(float ts);
+		// Lists the script's OnUpdate by its schedule, dropping what was scheduled for it before. Called once its instance exists.
+		void ScheduleScript(Entity entity);
+		// One OnUpdate after 'delay' seconds, whatever the schedule
+		void ScheduleScriptUpdate(Entity entity, float delay);
+		void UpdateParticles(float ts);
 
 		void RenderScene();
 
@@ -81,16 +217,86 @@ namespace Engine {
 		entt::registry m_Registry;
 		entt::entity m_SceneRoot = entt::null;
 		uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
+
+		UUIDIndex m_UUIDIndex;
+		// tag -> entities with that tag
+		std::unordered_map<std::string, std::vector<entt::entity>> m_TagIndex;
+		SpatialHash m_SpatialIndex;
+
+		std::vector<entt::entity> m_DestroyQueue;
+
+		float m_FixedTimeAccumulator = 0.0f;
+		float m_InterpolationAlpha = 1.0f;
+		Statistics m_Stats;
 		
 		b2World* m_PhysicsWorld = nullptr;
+		// parent -> inverse global transform and global angle, rebuilt every physics step
+		std::unordered_map<entt::entity, std::pair<glm::mat4, float>> m_ParentSpaceCache;
 		PhysicsContactListener* m_ContactListener = nullptr;
+		b2DestructionListener* m_DestructionListener = nullptr;
+		b2Body* m_GroundBody = nullptr;
+		PhysicsRecorder m_PhysicsRecorder;
+		std::unique_ptr<WorkerThread> m_PhysicsWorker;
+		float m_QueuedPhysicsStep = 0.0f;	// timestep of the physics step waiting to be launched, 0 if none
+		bool m_PhysicsResultsPending = false;	// the world was stepped but its results were not applied yet
 		sol::state* m_Lua = nullptr;
 		// Create a cache to store file's returned class
 		std::unordered_map<std::filesystem::path, sol::table> m_ScriptCache;
+		// Prefabs loaded by scripts, kept until scripting stops
+		std::unordered_map<std::filesystem::path, std::shared_ptr<Prefab>> m_PrefabCache;
+
+		// Scripts with an OnUpdate, by schedule, so a step only visits the scripts it runs. Entries of destroyed
+		// or rescheduled scripts are not searched for, they are dropped when they come up.
+		struct ScriptUpdate
+		{
+			double Due;		// script time the update runs at, unused for every step scripts
+			entt::entity Entity;
+			uint32_t Generation;	// ScriptComponent::RuntimeScheduleGeneration when scheduled
+			bool Repeats;	// interval updates schedule the next one when they run
+
+			bool operator>(const ScriptUpdate& other) const { return Due > other.Due; }
+		};
+		double m_ScriptTime = 0.0; // fixed steps run with scripts so far, in seconds
+		std::vector<ScriptUpdate> m_EveryStepScripts;
+		// interval and on demand updates, soonest first
+		std::priority_queue<ScriptUpdate, std::vector<ScriptUpdate>, std::greater<ScriptUpdate>> m_ScheduledScripts;
+		std::vector<ScriptUpdate> m_DueScripts; // scratch, updates run by the current step
+		std::vector<ScriptStatistics> m_ScriptStats;
+		std::unordered_map<std::string, uint32_t> m_ScriptStatsIndex; // script path -> index in m_ScriptStats
+
+		// Script classes defining OnUpdateAll(instances, ts). Their every step scripts are updated by one call per class
+		// instead of one per script, the other schedules still call OnUpdate per script. Called as Class:OnUpdateAll,
+		// 'instances' is an array of the active instances that the script may read but not modify.
+		struct ScriptBatch
+		{
+			sol::table Class;
+			sol::protected_function OnUpdateAll;
+			uint32_t StatsIndex = 0;
+			std::vector<ScriptUpdate> Members;
+			// entity and schedule generation of each entry of 'Instances', in order. A restarted script gets a new
+			// generation, so its new instance replaces the old one.
+			std::vector<std::pair<entt::entity, uint32_t>> Active;
+			// Array passed to OnUpdateAll, only rebuilt when the active scripts change. It is owned by the engine and
+			// read only for the script, it is handed back as is the next step.
+			sol::table Instances;
+		};
+		static constexpr uint32_t NoScriptBatch = std::numeric_limits<uint32_t>::max();
+		std::vector<ScriptBatch> m_ScriptBatches;
+		std::unordered_map<std::string, uint32_t> m_ScriptBatchIndex; // script path -> index in m_ScriptBatches or NoScriptBatch
+		std::vector<std::pair<entt::entity, uint32_t>> m_BatchScratch; // scratch, active scripts of the batch being updated
+
+		// must be declared after m_Registry, it disconnects from the registry when destroyed
+		std::unique_ptr<SceneSnapshot> m_Snapshot;
 
 	friend class Entity;
 	friend class SceneHierarchyPanel;
 	friend class SceneSerializer;
+	friend class SceneSnapshot;
+	friend class Prefab;
+	friend class EntityPool;
+	friend class PhysicsContactListener;
+	friend class SceneBenchmark;
+	friend class Hierarchy;
 	friend void BindLuaTypesAndFunctions(sol::state* m_Lua, Scene* scene);
 	};
 
@@ -0,0 +1,483 @@
+#include "egpch.h"
+#include "SceneBenchmark.h"
+
+#include "Components.h"
+#include "Entity.h"
+#include "EntityPool.h"
+#include "Hierarchy.h"
+#include "Prefab.h"
+#include "SceneSerializer.h"
+#include "SpatialHash.h"
+#include "Engine/Utils/Timer.h"
+
+#include <filesystem>
+#include <random>
+
+namespace Engine {
+
+	// frames (or query batches) each case is timed over, the average is reported
+	static constexpr uint32_t BenchmarkFrames = 60;
+
+	void SceneBenchmark::Run(float scale)
+	{
+		ENGINE_LOG_INFO("Scene benchmark, {0} frames per case.", BenchmarkFrames);
+		RenderIteration((uint32_t)(100000 * scale));
+		SpatialQueries((uint32_t)(10000 * scale));
+		ScriptCallbacks((uint32_t)(10000 * scale));
+		BatchedScripts((uint32_t)(10000 * scale));
+		DeepHierarchy((uint32_t)(100000 * scale));
+		PrefabInstantiation((uint32_t)(10000 * scale));
+		TagLookup((uint32_t)(100000 * scale));
+		PooledToggle((uint32_t)(1000 * scale));
+		Particles((uint32_t)(100000 * scale));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Rendering ////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Same entities in both registries: every entity has a transform, every other one a sprite, like a scene
+	// whose colliders, cameras and empty parents sit between the sprites
+	static void CreateSprites(entt::registry& registry, uint32_t spriteCount)
+	{
+		for (uint32_t i = 0; i < spriteCount * 2; i++)
+		{
+			entt::entity entity = registry.create();
+			registry.emplace<TransformComponent>(entity, glm::vec3((float)i, 0.0f, 0.0f));
+			if (i % 2 == 0)
+				registry.emplace<SpriteRendererComponent>(entity);
+		}
+	}
+
+	void SceneBenchmark::RenderIteration(uint32_t spriteCount)
+	{
+		// what RenderScene reads of every sprite, summed so the loops cannot be optimized away
+		float viewSum = 0.0f, groupSum = 0.0f;
+
+		entt::registry viewRegistry;
+		CreateSprites(viewRegistry, spriteCount);
+		Timer viewTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			auto view = viewRegistry.view<TransformComponent, SpriteRendererComponent>();
+			for (auto entity : view)
+			{
+				auto [transform, sprite] = view.get<TransformComponent, SpriteRendererComponent>(entity);
+				if (!transform.ActiveInHierarchy)
+					continue;
+				viewSum += transform.GlobalTransform[3].x + sprite.Color.r;
+			}
+		}
+		const float viewTime = viewTimer.ElapsedMillis() / BenchmarkFrames;
+
+		entt::registry groupRegistry;
+		CreateSprites(groupRegistry, spriteCount);
+		// created before timing, RenderScene's group exists from the first frame on
+		groupRegistry.group<TransformComponent, SpriteRendererComponent>();
+		Timer groupTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			auto group = groupRegistry.group<TransformComponent, SpriteRendererComponent>();
+			group.each([&](auto entity, auto& transform, auto& sprite) {
+				if (!transform.ActiveInHierarchy)
+					return;
+				groupSum += transform.GlobalTransform[3].x + sprite.Color.r;
+			});
+		}
+		const float groupTime = groupTimer.ElapsedMillis() / BenchmarkFrames;
+
+		ENGINE_LOG_INFO("Sprite iteration, {0} sprites: view {1:.3f} ms, owning group {2:.3f} ms per frame (checksums {3}, {4}).",
+			spriteCount, viewTime, groupTime, viewSum, groupSum);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Spatial queries //////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void SceneBenchmark::SpatialQueries(uint32_t entityCount)
+	{
+		struct Bounds
+		{
+			entt::entity Entity;
+			glm::vec2 Min, Max;
+		};
+
+		// fixed seed, every run queries the same world
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(0.0f, 500.0f);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+		entt::registry registry;
+		SpatialHash index;
+		std::vector<Bounds> bounds;
+		bounds.reserve(entityCount);
+		for (uint32_t i = 0; i < entityCount; i++)
+		{
+			glm::vec2 center = { position(random), position(random) };
+			glm::vec2 halfExtent = 0.5f * glm::vec2(size(random), size(random));
+			Bounds entry = { registry.create(), center - halfExtent, center + halfExtent };
+			bounds.push_back(entry);
+			index.Update(entry.Entity, entry.Min, entry.Max);
+		}
+
+		// a batch is one frame of scripts each looking around themselves
+		constexpr uint32_t queriesPerBatch = 1000;
+		constexpr float queryHalfExtent = 5.0f;
+		std::vector<glm::vec2> centers(queriesPerBatch);
+		for (auto& center : centers)
+			center = { position(random), position(random) };
+
+		std::vector<entt::entity> found;
+		size_t scanFound = 0, aabbFound = 0, radiusFound = 0;
+
+		Timer scanTimer;
+		for (uint32_t batch = 0; batch < BenchmarkFrames; batch++)
+		{
+			for (const glm::vec2& center : centers)
+			{
+				const glm::vec2 min = center - glm::vec2(queryHalfExtent), max = center + glm::vec2(queryHalfExtent);
+				found.clear();
+				for (const Bounds& entry : bounds)
+				{
+					if (entry.Min.x <= max.x && entry.Max.x >= min.x && entry.Min.y <= max.y && entry.Max.y >= min.y)
+						found.push_back(entry.Entity);
+				}
+				scanFound += found.size();
+			}
+		}
+		const float scanTime = scanTimer.ElapsedMillis() / BenchmarkFrames;
+
+		Timer aabbTimer;
+		for (uint32_t batch = 0; batch < BenchmarkFrames; batch++)
+		{
+			for (const glm::vec2& center : centers)
+			{
+				index.QueryAABB(center - glm::vec2(queryHalfExtent), center + glm::vec2(queryHalfExtent), found);
+				aabbFound += found.size();
+			}
+		}
+		const float aabbTime = aabbTimer.ElapsedMillis() / BenchmarkFrames;
+
+		Timer radiusTimer;
+		for (uint32_t batch = 0; batch < BenchmarkFrames; batch++)
+		{
+			for (const glm::vec2& center : centers)
+			{
+				index.QueryRadius(center, queryHalfExtent, found);
+				radiusFound += found.size();
+			}
+		}
+		const float radiusTime = radiusTimer.ElapsedMillis() / BenchmarkFrames;
+
+		// the scan and QueryAABB must agree, or the comparison is meaningless
+		if (scanFound != aabbFound)
+			ENGINE_LOG_ERROR("Spatial hash found {0} entities where the scan found {1}.", aabbFound, scanFound);
+
+		ENGINE_LOG_INFO("Spatial queries, {0} entities, {1} queries per frame: scan {2:.3f} ms, QueryAABB {3:.3f} ms, QueryRadius {4:.3f} ms per frame ({5} found per frame).",
+			entityCount, queriesPerBatch, scanTime, aabbTime, radiusTime, aabbFound / BenchmarkFrames);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Scripts //////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// The same mover as a per script OnUpdate and as a batched OnUpdateAll
+	static const char* BenchmarkScript = R"(
+		local Mover = {}
+		function Mover:OnUpdate(ts)
+			self.X = self.X + self.Speed * ts
+		end
+		function Mover:OnUpdateAll(instances, ts)
+			for i = 1, #instances do
+				local mover = instances[i]
+				mover.X = mover.X + mover.Speed * ts
+			end
+		end
+		return Mover
+	)";
+
+	// Script instances set up like Entity::OnScriptStart does: a table per script, the class as its __index
+	static std::vector<sol::table> CreateScriptInstances(sol::state& lua, uint32_t scriptCount, sol::table& scriptClass)
+	{
+		lua.open_libraries(sol::lib::base, sol::lib::math);
+		scriptClass = lua.script(BenchmarkScript);
+
+		std::vector<sol::table> instances;
+		instances.reserve(scriptCount);
+		for (uint32_t i = 0; i < scriptCount; i++)
+		{
+			sol::table instance = lua.create_table();
+			instance[sol::metatable_key] = lua.create_table_with("__index", scriptClass);
+			instance["X"] = 0.0f;
+			instance["Speed"] = 1.0f;
+			instances.push_back(instance);
+		}
+		return instances;
+	}
+
+	void SceneBenchmark::ScriptCallbacks(uint32_t scriptCount)
+	{
+		constexpr float ts = 1.0f / 60.0f;
+		sol::state lua;
+		sol::table scriptClass;
+		std::vector<sol::table> instances = CreateScriptInstances(lua, scriptCount, scriptClass);
+
+		Timer lookupTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (auto& instance : instances)
+			{
+				sol::protected_function onUpdate = instance["OnUpdate"];
+				onUpdate(instance, ts);
+			}
+		}
+		const float lookupTime = lookupTimer.ElapsedMillis() / BenchmarkFrames;
+
+		std::vector<sol::protected_function> callbacks;
+		callbacks.reserve(scriptCount);
+		for (auto& instance : instances)
+			callbacks.push_back(instance["OnUpdate"]);
+
+		Timer cachedTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (size_t i = 0; i < instances.size(); i++)
+				callbacks[i](instances[i], ts);
+		}
+		const float cachedTime = cachedTimer.ElapsedMillis() / BenchmarkFrames;
+
+		ENGINE_LOG_INFO("Script callbacks, {0} scripts: lookup per call {1:.3f} ms ({2:.3f} us per call), cached {3:.3f} ms ({4:.3f} us per call) per frame.",
+			scriptCount, lookupTime, lookupTime * 1000.0f / scriptCount, cachedTime, cachedTime * 1000.0f / scriptCount);
+	}
+
+	void SceneBenchmark::BatchedScripts(uint32_t scriptCount)
+	{
+		constexpr float ts = 1.0f / 60.0f;
+		sol::state lua;
+		sol::table scriptClass;
+		std::vector<sol::table> instances = CreateScriptInstances(lua, scriptCount, scriptClass);
+
+		std::vector<sol::protected_function> callbacks;
+		callbacks.reserve(scriptCount);
+		for (auto& instance : instances)
+			callbacks.push_back(instance["OnUpdate"]);
+
+		Timer perScriptTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (size_t i = 0; i < instances.size(); i++)
+				callbacks[i](instances[i], ts);
+		}
+		const float perScriptTime = perScriptTimer.ElapsedMillis() / BenchmarkFrames;
+
+		// built once, like the batch array that is only rebuilt when its scripts change
+		sol::table array = lua.create_table((int)scriptCount, 0);
+		for (size_t i = 0; i < instances.size(); i++)
+			array[i + 1] = instances[i];
+		sol::protected_function onUpdateAll = scriptClass["OnUpdateAll"];
+
+		Timer batchedTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+			onUpdateAll(scriptClass, array, ts);
+		const float batchedTime = batchedTimer.ElapsedMillis() / BenchmarkFrames;
+
+		ENGINE_LOG_INFO("Batched scripts, {0} scripts: OnUpdate per script {1:.3f} ms, one OnUpdateAll {2:.3f} ms per frame.",
+			scriptCount, perScriptTime, batchedTime);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Serialization ////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void SceneBenchmark::DeepHierarchy(uint32_t depth)
+	{
+		// a single chain, every entity the only child of the previous one
+		auto scene = std::make_shared<Scene>();
+		Entity parent = { scene->GetSceneRoot(), scene.get() };
+		for (uint32_t i = 0; i < depth; i++)
+		{
+			Entity child = scene->CreateEntity("Link");
+			child.GetComponent<RelationshipComponent>().Parent = parent;
+			parent.GetComponent<RelationshipComponent>().FirstChild = child;
+			parent = child;
+		}
+
+		const std::string filepath = (std::filesystem::temp_directory_path() / "SceneBenchmark.scene").string();
+		Timer saveTimer;
+		SceneSerializer(scene).Serialize(filepath);
+		const float saveTime = saveTimer.ElapsedMillis();
+
+		auto loadedScene = std::make_shared<Scene>();
+		Timer loadTimer;
+		const bool loaded = SceneSerializer(loadedScene).Deserialize(filepath);
+		const float loadTime = loadTimer.ElapsedMillis();
+		std::filesystem::remove(filepath);
+
+		// the chain has to come back whole, or the timings are of something else
+		uint32_t loadedDepth = 0;
+		Hierarchy::ForEachPreOrder({ loadedScene->GetSceneRoot(), loadedScene.get() }, [&](Entity) { loadedDepth++; });
+		loadedDepth--; // the scene root
+		if (!loaded || loadedDepth != depth)
+			ENGINE_LOG_ERROR("Deep hierarchy loaded {0} of {1} entities.", loadedDepth, depth);
+
+		ENGINE_LOG_INFO("Deep hierarchy, chain of {0} entities: save {1:.3f} ms, load {2:.3f} ms.", depth, saveTime, loadTime);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Prefabs //////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// A root with 'nodeCount' - 1 children, every node a sprite
+	static Entity CreateSpriteTree(Scene& scene, uint32_t nodeCount)
+	{
+		Entity root = scene.CreateEntity("Root");
+		root.AddComponent<SpriteRendererComponent>();
+		for (uint32_t i = 1; i < nodeCount; i++)
+			scene.CreateNewChildEntity(root).AddComponent<SpriteRendererComponent>();
+		return root;
+	}
+
+	void SceneBenchmark::PrefabInstantiation(uint32_t instanceCount)
+	{
+		constexpr uint32_t nodeCount = 5;
+
+		Scene sourceScene;
+		Entity source = CreateSpriteTree(sourceScene, nodeCount);
+		std::shared_ptr<Prefab> prefab = Prefab::Create(source);
+
+		// what pooling scripts did before prefabs, one DuplicateEntity per copy
+		Timer duplicateTimer;
+		for (uint32_t i = 0; i < instanceCount; i++)
+			sourceScene.DuplicateEntity(source);
+		const float duplicateTime = duplicateTimer.ElapsedMillis();
+
+		Scene scene;
+		Timer instantiateTimer;
+		std::vector<Entity> roots = scene.InstantiatePrefab(*prefab, instanceCount, {});
+		const float instantiateTime = instantiateTimer.ElapsedMillis();
+
+		if (roots.size() != instanceCount)
+			ENGINE_LOG_ERROR("InstantiatePrefab created {0} of {1} instances.", roots.size(), instanceCount);
+
+		ENGINE_LOG_INFO("Prefab instantiation, {0} copies of a {1} node prefab: DuplicateEntity {2:.3f} ms, InstantiatePrefab {3:.3f} ms.",
+			instanceCount, nodeCount, duplicateTime, instantiateTime);
+	}
+
+	void SceneBenchmark::PooledToggle(uint32_t instanceCount)
+	{
+		constexpr uint32_t nodeCount = 3;
+
+		Scene sourceScene;
+		std::shared_ptr<Prefab> prefab = Prefab::Create(CreateSpriteTree(sourceScene, nodeCount));
+
+		// every instance switched off and back on each frame, what a pooling script does to its whole pool at worst
+		Scene scene;
+		std::vector<Entity> roots = scene.InstantiatePrefab(*prefab, instanceCount, {});
+		Timer toggleTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (Entity& root : roots)
+				root.setEnabled(false);
+			for (Entity& root : roots)
+				root.setEnabled(true);
+		}
+		const float toggleTime = toggleTimer.ElapsedMillis() / BenchmarkFrames;
+
+		// the same through a pool, which also resets the components of every acquired instance
+		Scene poolScene;
+		EntityPool pool(&poolScene, prefab, instanceCount, {});
+		Timer poolTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (uint32_t i = 0; i < instanceCount; i++)
+				pool.Acquire();
+			pool.ReleaseAll();
+		}
+		const float poolTime = poolTimer.ElapsedMillis() / BenchmarkFrames;
+
+		ENGINE_LOG_INFO("Pooled toggle, {0} instances of a {1} node prefab off and on per frame: setEnabled {2:.3f} ms, Acquire/Release {3:.3f} ms per frame.",
+			instanceCount, nodeCount, toggleTime, poolTime);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Tags /////////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void SceneBenchmark::TagLookup(uint32_t entityCount)
+	{
+		Scene scene;
+		for (uint32_t i = 0; i < entityCount; i++)
+			scene.CreateEntity("Entity " + std::to_string(i));
+
+		// a frame of scripts looking up entities by name, spread over the whole scene
+		constexpr uint32_t lookupsPerFrame = 100;
+		std::vector<std::string> tags(lookupsPerFrame);
+		for (uint32_t i = 0; i < lookupsPerFrame; i++)
+			tags[i] = "Entity " + std::to_string((uint64_t)i * entityCount / lookupsPerFrame);
+
+		size_t scanFound = 0, indexFound = 0;
+
+		// what GetEntityByTag did before the index, compare every tag in the registry
+		Timer scanTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (const std::string& tag : tags)
+			{
+				auto view = scene.GetAllEntitiesWith<TagComponent>();
+				for (auto entity : view)
+				{
+					if (view.get<TagComponent>(entity).Tag == tag)
+					{
+						scanFound++;
+						break;
+					}
+				}
+			}
+		}
+		const float scanTime = scanTimer.ElapsedMillis() / BenchmarkFrames;
+
+		Timer indexTimer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+		{
+			for (const std::string& tag : tags)
+			{
+				if (scene.GetEntityByTag(tag))
+					indexFound++;
+			}
+		}
+		const float indexTime = indexTimer.ElapsedMillis() / BenchmarkFrames;
+
+		if (scanFound != indexFound)
+			ENGINE_LOG_ERROR("Tag index found {0} entities where the scan found {1}.", indexFound, scanFound);
+
+		ENGINE_LOG_INFO("Tag lookup, {0} entities, {1} lookups per frame: scan {2:.3f} ms, index {3:.3f} ms per frame ({4:.3f} us per lookup).",
+			entityCount, lookupsPerFrame, scanTime, indexTime, indexTime * 1000.0f / lookupsPerFrame);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Particles ////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	void SceneBenchmark::Particles(uint32_t particleCount)
+	{
+		constexpr float ts = 1.0f / 60.0f;
+
+		// one emitter kept full: it starts with every particle alive and emits as many as die each frame
+		Scene scene;
+		Entity entity = scene.CreateEntity("Emitter");
+		auto& emitter = entity.AddComponent<ParticleEmitterComponent>();
+		emitter.MaxParticles = particleCount;
+		emitter.LifeTime = 2.0f;
+		emitter.EmissionRate = particleCount / emitter.LifeTime;
+		scene.EmitParticles(entity, particleCount);
+
+		Timer timer;
+		for (uint32_t frame = 0; frame < BenchmarkFrames; frame++)
+			scene.UpdateParticles(ts);
+		const float updateTime = timer.ElapsedMillis() / BenchmarkFrames;
+
+		ENGINE_LOG_INFO("Particles, {0} live: update {1:.3f} ms per frame ({2} alive after {3} frames).",
+			particleCount, updateTime, emitter.Particles.Count, BenchmarkFrames);
+	}
+
+}
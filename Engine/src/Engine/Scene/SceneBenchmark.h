@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Engine {
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// SceneBenchmark ///////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Headless timings of the scene's hot loops, most next to the approach they replaced. Needs no window,
+	// renderer or project: the loops are run on their own data the way the scene runs them.
+	class SceneBenchmark
+	{
+	public:
+		// Logs every result, 'scale' multiplies the entity counts
+		static void Run(float scale = 1.0f);
+
+		// Sprite iteration of RenderScene: owning group against a two component view
+		static void RenderIteration(uint32_t spriteCount);
+		// Scene.QueryAABB/QueryRadius through the spatial hash against a scan of every entity's bounds
+		static void SpatialQueries(uint32_t entityCount);
+		// OnUpdate resolved by name on every call against the callback cached by OnScriptStart
+		static void ScriptCallbacks(uint32_t scriptCount);
+		// One OnUpdate call per script against one OnUpdateAll call per class
+		static void BatchedScripts(uint32_t scriptCount);
+		// Saving and loading a scene that is a single chain 'depth' entities deep, the stack must not overflow
+		static void DeepHierarchy(uint32_t depth);
+		// One InstantiatePrefab call for 'instanceCount' copies of a 5 node prefab against one DuplicateEntity per copy
+		static void PrefabInstantiation(uint32_t instanceCount);
+		// Disabling and enabling every instance of a 3 node prefab each frame, by setEnabled and through an EntityPool
+		static void PooledToggle(uint32_t instanceCount);
+		// GetEntityByTag through the tag index against a scan comparing every tag
+		static void TagLookup(uint32_t entityCount);
+		// Scene::UpdateParticles of one emitter kept at 'particleCount' live particles
+		static void Particles(uint32_t particleCount);
+	};
+
+}
@@ -14,8 +14,9 @@ namespace Engine
 	};
 
 	// Define the "Super Type" once
+	// Integers are 64 bit like Lua's, so entity UUIDs survive a round trip through the globals
 	using RuntimeValue = std::variant<
-		int,
+		int64_t,
 		float,
 		bool,
 		std::string,
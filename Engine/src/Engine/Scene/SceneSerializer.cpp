@@ -2,6 +2,7 @@
 #include "SceneSerializer.h"
 #include "Components.h"
 #include "Entity.h"
+#include "Hierarchy.h"
 #include "Engine/Project/Project.h"
 
 #include <fstream>
@@ -35,6 +36,33 @@ namespace Engine {
         return Rigidbody2DComponent::BodyType::Static;
     }
 
+    static std::string Joint2DTypeToString(Joint2DComponent::JointType jointType)
+    {
+        switch (jointType)
+        {
+        case Joint2DComponent::JointType::Revolute:  return "Revolute";
+        case Joint2DComponent::JointType::Distance:  return "Distance";
+        case Joint2DComponent::JointType::Prismatic: return "Prismatic";
+        case Joint2DComponent::JointType::Weld:      return "Weld";
+        case Joint2DComponent::JointType::Mouse:     return "Mouse";
+        }
+
+        ASSERT(false, "Unknown joint type");
+        return {};
+    }
+
+    static Joint2DComponent::JointType Joint2DTypeFromString(const std::string& jointTypeString)
+    {
+        if (jointTypeString == "Revolute")  return Joint2DComponent::JointType::Revolute;
+        if (jointTypeString == "Distance")  return Joint2DComponent::JointType::Distance;
+        if (jointTypeString == "Prismatic") return Joint2DComponent::JointType::Prismatic;
+        if (jointTypeString == "Weld")      return Joint2DComponent::JointType::Weld;
+        if (jointTypeString == "Mouse")     return Joint2DComponent::JointType::Mouse;
+
+        ASSERT(false, "Unknown joint type");
+        return Joint2DComponent::JointType::Revolute;
+    }
+
     // Helper lambda to load vec2 from array
     auto loadVec2 = [](json& j) { return glm::vec2(j[0], j[1]); };
 
@@ -44,7 +72,30 @@ namespace Engine {
     // Helper lambda to load vec4 from array
     auto loadVec4 = [](json& j) { return glm::vec4(j[0], j[1], j[2], j[3]); };
 
-    static json SerializeEntity(Entity entity, Scene* scene)
+    // Contact options are stored flat in the collider's object
+    static void SerializeContactOptions(json& colliderJson, const ColliderContactOptions& options)
+    {
+        colliderJson["IsSensor"] = options.IsSensor;
+        colliderJson["OneWay"] = options.OneWay;
+        colliderJson["OneWayDirection"] = { options.OneWayDirection.x, options.OneWayDirection.y };
+        colliderJson["ImpulseThreshold"] = options.ImpulseThreshold;
+    }
+
+    // Contact options were added after box and circle colliders, older scenes keep the defaults
+    static void DeserializeContactOptions(json& colliderJson, ColliderContactOptions& options)
+    {
+        if (colliderJson.contains("IsSensor"))
+            options.IsSensor = colliderJson["IsSensor"];
+        if (colliderJson.contains("OneWay"))
+            options.OneWay = colliderJson["OneWay"];
+        if (colliderJson.contains("OneWayDirection"))
+            options.OneWayDirection = loadVec2(colliderJson["OneWayDirection"]);
+        if (colliderJson.contains("ImpulseThreshold"))
+            options.ImpulseThreshold = colliderJson["ImpulseThreshold"];
+    }
+
+    // Components of a single entity, its place in the hierarchy is added by SerializeEntity
+    static json SerializeComponents(Entity entity)
     {
         if (!entity) return {};
 
@@ -170,6 +221,7 @@ namespace Engine {
                 { "Category",               bc2c.Category },
                 { "Mask",                   bc2c.Mask },
             };
+            SerializeContactOptions(entityJson["BoxCollider2DComponent"], bc2c.ContactOptions);
         }
 
         // Serialize CircleCollider2D
@@ -187,6 +239,99 @@ namespace Engine {
                 { "Category",               cc2c.Category },
                 { "Mask",                   cc2c.Mask },
             };
+            SerializeContactOptions(entityJson["CircleCollider2DComponent"], cc2c.ContactOptions);
+        }
+
+        // Serialize PolygonCollider2D
+        if (entity.HasComponent<PolygonCollider2DComponent>())
+        {
+            auto& pc2c = entity.GetComponent<PolygonCollider2DComponent>();
+
+            json vertices = json::array();
+            for (const auto& vertex : pc2c.Vertices)
+                vertices.push_back({ vertex.x, vertex.y });
+
+            entityJson["PolygonCollider2DComponent"] = {
+                { "Offset",                 { pc2c.Offset.x, pc2c.Offset.y } },
+                { "Vertices",               vertices },
+                { "Density",                pc2c.Density },
+                { "Friction",               pc2c.Friction },
+                { "Restitution",            pc2c.Restitution },
+                { "RestitutionThreshold",   pc2c.RestitutionThreshold },
+                { "Category",               pc2c.Category },
+                { "Mask",                   pc2c.Mask },
+            };
+            SerializeContactOptions(entityJson["PolygonCollider2DComponent"], pc2c.ContactOptions);
+        }
+
+        // Serialize CapsuleCollider2D
+        if (entity.HasComponent<CapsuleCollider2DComponent>())
+        {
+            auto& cap2c = entity.GetComponent<CapsuleCollider2DComponent>();
+
+            entityJson["CapsuleCollider2DComponent"] = {
+                { "Offset",                 { cap2c.Offset.x, cap2c.Offset.y } },
+                { "Radius",                 cap2c.Radius },
+                { "Height",                 cap2c.Height },
+                { "Density",                cap2c.Density },
+                { "Friction",               cap2c.Friction },
+                { "Restitution",            cap2c.Restitution },
+                { "RestitutionThreshold",   cap2c.RestitutionThreshold },
+                { "Category",               cap2c.Category },
+                { "Mask",                   cap2c.Mask },
+            };
+            SerializeContactOptions(entityJson["CapsuleCollider2DComponent"], cap2c.ContactOptions);
+        }
+
+        // Serialize EdgeChainCollider2D
+        if (entity.HasComponent<EdgeChainCollider2DComponent>())
+        {
+            auto& ec2c = entity.GetComponent<EdgeChainCollider2DComponent>();
+
+            json points = json::array();
+            for (const auto& point : ec2c.Points)
+                points.push_back({ point.x, point.y });
+
+            entityJson["EdgeChainCollider2DComponent"] = {
+                { "Offset",                 { ec2c.Offset.x, ec2c.Offset.y } },
+                { "Points",                 points },
+                { "Loop",                   ec2c.Loop },
+                { "Density",                ec2c.Density },
+                { "Friction",               ec2c.Friction },
+                { "Restitution",            ec2c.Restitution },
+                { "RestitutionThreshold",   ec2c.RestitutionThreshold },
+                { "Category",               ec2c.Category },
+                { "Mask",                   ec2c.Mask },
+            };
+            SerializeContactOptions(entityJson["EdgeChainCollider2DComponent"], ec2c.ContactOptions);
+        }
+
+        // Serialize Joint2D
+        if (entity.HasComponent<Joint2DComponent>())
+        {
+            auto& jc = entity.GetComponent<Joint2DComponent>();
+
+            entityJson["Joint2DComponent"] = {
+                { "Type",                   Joint2DTypeToString(jc.Type) },
+                { "ConnectedEntity",        (uint64_t)jc.ConnectedEntity },
+                { "Anchor",                 { jc.Anchor.x, jc.Anchor.y } },
+                { "ConnectedAnchor",        { jc.ConnectedAnchor.x, jc.ConnectedAnchor.y } },
+                { "CollideConnected",       jc.CollideConnected },
+                { "Axis",                   { jc.Axis.x, jc.Axis.y } },
+                { "EnableLimit",            jc.EnableLimit },
+                { "LowerLimit",             jc.LowerLimit },
+                { "UpperLimit",             jc.UpperLimit },
+                { "EnableMotor",            jc.EnableMotor },
+                { "MotorSpeed",             jc.MotorSpeed },
+                { "MaxMotorForce",          jc.MaxMotorForce },
+                { "Length",                 jc.Length },
+                { "MinLength",              jc.MinLength },
+                { "MaxLength",              jc.MaxLength },
+                { "Frequency",              jc.Frequency },
+                { "DampingRatio",           jc.DampingRatio },
+                { "Target",                 { jc.Target.x, jc.Target.y } },
+                { "MaxForce",               jc.MaxForce },
+            };
         }
 
         // Serialize Text
@@ -207,6 +352,25 @@ namespace Engine {
               
         }
 
+        // Serialize ParticleEmitter
+        if (entity.HasComponent<ParticleEmitterComponent>())
+        {
+            auto& pe = entity.GetComponent<ParticleEmitterComponent>();
+
+            entityJson["ParticleEmitterComponent"] = {
+                { "Velocity",           { pe.Velocity.x, pe.Velocity.y } },
+                { "VelocityVariation",  { pe.VelocityVariation.x, pe.VelocityVariation.y } },
+                { "ColorBegin",         { pe.ColorBegin.r, pe.ColorBegin.g, pe.ColorBegin.b, pe.ColorBegin.a } },
+                { "ColorEnd",           { pe.ColorEnd.r, pe.ColorEnd.g, pe.ColorEnd.b, pe.ColorEnd.a } },
+                { "SizeBegin",          pe.SizeBegin },
+                { "SizeEnd",            pe.SizeEnd },
+                { "SizeVariation",      pe.SizeVariation },
+                { "LifeTime",           pe.LifeTime },
+                { "EmissionRate",       pe.EmissionRate },
+                { "MaxParticles",       pe.MaxParticles }
+            };
+        }
+
         // Serialize Script
         if (entity.HasComponent<ScriptComponent>())
         {
@@ -218,7 +382,7 @@ namespace Engine {
         }
 
         // Serialize Disabled
-        if (entity.HasComponent<DisabledComponent>())
+        if (!entity.isSelfEnabled())
         {
             entityJson["Disabled"] = true;
         }
@@ -242,22 +406,26 @@ namespace Engine {
             }
         }
 
-        // Serialize Children
-        if (entity.HasComponent<RelationshipComponent>())
-        {
-            entityJson["Children"] = json::array();
-            Entity child = { entity.GetComponent<RelationshipComponent>().FirstChild, scene };
-            while (child)
-            {
-                entityJson["Children"].push_back(SerializeEntity(child, scene));
-                child = { child.GetComponent<RelationshipComponent>().NextSibling, scene };
-            }
-        }
-
         return entityJson;
     }
 
-    static Entity DeserializeEntity(json& entityJson, Scene* scene)
+    // Flat list of the tree under 'root', parents before children. Every entry names its parent by UUID, the root's
+    // is 0. Nesting children in their parent's json would make nlohmann's recursive dump and parse overflow the stack
+    // on deep hierarchies, a flat list stays three levels deep however deep the tree is.
+    static void SerializeEntity(Entity root, Scene* scene, json& entities)
+    {
+        if (!root) return;
+
+        Hierarchy::ForEachPreOrder(root, [&](Entity current) {
+            json entityJson = SerializeComponents(current);
+            entityJson["Parent"] = current == root ? (uint64_t)0 :
+                (uint64_t)Entity(current.GetComponent<RelationshipComponent>().Parent, scene).GetUUID();
+            entities.push_back(std::move(entityJson));
+        });
+    }
+
+    // Components of a single entity, it is linked into the hierarchy by DeserializeEntities
+    static Entity DeserializeComponents(json& entityJson, Scene* scene)
     {
         // Create Entity
         uint64_t uuid = entityJson["Entity"];
@@ -354,6 +522,7 @@ namespace Engine {
             bc2c.RestitutionThreshold = bc2Json["RestitutionThreshold"];
             bc2c.Category = bc2Json["Category"];
             bc2c.Mask = bc2Json["Mask"];
+            DeserializeContactOptions(bc2Json, bc2c.ContactOptions);
         }
 
         // Load CircleCollider2D
@@ -370,6 +539,91 @@ namespace Engine {
             cc2c.RestitutionThreshold = cc2Json["RestitutionThreshold"];
             cc2c.Category = cc2Json["Category"];
             cc2c.Mask = cc2Json["Mask"];
+            DeserializeContactOptions(cc2Json, cc2c.ContactOptions);
+        }
+
+        // Load PolygonCollider2D
+        if (entityJson.contains("PolygonCollider2DComponent"))
+        {
+            auto& pc2c = deserializedEntity.AddComponent<PolygonCollider2DComponent>();
+            auto& pc2Json = entityJson["PolygonCollider2DComponent"];
+
+            pc2c.Offset = loadVec2(pc2Json["Offset"]);
+            pc2c.Vertices.clear();
+            for (auto& vertex : pc2Json["Vertices"])
+                pc2c.Vertices.push_back(loadVec2(vertex));
+            pc2c.Density = pc2Json["Density"];
+            pc2c.Friction = pc2Json["Friction"];
+            pc2c.Restitution = pc2Json["Restitution"];
+            pc2c.RestitutionThreshold = pc2Json["RestitutionThreshold"];
+            pc2c.Category = pc2Json["Category"];
+            pc2c.Mask = pc2Json["Mask"];
+            DeserializeContactOptions(pc2Json, pc2c.ContactOptions);
+        }
+
+        // Load CapsuleCollider2D
+        if (entityJson.contains("CapsuleCollider2DComponent"))
+        {
+            auto& cap2c = deserializedEntity.AddComponent<CapsuleCollider2DComponent>();
+            auto& cap2Json = entityJson["CapsuleCollider2DComponent"];
+
+            cap2c.Offset = loadVec2(cap2Json["Offset"]);
+            cap2c.Radius = cap2Json["Radius"];
+            cap2c.Height = cap2Json["Height"];
+            cap2c.Density = cap2Json["Density"];
+            cap2c.Friction = cap2Json["Friction"];
+            cap2c.Restitution = cap2Json["Restitution"];
+            cap2c.RestitutionThreshold = cap2Json["RestitutionThreshold"];
+            cap2c.Category = cap2Json["Category"];
+            cap2c.Mask = cap2Json["Mask"];
+            DeserializeContactOptions(cap2Json, cap2c.ContactOptions);
+        }
+
+        // Load EdgeChainCollider2D
+        if (entityJson.contains("EdgeChainCollider2DComponent"))
+        {
+            auto& ec2c = deserializedEntity.AddComponent<EdgeChainCollider2DComponent>();
+            auto& ec2Json = entityJson["EdgeChainCollider2DComponent"];
+
+            ec2c.Offset = loadVec2(ec2Json["Offset"]);
+            ec2c.Points.clear();
+            for (auto& point : ec2Json["Points"])
+                ec2c.Points.push_back(loadVec2(point));
+            ec2c.Loop = ec2Json["Loop"];
+            ec2c.Density = ec2Json["Density"];
+            ec2c.Friction = ec2Json["Friction"];
+            ec2c.Restitution = ec2Json["Restitution"];
+            ec2c.RestitutionThreshold = ec2Json["RestitutionThreshold"];
+            ec2c.Category = ec2Json["Category"];
+            ec2c.Mask = ec2Json["Mask"];
+            DeserializeContactOptions(ec2Json, ec2c.ContactOptions);
+        }
+
+        // Load Joint2D
+        if (entityJson.contains("Joint2DComponent"))
+        {
+            auto& jc = deserializedEntity.AddComponent<Joint2DComponent>();
+            auto& jJson = entityJson["Joint2DComponent"];
+
+            jc.Type = Joint2DTypeFromString(jJson["Type"]);
+            jc.ConnectedEntity = jJson["ConnectedEntity"].get<uint64_t>();
+            jc.Anchor = loadVec2(jJson["Anchor"]);
+            jc.ConnectedAnchor = loadVec2(jJson["ConnectedAnchor"]);
+            jc.CollideConnected = jJson["CollideConnected"];
+            jc.Axis = loadVec2(jJson["Axis"]);
+            jc.EnableLimit = jJson["EnableLimit"];
+            jc.LowerLimit = jJson["LowerLimit"];
+            jc.UpperLimit = jJson["UpperLimit"];
+            jc.EnableMotor = jJson["EnableMotor"];
+            jc.MotorSpeed = jJson["MotorSpeed"];
+            jc.MaxMotorForce = jJson["MaxMotorForce"];
+            jc.Length = jJson["Length"];
+            jc.MinLength = jJson["MinLength"];
+            jc.MaxLength = jJson["MaxLength"];
+            jc.Frequency = jJson["Frequency"];
+            jc.DampingRatio = jJson["DampingRatio"];
+            jc.Target = loadVec2(jJson["Target"]);
+            jc.MaxForce = jJson["MaxForce"];
         }
 
         // Load Text
@@ -388,6 +642,24 @@ namespace Engine {
             tc.LineSpacing = tJson["LineSpacing"];
         }
 
+        // Load ParticleEmitter
+        if (entityJson.contains("ParticleEmitterComponent"))
+        {
+            auto& pe = deserializedEntity.AddComponent<ParticleEmitterComponent>();
+            auto& pJson = entityJson["ParticleEmitterComponent"];
+
+            pe.Velocity = loadVec2(pJson["Velocity"]);
+            pe.VelocityVariation = loadVec2(pJson["VelocityVariation"]);
+            pe.ColorBegin = loadVec4(pJson["ColorBegin"]);
+            pe.ColorEnd = loadVec4(pJson["ColorEnd"]);
+            pe.SizeBegin = pJson["SizeBegin"];
+            pe.SizeEnd = pJson["SizeEnd"];
+            pe.SizeVariation = pJson["SizeVariation"];
+            pe.LifeTime = pJson["LifeTime"];
+            pe.EmissionRate = pJson["EmissionRate"];
+            pe.MaxParticles = pJson["MaxParticles"];
+        }
+
         // Load Script
         if (entityJson.contains("ScriptComponent"))
         {
@@ -400,7 +672,10 @@ namespace Engine {
         // Load Disabled
         if (entityJson.contains("Disabled"))
         {
-            deserializedEntity.AddComponent<DisabledComponent>();
+            // parent is not linked yet, DeserializeEntities fixes ActiveInHierarchy up
+            auto& tc = deserializedEntity.GetComponent<TransformComponent>();
+            tc.Enabled = false;
+            tc.ActiveInHierarchy = false;
         }
 
         // Load Audio
@@ -421,26 +696,114 @@ namespace Engine {
             }
         }
 
-        // Load Relationship
-        if (entityJson.contains("Children"))
+        return deserializedEntity;
+    }
+
+    // Nested format of older files, children inside their parent's json
+    static Entity DeserializeNestedEntity(json& entityJson, Scene* scene)
+    {
+        Entity rootEntity = DeserializeComponents(entityJson, scene);
+
+        // Explicit stack of entities whose children still have to be created
+        std::vector<std::pair<json*, Entity>> pending = { { &entityJson, rootEntity } };
+        while (!pending.empty())
         {
+            auto [parentJson, parentEntity] = pending.back();
+            pending.pop_back();
+
+            // Load Relationship
+            if (!parentJson->contains("Children"))
+                continue;
+
             Entity prev;
-            for (auto& childJson : entityJson["Children"])
+            for (auto& childJson : (*parentJson)["Children"])
             {
-                Entity child = DeserializeEntity(childJson, scene);
+                Entity child = DeserializeComponents(childJson, scene);
                 auto& relation = child.GetComponent<RelationshipComponent>();
-                relation.Parent = deserializedEntity;
+                relation.Parent = parentEntity;
+                // parents are created first, so theirs is already final
+                auto& childTransform = child.GetComponent<TransformComponent>();
+                childTransform.ActiveInHierarchy = childTransform.Enabled && parentEntity.isEnabled();
                 relation.PrevSibling = prev;
                 // if prev is set, we are not at first iteration so set it's next as current. if prev is not set, it's the first child so set it as parent's(decentralized entity's) first child.
                 if (prev)
                     prev.GetComponent<RelationshipComponent>().NextSibling = child;
                 else
-                    deserializedEntity.GetComponent<RelationshipComponent>().FirstChild = child;
+                    parentEntity.GetComponent<RelationshipComponent>().FirstChild = child;
                 prev = child;
+
+                pending.emplace_back(&childJson, child);
             }
         }
 
-        return deserializedEntity;
+        return rootEntity;
+    }
+
+    // Links a loaded prefab root as the first child of the scene root
+    static void LinkAsFirstChild(Entity root, Scene* scene)
+    {
+        Entity sceneRoot = Entity(scene->GetSceneRoot(), scene);
+        auto& sceneRootRelation = sceneRoot.GetComponent<RelationshipComponent>();
+        auto& rootRelation = root.GetComponent<RelationshipComponent>();
+        rootRelation.Parent = sceneRoot;
+        rootRelation.NextSibling = sceneRootRelation.FirstChild;
+        if (sceneRootRelation.FirstChild != entt::null)
+            Entity(sceneRootRelation.FirstChild, scene).GetComponent<RelationshipComponent>().PrevSibling = root;
+        sceneRootRelation.FirstChild = root;
+    }
+
+    // Entities of a flat list written by SerializeEntity, returns the roots (entries whose parent is 0) in order, not
+    // linked to anything yet. Older files nest children instead, their entries are loaded by DeserializeNestedEntity.
+    static std::vector<Entity> DeserializeEntities(json& entities, Scene* scene)
+    {
+        struct Ancestor
+        {
+            uint64_t ID;
+            Entity Node;
+            entt::entity LastChild;
+        };
+
+        std::vector<Entity> roots;
+        // Parents come before their children, so the parent of an entry is always on the stack of the previous entry's
+        // ancestors. Entries that are not below it close the subtrees above.
+        std::vector<Ancestor> ancestors;
+        for (auto& entityJson : entities)
+        {
+            if (entityJson.contains("Children") || !entityJson.contains("Parent"))
+            {
+                roots.push_back(DeserializeNestedEntity(entityJson, scene));
+                ancestors.clear();
+                continue;
+            }
+
+            const uint64_t parentUUID = entityJson["Parent"];
+            while (!ancestors.empty() && ancestors.back().ID != parentUUID)
+                ancestors.pop_back();
+            if (parentUUID != 0 && ancestors.empty())
+                APP_LOG_ERROR("Parent {0} of entity {1} is not listed before it, loading it as a root.", parentUUID, entityJson["Entity"].get<uint64_t>());
+
+            Entity entity = DeserializeComponents(entityJson, scene);
+            if (ancestors.empty())
+                roots.push_back(entity);
+            else
+            {
+                Ancestor& parent = ancestors.back();
+                auto& relation = entity.GetComponent<RelationshipComponent>();
+                relation.Parent = parent.Node;
+                // parents are created first, so theirs is already final
+                auto& transform = entity.GetComponent<TransformComponent>();
+                transform.ActiveInHierarchy = transform.Enabled && parent.Node.isEnabled();
+                relation.PrevSibling = parent.LastChild;
+                if (parent.LastChild != entt::null)
+                    Entity(parent.LastChild, scene).GetComponent<RelationshipComponent>().NextSibling = entity;
+                else
+                    parent.Node.GetComponent<RelationshipComponent>().FirstChild = entity;
+                parent.LastChild = entity;
+            }
+            ancestors.push_back({ (uint64_t)entity.GetUUID(), entity, entt::null });
+        }
+
+        return roots;
     }
 
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -460,16 +823,18 @@ namespace Engine {
         json sceneData;
         sceneData["Scene"] = m_Scene->m_SceneName;
         sceneData["Gravity"] = { m_Scene->m_Acc.x, m_Scene->m_Acc.y };
+        sceneData["FixedUpdateRate"] = m_Scene->m_FixedUpdateRate;
+        sceneData["MaxSubSteps"] = m_Scene->m_MaxSubSteps;
+        sceneData["InterpolateTransforms"] = m_Scene->m_InterpolateTransforms;
+        sceneData["PipelinedPhysics"] = m_Scene->m_PipelinedPhysics;
         sceneData["Entities"] = json::array(); // Create an empty array
       
         Entity sceneRoot = Entity(m_Scene->m_SceneRoot, m_Scene.get());
         Entity child = { sceneRoot.GetComponent<RelationshipComponent>().FirstChild, m_Scene.get()};
         while (child)
         {
-            json entityJson = SerializeEntity(child, m_Scene.get());
+            SerializeEntity(child, m_Scene.get(), sceneData["Entities"]);
             child = { child.GetComponent<RelationshipComponent>().NextSibling, m_Scene.get() };
-            // Add to main list
-            sceneData["Entities"].push_back(entityJson);
         }
 
         // Write to file
@@ -504,13 +869,21 @@ namespace Engine {
 
         m_Scene->m_SceneName = sceneData["Scene"];
         m_Scene->m_Acc = loadVec2(sceneData["Gravity"]);
-        auto entities = sceneData["Entities"];
+        // older scene files do not have fixed timestep settings, keep defaults for them
+        if (sceneData.contains("FixedUpdateRate"))
+            m_Scene->m_FixedUpdateRate = sceneData["FixedUpdateRate"];
+        if (sceneData.contains("MaxSubSteps"))
+            m_Scene->m_MaxSubSteps = std::max(sceneData["MaxSubSteps"].get<uint32_t>(), 1u);
+        if (sceneData.contains("InterpolateTransforms"))
+            m_Scene->m_InterpolateTransforms = sceneData["InterpolateTransforms"];
+        if (sceneData.contains("PipelinedPhysics"))
+            m_Scene->m_PipelinedPhysics = sceneData["PipelinedPhysics"];
+        auto& entities = sceneData["Entities"];
         if (entities.is_array())
         {
             Entity prev;
-            for (auto& childJson : entities)
+            for (Entity child : DeserializeEntities(entities, m_Scene.get()))
             {
-                Entity child = DeserializeEntity(childJson, m_Scene.get());
                 auto& relation = child.GetComponent<RelationshipComponent>();
                 relation.Parent = m_Scene->m_SceneRoot;
                 relation.PrevSibling = prev;
@@ -537,4 +910,62 @@ namespace Engine {
 		ASSERT(false, "DeserializeRuntime not implemented");
 		return false;
 	}
+
+    void SceneSerializer::SerializePrefab(Entity root, const std::string& filepath)
+    {
+        ASSERT(root.BelongsToScene(m_Scene.get()), "Prefab root does not belong to the serializer's scene.");
+        APP_LOG_INFO("Serializing prefab to file: {0} START", std::filesystem::absolute(filepath).string());
+
+        json prefabData;
+        prefabData["Prefab"] = root.GetName();
+        prefabData["Entities"] = json::array();
+        SerializeEntity(root, m_Scene.get(), prefabData["Entities"]);
+
+        std::ofstream fout(filepath);
+        fout << std::setw(4) << prefabData;
+
+        APP_LOG_INFO("Serializing prefab FINISH");
+    }
+
+    Entity SceneSerializer::DeserializePrefab(const std::string& filepath)
+    {
+        APP_LOG_INFO("Deserializing prefab from file: {0} START", std::filesystem::absolute(filepath).string());
+
+        std::ifstream stream(filepath);
+        if (!stream.is_open()) return {};
+
+        json prefabData;
+        try {
+            stream >> prefabData;
+        }
+        catch (const json::parse_error& e) {
+            APP_LOG_ERROR("JSON Parse Error: {0}", e.what());
+            return {};
+        }
+
+        Entity root;
+        if (prefabData.contains("Entities") && prefabData["Entities"].is_array() && !prefabData["Entities"].empty())
+        {
+            std::vector<Entity> roots = DeserializeEntities(prefabData["Entities"], m_Scene.get());
+            if (roots.size() != 1)
+                APP_LOG_ERROR("Prefab {0} has {1} roots instead of one, the first is returned.", filepath, roots.size());
+            // link every root as a child of the scene root, the first one first
+            for (size_t i = roots.size() - 1; i > 0; i--)
+                LinkAsFirstChild(roots[i], m_Scene.get());
+            root = roots[0];
+        }
+        else if (prefabData.contains("Root")) // older, nested prefab files
+            root = DeserializeNestedEntity(prefabData["Root"], m_Scene.get());
+        else
+        {
+            APP_LOG_ERROR("File {0} is not a prefab.", filepath);
+            return {};
+        }
+
+        LinkAsFirstChild(root, m_Scene.get());
+
+        APP_LOG_INFO("Deserializing prefab FINISH");
+
+        return root;
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Scene.h"
+#include "Entity.h"
 
 namespace Engine {
 
@@ -14,6 +15,10 @@ namespace Engine {
 
 		bool Deserialize(const std::string& filepath);
 		bool DeserializeRuntime(const std::string& filepath);
+
+		// Prefabs are a single entity tree. The root has to belong to the serializer's scene and is loaded as a child of the scene root.
+		void SerializePrefab(Entity root, const std::string& filepath);
+		Entity DeserializePrefab(const std::string& filepath);
 	private:
 		std::shared_ptr<Scene> m_Scene;
 	};
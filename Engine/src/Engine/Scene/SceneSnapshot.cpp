@@ -0,0 +1,102 @@
+#include "egpch.h"
+#include "SceneSnapshot.h"
+
+#include "Scene.h"
+
+namespace Engine {
+
+	SceneSnapshot::SceneSnapshot(Scene* scene)
+		: m_Scene(scene)
+	{
+		auto& registry = m_Scene->m_Registry;
+
+		std::apply([&](auto&... backup) { (backup.Connect(registry), ...); }, m_Backups);
+
+		// IDComponent is only ever added on creation and removed on destruction, so it doubles as the entity lifetime signal
+		registry.on_construct<IDComponent>().connect<&SceneSnapshot::OnEntityCreated>(*this);
+		registry.on_destroy<IDComponent>().connect<&SceneSnapshot::OnEntityDestroyed>(*this);
+		m_Connected = true;
+
+		// The scene writes these every frame straight through the registry: bodies get their synced pose from the
+		// physics step, emitters their particles. Keeping all of them up front costs less than tracking every write.
+		for (auto entity : registry.view<Rigidbody2DComponent>())
+			Track(entity, registry.get<Rigidbody2DComponent>(entity));
+		for (auto entity : registry.view<ParticleEmitterComponent>())
+			Track(entity, registry.get<ParticleEmitterComponent>(entity));
+
+		m_SceneName = m_Scene->m_SceneName;
+		m_Acc = m_Scene->m_Acc;
+		m_FixedUpdateRate = m_Scene->m_FixedUpdateRate;
+		m_MaxSubSteps = m_Scene->m_MaxSubSteps;
+		m_InterpolateTransforms = m_Scene->m_InterpolateTransforms;
+		m_PipelinedPhysics = m_Scene->m_PipelinedPhysics;
+	}
+
+	SceneSnapshot::~SceneSnapshot()
+	{
+		Disconnect();
+	}
+
+	void SceneSnapshot::Disconnect()
+	{
+		if (!m_Connected)
+			return;
+
+		auto& registry = m_Scene->m_Registry;
+		std::apply([&](auto&... backup) { (backup.Disconnect(registry), ...); }, m_Backups);
+		registry.on_construct<IDComponent>().disconnect(*this);
+		registry.on_destroy<IDComponent>().disconnect(*this);
+		m_Connected = false;
+	}
+
+	void SceneSnapshot::OnEntityCreated(entt::registry& registry, entt::entity entity)
+	{
+		m_CreatedEntities.push_back(entity);
+	}
+
+	void SceneSnapshot::OnEntityDestroyed(entt::registry& registry, entt::entity entity)
+	{
+		// entities created while playing are simply gone, only the ones that existed before need to come back
+		if (!std::get<ComponentBackup<IDComponent>>(m_Backups).WasAdded(entity))
+			m_DestroyedEntities.push_back(entity);
+	}
+
+	void SceneSnapshot::Restore()
+	{
+		// stop tracking before we start undoing changes
+		Disconnect();
+
+		auto& registry = m_Scene->m_Registry;
+
+		// Destroy new entities first, they may be occupying slots of destroyed ones
+		for (auto entity : m_CreatedEntities)
+		{
+			if (registry.valid(entity))
+				registry.destroy(entity);
+		}
+
+		// Bring back destroyed entities with their exact handle so relationships pointing at them stay valid
+		for (auto entity : m_DestroyedEntities)
+		{
+			entt::entity recreated = registry.create(entity);
+			ASSERT(recreated == entity, "Could not recreate destroyed entity with it's original handle.");
+		}
+
+		std::apply([&](auto&... backup) { (backup.Restore(registry), ...); }, m_Backups);
+
+		m_Scene->m_SceneName = m_SceneName;
+		m_Scene->m_Acc = m_Acc;
+		m_Scene->m_FixedUpdateRate = m_FixedUpdateRate;
+		m_Scene->m_MaxSubSteps = m_MaxSubSteps;
+		m_Scene->m_InterpolateTransforms = m_InterpolateTransforms;
+		m_Scene->m_PipelinedPhysics = m_PipelinedPhysics;
+	}
+
+	size_t SceneSnapshot::GetTrackedCount() const
+	{
+		size_t count = m_CreatedEntities.size() + m_DestroyedEntities.size();
+		std::apply([&](const auto&... backup) { ((count += backup.GetTrackedCount()), ...); }, m_Backups);
+		return count;
+	}
+
+}
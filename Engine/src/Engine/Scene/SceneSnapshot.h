@@ -0,0 +1,194 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+
+#include "Components.h"
+#include "entt.hpp"
+
+namespace Engine {
+
+	class Scene;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// ComponentBackup //////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Keeps the original value of every instance of one component type that was touched since the snapshot was taken.
+	// An instance is tracked the first time it is accessed through Entity::GetComponent, right before it is removed (on_destroy),
+	// or when it is created (on_construct, in which case restoring means removing it again). Types the scene writes to directly
+	// are tracked up front by SceneSnapshot.
+	template<typename T>
+	class ComponentBackup
+	{
+	public:
+		void Connect(entt::registry& registry)
+		{
+			registry.on_construct<T>().template connect<&ComponentBackup<T>::OnConstruct>(*this);
+			registry.on_update<T>().template connect<&ComponentBackup<T>::OnUpdate>(*this);
+			registry.on_destroy<T>().template connect<&ComponentBackup<T>::OnDestroy>(*this);
+		}
+
+		void Disconnect(entt::registry& registry)
+		{
+			registry.on_construct<T>().disconnect(*this);
+			registry.on_update<T>().disconnect(*this);
+			registry.on_destroy<T>().disconnect(*this);
+		}
+
+		void Track(entt::entity entity, const T& component)
+		{
+			if (IsTracked(entity))
+				return;
+
+			MarkTracked(entity, false);
+			if constexpr (std::is_same_v<T, ScriptComponent>)
+			{
+				// never keep a reference to the script instance, the lua state is gone by the time we restore
+				ScriptComponent original;
+				original.ScriptPath = component.ScriptPath;
+				m_Originals.emplace_back(entity, std::move(original));
+			}
+			else
+				m_Originals.emplace_back(entity, component);
+		}
+
+		bool WasAdded(entt::entity entity) const
+		{
+			size_t index = GetIndex(entity);
+			return index < m_Slots.size() && m_Slots[index].Entity == entity && m_Slots[index].Added;
+		}
+
+		void Restore(entt::registry& registry)
+		{
+			for (auto entity : m_Added)
+			{
+				if (registry.valid(entity) && registry.has<T>(entity))
+					registry.remove<T>(entity);
+			}
+
+			for (auto& [entity, component] : m_Originals)
+			{
+				if (registry.valid(entity))
+					registry.emplace_or_replace<T>(entity, std::move(component));
+			}
+		}
+
+		size_t GetTrackedCount() const { return m_Originals.size() + m_Added.size(); }
+
+	private:
+		struct Slot
+		{
+			entt::entity Entity = entt::null;
+			bool Added = false;
+		};
+
+		static size_t GetIndex(entt::entity entity) { return (size_t)entt::to_integral(entt::registry::entity(entity)); }
+
+		bool IsTracked(entt::entity entity) const
+		{
+			size_t index = GetIndex(entity);
+			return index < m_Slots.size() && m_Slots[index].Entity == entity;
+		}
+
+		void MarkTracked(entt::entity entity, bool added)
+		{
+			size_t index = GetIndex(entity);
+			if (index >= m_Slots.size())
+				m_Slots.resize(index + 1);
+			m_Slots[index] = { entity, added };
+		}
+
+		void OnConstruct(entt::registry& registry, entt::entity entity)
+		{
+			if (IsTracked(entity))
+				return;
+
+			MarkTracked(entity, true);
+			m_Added.push_back(entity);
+		}
+
+		void OnUpdate(entt::registry& registry, entt::entity entity)
+		{
+			// on_update is published after the value was written, so the original can no longer be recovered here.
+			// Entity::AddOrReplaceComponent tracks before replacing, anything else replacing components while playing is a bug.
+			ASSERT(IsTracked(entity), "Component replaced while playing without being tracked, it will not be restored.");
+		}
+
+		void OnDestroy(entt::registry& registry, entt::entity entity)
+		{
+			Track(entity, registry.get<T>(entity));
+		}
+
+	private:
+		std::vector<Slot> m_Slots; // indexed by entity id
+		std::vector<std::pair<entt::entity, T>> m_Originals;
+		std::vector<entt::entity> m_Added;
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// SceneSnapshot ////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Delta snapshot of a scene taken when entering play/simulation. Taking it only connects observers,
+	// restoring it only touches the entities and components that were created, destroyed or accessed since.
+	class SceneSnapshot
+	{
+	public:
+		SceneSnapshot(Scene* scene);
+		~SceneSnapshot();
+
+		template<typename T>
+		void Track(entt::entity entity, const T& component)
+		{
+			std::get<ComponentBackup<T>>(m_Backups).Track(entity, component);
+		}
+
+		// Puts the scene back in the state it was when the snapshot was taken. The snapshot must be discarded afterwards.
+		void Restore();
+
+		size_t GetTrackedCount() const;
+
+	private:
+		void OnEntityCreated(entt::registry& registry, entt::entity entity);
+		void OnEntityDestroyed(entt::registry& registry, entt::entity entity);
+		void Disconnect();
+
+	private:
+		Scene* m_Scene = nullptr;
+		bool m_Connected = false;
+
+		std::tuple<
+			ComponentBackup<IDComponent>,
+			ComponentBackup<TagComponent>,
+			ComponentBackup<RelationshipComponent>,
+			ComponentBackup<TransformComponent>,
+			ComponentBackup<SpriteRendererComponent>,
+			ComponentBackup<CameraComponent>,
+			ComponentBackup<ScriptComponent>,
+			ComponentBackup<CircleRendererComponent>,
+			ComponentBackup<Rigidbody2DComponent>,
+			ComponentBackup<BoxCollider2DComponent>,
+			ComponentBackup<CircleCollider2DComponent>,
+			ComponentBackup<PolygonCollider2DComponent>,
+			ComponentBackup<CapsuleCollider2DComponent>,
+			ComponentBackup<EdgeChainCollider2DComponent>,
+			ComponentBackup<Joint2DComponent>,
+			ComponentBackup<TextComponent>,
+			ComponentBackup<ParticleEmitterComponent>,
+			ComponentBackup<AudioSourcesComponent>
+		> m_Backups;
+
+		std::vector<entt::entity> m_CreatedEntities;
+		std::vector<entt::entity> m_DestroyedEntities;
+
+		// scene settings can be edited from the editor while playing
+		std::string m_SceneName;
+		glm::vec2 m_Acc;
+		uint32_t m_FixedUpdateRate;
+		uint32_t m_MaxSubSteps;
+		bool m_InterpolateTransforms;
+		bool m_PipelinedPhysics;
+	};
+
+}
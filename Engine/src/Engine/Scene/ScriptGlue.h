@@ -1,6 +1,8 @@
 #pragma once
 #include "Entity.h"
 #include "Components.h"
+#include "Prefab.h"
+#include "EntityPool.h"
 #include "SceneRuntimeData.h"
 #include "Engine/Window/Input.h"
 #include "Engine/Window/KeyCodes.h"
@@ -16,6 +18,7 @@
 #include "box2d/b2_polygon_shape.h"
 #include "box2d/b2_circle_shape.h"
 #include "box2d/b2_contact.h"
+#include "box2d/b2_joint.h"
 
 
 namespace Engine
@@ -213,6 +216,18 @@ namespace Engine
 			"Dynamic", Rigidbody2DComponent::BodyType::Dynamic,
 			"Kinematic", Rigidbody2DComponent::BodyType::Kinematic
 		);
+		m_Lua->new_enum("JointType",
+			"Revolute", Joint2DComponent::JointType::Revolute,
+			"Distance", Joint2DComponent::JointType::Distance,
+			"Prismatic", Joint2DComponent::JointType::Prismatic,
+			"Weld", Joint2DComponent::JointType::Weld,
+			"Mouse", Joint2DComponent::JointType::Mouse
+		);
+		m_Lua->new_enum("UpdateSchedule",
+			"EveryStep", ScriptComponent::UpdateSchedule::EveryStep,
+			"Interval", ScriptComponent::UpdateSchedule::Interval,
+			"OnDemand", ScriptComponent::UpdateSchedule::OnDemand
+		);
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// Bind types
@@ -359,7 +374,7 @@ namespace Engine
 		m_Lua->new_usertype<Rigidbody2DComponent>("Rigidbody", 
 			"Type", sol::property(
 				[](Rigidbody2DComponent& rb) { return rb.Type; },
-				[](Rigidbody2DComponent& rb, Rigidbody2DComponent::BodyType type) {
+				[scene](Rigidbody2DComponent& rb, Rigidbody2DComponent::BodyType type) {
 					rb.Type = type;
 					// If the Box2D body already exists, update it live!
 					if (rb.RuntimeBody)
@@ -367,23 +382,29 @@ namespace Engine
 						b2Body* body = static_cast<b2Body*>(rb.RuntimeBody);
 
 						b2BodyType b2type = Rigidbody2DTypeToBox2DBody(type);
-						body->SetType(b2type);
-						body->SetAwake(true);
+						scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetType((uint8_t)b2type));
+						scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetAwake(true));
 					}
 				}
 			),
 
 			"FixedRotation", sol::property(
 				[](Rigidbody2DComponent& rb) { return rb.FixedRotation; },
-				[](Rigidbody2DComponent& rb, bool fixed) {
+				[scene](Rigidbody2DComponent& rb, bool fixed) {
 					rb.FixedRotation = fixed;
 					if (rb.RuntimeBody)
 					{
-						static_cast<b2Body*>(rb.RuntimeBody)->SetFixedRotation(fixed);
+						scene->m_PhysicsRecorder.ApplyBodyCommand(static_cast<b2Body*>(rb.RuntimeBody), BodyCommand::SetFixedRotation(fixed));
 					}
 				}
 			)
 		);
+		m_Lua->new_usertype<ColliderContactOptions>("ColliderContactOptions",
+			"IsSensor", &ColliderContactOptions::IsSensor,
+			"OneWay", &ColliderContactOptions::OneWay,
+			"OneWayDirection", &ColliderContactOptions::OneWayDirection,
+			"ImpulseThreshold", &ColliderContactOptions::ImpulseThreshold
+		);
 		m_Lua->new_usertype<BoxCollider2DComponent>("BoxCollider",
 			"Offset", &BoxCollider2DComponent::Offset,
 			"Size", &BoxCollider2DComponent::Size,
@@ -391,6 +412,7 @@ namespace Engine
 			"Friction", &BoxCollider2DComponent::Friction,
 			"Restitution", &BoxCollider2DComponent::Restitution,
 			"RestitutionThreshold", &BoxCollider2DComponent::RestitutionThreshold,
+			"ContactOptions", &BoxCollider2DComponent::ContactOptions,
 			"RigidBodyParent", sol::property(
 				[m_Lua, scene](BoxCollider2DComponent& src) -> sol::object {
 					if (src.ClosestRigidbodyParent == entt::null)
@@ -406,6 +428,7 @@ namespace Engine
 			"Friction", &CircleCollider2DComponent::Friction,
 			"Restitution", &CircleCollider2DComponent::Restitution,
 			"RestitutionThreshold", &CircleCollider2DComponent::RestitutionThreshold,
+			"ContactOptions", &CircleCollider2DComponent::ContactOptions,
 			"RigidBodyParent", sol::property(
 				[m_Lua, scene](CircleCollider2DComponent& src) -> sol::object {
 					if (src.ClosestRigidbodyParent == entt::null)
@@ -414,6 +437,136 @@ namespace Engine
 				}
 			)
 		);
+		m_Lua->new_usertype<PolygonCollider2DComponent>("PolygonCollider",
+			"Offset", &PolygonCollider2DComponent::Offset,
+			"Vertices", sol::property(
+				[m_Lua](PolygonCollider2DComponent& src) {
+					sol::table points = m_Lua->create_table((int)src.Vertices.size(), 0);
+					for (size_t i = 0; i < src.Vertices.size(); i++)
+						points[i + 1] = src.Vertices[i];
+					return points;
+				},
+				[](PolygonCollider2DComponent& src, sol::table points) {
+					src.Vertices.clear();
+					for (size_t i = 1; i <= points.size(); i++)
+						src.Vertices.push_back(points.get<glm::vec2>(i));
+				}
+			),
+			"Density", &PolygonCollider2DComponent::Density,
+			"Friction", &PolygonCollider2DComponent::Friction,
+			"Restitution", &PolygonCollider2DComponent::Restitution,
+			"RestitutionThreshold", &PolygonCollider2DComponent::RestitutionThreshold,
+			"ContactOptions", &PolygonCollider2DComponent::ContactOptions,
+			"RigidBodyParent", sol::property(
+				[m_Lua, scene](PolygonCollider2DComponent& src) -> sol::object {
+					if (src.ClosestRigidbodyParent == entt::null)
+						return sol::nil;
+					return sol::make_object(*m_Lua, Entity{ src.ClosestRigidbodyParent, scene });
+				}
+			)
+		);
+		m_Lua->new_usertype<CapsuleCollider2DComponent>("CapsuleCollider",
+			"Offset", &CapsuleCollider2DComponent::Offset,
+			"Radius", &CapsuleCollider2DComponent::Radius,
+			"Height", &CapsuleCollider2DComponent::Height,
+			"Density", &CapsuleCollider2DComponent::Density,
+			"Friction", &CapsuleCollider2DComponent::Friction,
+			"Restitution", &CapsuleCollider2DComponent::Restitution,
+			"RestitutionThreshold", &CapsuleCollider2DComponent::RestitutionThreshold,
+			"ContactOptions", &CapsuleCollider2DComponent::ContactOptions,
+			"RigidBodyParent", sol::property(
+				[m_Lua, scene](CapsuleCollider2DComponent& src) -> sol::object {
+					if (src.ClosestRigidbodyParent == entt::null)
+						return sol::nil;
+					return sol::make_object(*m_Lua, Entity{ src.ClosestRigidbodyParent, scene });
+				}
+			)
+		);
+		m_Lua->new_usertype<EdgeChainCollider2DComponent>("EdgeChainCollider",
+			"Offset", &EdgeChainCollider2DComponent::Offset,
+			"Points", sol::property(
+				[m_Lua](EdgeChainCollider2DComponent& src) {
+					sol::table points = m_Lua->create_table((int)src.Points.size(), 0);
+					for (size_t i = 0; i < src.Points.size(); i++)
+						points[i + 1] = src.Points[i];
+					return points;
+				},
+				[](EdgeChainCollider2DComponent& src, sol::table points) {
+					src.Points.clear();
+					for (size_t i = 1; i <= points.size(); i++)
+						src.Points.push_back(points.get<glm::vec2>(i));
+				}
+			),
+			"Loop", &EdgeChainCollider2DComponent::Loop,
+			"Density", &EdgeChainCollider2DComponent::Density,
+			"Friction", &EdgeChainCollider2DComponent::Friction,
+			"Restitution", &EdgeChainCollider2DComponent::Restitution,
+			"RestitutionThreshold", &EdgeChainCollider2DComponent::RestitutionThreshold,
+			"ContactOptions", &EdgeChainCollider2DComponent::ContactOptions,
+			"RigidBodyParent", sol::property(
+				[m_Lua, scene](EdgeChainCollider2DComponent& src) -> sol::object {
+					if (src.ClosestRigidbodyParent == entt::null)
+						return sol::nil;
+					return sol::make_object(*m_Lua, Entity{ src.ClosestRigidbodyParent, scene });
+				}
+			)
+		);
+		// Motor, limit, softness and target settings are pushed to the running joint right away.
+		// Type, connection and anchors are read when the joint is created.
+		auto jointProperty = [scene](auto member) {
+			using T = std::decay_t<decltype(std::declval<Joint2DComponent&>().*member)>;
+			return sol::property(
+				[member](Joint2DComponent& joint) { return joint.*member; },
+				[scene, member](Joint2DComponent& joint, T value) {
+					joint.*member = value;
+					scene->UpdateJoint(joint);
+				}
+			);
+		};
+		m_Lua->new_usertype<Joint2DComponent>("Joint",
+			"Type", &Joint2DComponent::Type,
+			"Anchor", &Joint2DComponent::Anchor,
+			"ConnectedAnchor", &Joint2DComponent::ConnectedAnchor,
+			"CollideConnected", &Joint2DComponent::CollideConnected,
+			"Axis", &Joint2DComponent::Axis,
+			"ConnectedEntity", sol::property(
+				[m_Lua, scene](Joint2DComponent& joint) -> sol::object {
+					Entity connected = scene->FindEntityByUUID(joint.ConnectedEntity);
+					if (!connected)
+						return sol::nil;
+					return sol::make_object(*m_Lua, connected);
+				},
+				// nil connects to the world. A running joint is created again with the new connection.
+				[scene](Joint2DComponent& joint, sol::optional<Entity> connected) {
+					joint.ConnectedEntity = connected && *connected ? connected->GetUUID() : UUID(0);
+					if (joint.RuntimeJoint)
+					{
+						entt::entity owner = (entt::entity)(uint32_t)((b2Joint*)joint.RuntimeJoint)->GetUserData().pointer;
+						scene->CreateJoint(Entity{ owner, scene });
+					}
+				}
+			),
+			"EnableLimit", jointProperty(&Joint2DComponent::EnableLimit),
+			"LowerLimit", jointProperty(&Joint2DComponent::LowerLimit),
+			"UpperLimit", jointProperty(&Joint2DComponent::UpperLimit),
+			"EnableMotor", jointProperty(&Joint2DComponent::EnableMotor),
+			"MotorSpeed", jointProperty(&Joint2DComponent::MotorSpeed),
+			"MaxMotorForce", jointProperty(&Joint2DComponent::MaxMotorForce),
+			"Length", jointProperty(&Joint2DComponent::Length),
+			"MinLength", jointProperty(&Joint2DComponent::MinLength),
+			"MaxLength", jointProperty(&Joint2DComponent::MaxLength),
+			"Frequency", jointProperty(&Joint2DComponent::Frequency),
+			"DampingRatio", jointProperty(&Joint2DComponent::DampingRatio),
+			"Target", jointProperty(&Joint2DComponent::Target),
+			"MaxForce", jointProperty(&Joint2DComponent::MaxForce),
+			"SetLimits", [scene](Joint2DComponent& joint, float lower, float upper) {
+				joint.EnableLimit = true;
+				joint.LowerLimit = lower;
+				joint.UpperLimit = upper;
+				scene->UpdateJoint(joint);
+			},
+			"IsCreated", [](Joint2DComponent& joint) { return joint.RuntimeJoint != nullptr; }
+		);
 		m_Lua->new_usertype<TextComponent>("Text", 
 			"TextString", &TextComponent::TextString,
 			"Color", &TextComponent::Color,
@@ -546,6 +699,19 @@ namespace Engine
 				ENGINE_LOG_ERROR("Lua Error: Audio Source '{}' not found for removal on Entity!", soundName);
 			}
 		);
+		m_Lua->new_usertype<ParticleEmitterComponent>("ParticleEmitter",
+			"Velocity", &ParticleEmitterComponent::Velocity,
+			"VelocityVariation", &ParticleEmitterComponent::VelocityVariation,
+			"ColorBegin", &ParticleEmitterComponent::ColorBegin,
+			"ColorEnd", &ParticleEmitterComponent::ColorEnd,
+			"SizeBegin", &ParticleEmitterComponent::SizeBegin,
+			"SizeEnd", &ParticleEmitterComponent::SizeEnd,
+			"SizeVariation", &ParticleEmitterComponent::SizeVariation,
+			"LifeTime", &ParticleEmitterComponent::LifeTime,
+			"EmissionRate", &ParticleEmitterComponent::EmissionRate,
+			"MaxParticles", &ParticleEmitterComponent::MaxParticles,
+			"GetParticleCount", [](ParticleEmitterComponent& component) -> uint32_t { return component.Particles.Count; }
+		);
 		m_Lua->new_usertype<RelationshipComponent>("Relation",
 			"Parent", sol::property(
 				// GETTER
@@ -618,9 +784,10 @@ namespace Engine
 			"FixedAspectRatio", &CameraComponent::FixedAspectRatio
 		);
 		m_Lua->new_usertype<Entity>("Entity",
-			"GetUUID", [](Entity& entity) -> std::string { return std::to_string((uint64_t)entity.GetUUID()); },
+			// lua integers are signed 64 bit, the UUID bits are passed through as is
+			"GetUUID", [](Entity& entity) -> int64_t { return (int64_t)(uint64_t)entity.GetUUID(); },
 			"GetName", &Entity::GetName,
-			"SetName", [](Entity& entity, std::string& newName) { entity.GetComponent<TagComponent>().Tag = newName; },
+			"SetName", [](Entity& entity, std::string& newName) { entity.SetName(newName); },
 #define BIND_COMPONENT_PROPERTY(name, component) name, sol::property([](Entity& entity) -> component* {\
 				if (!entity)\
 					throw std::runtime_error("Attempted to access " name " on a destroyed entity!");\
@@ -635,7 +802,12 @@ namespace Engine
 			BIND_COMPONENT_PROPERTY("Rigidbody", Rigidbody2DComponent),
 			BIND_COMPONENT_PROPERTY("BoxCollider", BoxCollider2DComponent),
 			BIND_COMPONENT_PROPERTY("CircleCollider", CircleCollider2DComponent),
+			BIND_COMPONENT_PROPERTY("PolygonCollider", PolygonCollider2DComponent),
+			BIND_COMPONENT_PROPERTY("CapsuleCollider", CapsuleCollider2DComponent),
+			BIND_COMPONENT_PROPERTY("EdgeChainCollider", EdgeChainCollider2DComponent),
+			BIND_COMPONENT_PROPERTY("Joint", Joint2DComponent),
 			BIND_COMPONENT_PROPERTY("Text", TextComponent),
+			BIND_COMPONENT_PROPERTY("ParticleEmitter", ParticleEmitterComponent),
 			BIND_COMPONENT_PROPERTY("Relation", RelationshipComponent),
 			BIND_COMPONENT_PROPERTY("CameraComponent", CameraComponent),
 			BIND_COMPONENT_PROPERTY("AudioSources", AudioSourcesComponent),
@@ -649,7 +821,12 @@ namespace Engine
 			BIND_ADD_COMPONENT_FUNCTION("AddRigidbody", Rigidbody2DComponent),
 			BIND_ADD_COMPONENT_FUNCTION("AddBoxCollider", BoxCollider2DComponent),
 			BIND_ADD_COMPONENT_FUNCTION("AddCircleCollider", CircleCollider2DComponent),
+			BIND_ADD_COMPONENT_FUNCTION("AddPolygonCollider", PolygonCollider2DComponent),
+			BIND_ADD_COMPONENT_FUNCTION("AddCapsuleCollider", CapsuleCollider2DComponent),
+			BIND_ADD_COMPONENT_FUNCTION("AddEdgeChainCollider", EdgeChainCollider2DComponent),
+			BIND_ADD_COMPONENT_FUNCTION("AddJoint", Joint2DComponent),
 			BIND_ADD_COMPONENT_FUNCTION("AddText", TextComponent),
+			BIND_ADD_COMPONENT_FUNCTION("AddParticleEmitter", ParticleEmitterComponent),
 			BIND_ADD_COMPONENT_FUNCTION("AddCameraComponent", CameraComponent),
 			BIND_ADD_COMPONENT_FUNCTION("AddAudioSources", AudioSourcesComponent),
 #undef BIND_ADD_COMPONENT_FUNCTION
@@ -678,26 +855,69 @@ namespace Engine
 			"IsEnabled", [](Entity entity) -> bool {return entity.isEnabled(); },
 			"SetEnabled", [](Entity entity, bool enable) { entity.setEnabled(enable); },
 
+			// OnUpdate scheduling, the interval is in seconds and kept if not given
+			"SetUpdateSchedule", [scene](Entity entity, ScriptComponent::UpdateSchedule schedule, sol::optional<float> interval) {
+				if (!entity.HasComponent<ScriptComponent>())
+					throw std::runtime_error("SetUpdateSchedule called on an entity without a Script!");
+				auto& sc = entity.GetComponent<ScriptComponent>();
+				sc.RuntimeSchedule = schedule;
+				sc.RuntimeUpdateInterval = std::max(interval.value_or(sc.RuntimeUpdateInterval), 0.0f);
+				scene->ScheduleScript(entity);
+			},
+			// one OnUpdate after 'delay' seconds (next step if 0), for on demand scripts woken by events or timers
+			"ScheduleUpdate", [scene](Entity entity, float delay) {
+				if (!entity.HasComponent<ScriptComponent>())
+					throw std::runtime_error("ScheduleUpdate called on an entity without a Script!");
+				scene->ScheduleScriptUpdate(entity, delay);
+			},
+
+			// burst of 'count' particles from the entity's emitter, at its position unless one is given
+			"EmitParticles", [scene](Entity entity, uint32_t count, sol::optional<glm::vec2> position) {
+				if (!entity.HasComponent<ParticleEmitterComponent>())
+					throw std::runtime_error("EmitParticles called on an entity without a ParticleEmitter!");
+				if (position)
+					scene->EmitParticles(entity, count, position.value());
+				else
+					scene->EmitParticles(entity, count);
+			},
+
 			"RebuildFixtures", [](Entity& entity) {
 				entity.DetachFixturesFromRigidbodyParent();
 				entity.AttachFixturesToRigidbodyParent();
 			}
 		);
 
+		m_Lua->new_usertype<Prefab>("Prefab",
+			"GetName", &Prefab::GetName,
+			"GetNodeCount", &Prefab::GetNodeCount
+		);
+		m_Lua->new_usertype<EntityPool>("EntityPool",
+			// returns nil when every instance is in use
+			"Acquire", [m_Lua](EntityPool& pool) -> sol::object {
+				Entity entity = pool.Acquire();
+				if (entity)
+					return sol::make_object(*m_Lua, entity);
+				return sol::make_object(*m_Lua, sol::nil);
+			},
+			"Release", &EntityPool::Release,
+			"ReleaseAll", &EntityPool::ReleaseAll,
+			"GetCapacity", &EntityPool::GetCapacity,
+			"GetActiveCount", &EntityPool::GetActiveCount
+		);
+
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		// Bind global functions
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 		m_Lua->set_function("GetEntityByTag", [scene, m_Lua](std::string tag) -> sol::object {
-
-			auto& view = scene->m_Registry.view<TagComponent>();
-			for (auto& e : view)
-			{
-				if (view.get<TagComponent>(e).Tag == tag)
-					return sol::make_object(*m_Lua, Entity{ e, scene });
-			}
+			Entity entity = scene->GetEntityByTag(tag);
+			if (entity)
+				return sol::make_object(*m_Lua, entity);
 			return sol::make_object(*m_Lua, sol::nil); // Returns Lua 'nil'
 			});
+		m_Lua->set_function("GetEntitiesByTag", [scene](std::string tag) {
+			return sol::as_table(scene->GetEntitiesByTag(tag));
+			});
 
 		// Global Data
 		m_Lua->set_function("GetGlobal", [m_Lua](std::string key) -> sol::object {
@@ -711,7 +931,7 @@ namespace Engine
 			});
 		// We register multiple C++ functions to the SAME Lua name "Set"
 		m_Lua->set_function("SetGlobal", sol::overload(
-			&RuntimeData::SetData<int>,
+			&RuntimeData::SetData<int64_t>,
 			&RuntimeData::SetData<float>,
 			&RuntimeData::SetData<bool>,
 			&RuntimeData::SetData<std::string>,
@@ -733,11 +953,18 @@ namespace Engine
 		sceneTable.set_function("CreateEntity", [scene](std::string name, sol::optional<Entity> parentEntity) -> Entity {
 			Entity actualParent = parentEntity ? parentEntity.value() : Entity{ scene->m_SceneRoot, scene };
 			Entity newEntity = scene->CreateNewChildEntity(actualParent);
-			newEntity.GetComponent<TagComponent>().Tag = name;
+			newEntity.SetName(name);
 			return newEntity;
 		});
+		sceneTable.set_function("FindEntityByUUID", [scene, m_Lua](int64_t uuid) -> sol::object {
+			Entity entity = scene->FindEntityByUUID(UUID((uint64_t)uuid));
+			if (entity)
+				return sol::make_object(*m_Lua, entity);
+			return sol::make_object(*m_Lua, sol::nil);
+		});
+		// destruction is deferred to the end of the frame, so handles stay valid while scripts and callbacks iterate
 		sceneTable.set_function("DestroyEntity", [scene](Entity entity) {
-			scene->DestroyEntity(entity);
+			scene->QueueDestroyEntity(entity);
 		});
 		sceneTable.set_function("UpdateParent", [scene](Entity childEntity, Entity parentEntity, sol::optional<bool> keepWorldTransform) {
 			scene->UpdateParent(childEntity, parentEntity, keepWorldTransform ? keepWorldTransform.value() : false);
@@ -745,6 +972,46 @@ namespace Engine
 		sceneTable.set_function("DuplicateEntity", [scene](Entity entity) -> Entity {
 			return scene->DuplicateEntity(entity);
 		});
+		// prefabs. paths are relative to the asset directory, loaded prefabs are cached until the scene stops
+		sceneTable.set_function("LoadPrefab", [scene, m_Lua](std::string path) -> sol::object {
+			std::filesystem::path prefabPath = Project::GetAssetFileSystemPath(path);
+			auto it = scene->m_PrefabCache.find(prefabPath);
+			if (it != scene->m_PrefabCache.end())
+				return sol::make_object(*m_Lua, it->second);
+
+			std::shared_ptr<Prefab> prefab = Prefab::Load(prefabPath);
+			if (!prefab)
+				return sol::make_object(*m_Lua, sol::nil);
+
+			scene->m_PrefabCache[prefabPath] = prefab;
+			return sol::make_object(*m_Lua, prefab);
+		});
+		sceneTable.set_function("CreatePrefab", [](Entity entity) -> std::shared_ptr<Prefab> {
+			return Prefab::Create(entity);
+		});
+		sceneTable.set_function("InstantiatePrefab", [scene](std::shared_ptr<Prefab> prefab, sol::optional<uint32_t> count, sol::optional<Entity> parentEntity) {
+			if (!prefab)
+				throw std::runtime_error("InstantiatePrefab called without a prefab!");
+			Entity actualParent = parentEntity ? parentEntity.value() : Entity{ scene->m_SceneRoot, scene };
+			return sol::as_table(scene->InstantiatePrefab(*prefab, count ? count.value() : 1, actualParent));
+		});
+		// instances are created up front and disabled, acquire/release only toggles them
+		sceneTable.set_function("CreatePool", [scene](std::shared_ptr<Prefab> prefab, uint32_t count, sol::optional<Entity> parentEntity) {
+			if (!prefab)
+				throw std::runtime_error("CreatePool called without a prefab!");
+			Entity actualParent = parentEntity ? parentEntity.value() : Entity{ scene->m_SceneRoot, scene };
+			return EntityPool::Create(scene, prefab, count, actualParent);
+		});
+		// spatial queries over active entities, by their world AABB
+		sceneTable.set_function("QueryAABB", [scene](glm::vec2 min, glm::vec2 max) {
+			return sol::as_table(scene->QueryAABB(min, max));
+		});
+		sceneTable.set_function("QueryRadius", [scene](glm::vec2 center, float radius) {
+			return sol::as_table(scene->QueryRadius(center, radius));
+		});
+		sceneTable.set_function("QueryNearest", [scene](glm::vec2 point, sol::optional<uint32_t> count) {
+			return sol::as_table(scene->QueryNearest(point, count ? count.value() : 1));
+		});
 		sceneTable.set_function("IsDescendant", [scene](Entity potentialAncestor, Entity potentialDescendant) -> bool {
 			return scene->IsDescendant(potentialAncestor, potentialDescendant);
 		});
@@ -813,93 +1080,93 @@ namespace Engine
 				return false;
 			};
 
-		physicsTable["SetGravityScale"] = [ExecuteOnPhysicsBody](Entity& entity, float scale) {
+		physicsTable["SetGravityScale"] = [ExecuteOnPhysicsBody, scene](Entity& entity, float scale) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetGravityScale(scale);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetGravityScale(scale));
 				return true;
 				});
 			};
 
-		physicsTable["ApplyLinearImpulse"] = [ExecuteOnPhysicsBody](Entity& entity, glm::vec2 impulse, glm::vec2 point, bool wake) {
+		physicsTable["ApplyLinearImpulse"] = [ExecuteOnPhysicsBody, scene](Entity& entity, glm::vec2 impulse, glm::vec2 point, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->ApplyLinearImpulse(b2Vec2(impulse.x, impulse.y), b2Vec2(point.x, point.y), wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::ApplyLinearImpulse(impulse, point, wake));
 				return true;
 				});
 			};
 
-		physicsTable["ApplyLinearImpulseToCenter"] = [ExecuteOnPhysicsBody](Entity& entity, glm::vec2 force, bool wake) {
+		physicsTable["ApplyLinearImpulseToCenter"] = [ExecuteOnPhysicsBody, scene](Entity& entity, glm::vec2 force, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->ApplyLinearImpulseToCenter(b2Vec2(force.x, force.y), wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::ApplyLinearImpulseToCenter(force, wake));
 				return true;
 				});
 			};
 
-		physicsTable["ApplyAngularImpulse"] = [ExecuteOnPhysicsBody](Entity& entity, float impulse, bool wake) {
+		physicsTable["ApplyAngularImpulse"] = [ExecuteOnPhysicsBody, scene](Entity& entity, float impulse, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->ApplyAngularImpulse(impulse, wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::ApplyAngularImpulse(impulse, wake));
 				return true;
 				});
 			};
 
-		physicsTable["ApplyForce"] = [ExecuteOnPhysicsBody](Entity& entity, glm::vec2 force, glm::vec2 point, bool wake) {
+		physicsTable["ApplyForce"] = [ExecuteOnPhysicsBody, scene](Entity& entity, glm::vec2 force, glm::vec2 point, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->ApplyForce(b2Vec2(force.x, force.y), b2Vec2(point.x, point.y), wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::ApplyForce(force, point, wake));
 				return true;
 				});
 			};
 
-		physicsTable["ApplyForceToCenter"] = [ExecuteOnPhysicsBody](Entity& entity, glm::vec2 force, bool wake) {
+		physicsTable["ApplyForceToCenter"] = [ExecuteOnPhysicsBody, scene](Entity& entity, glm::vec2 force, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->ApplyForceToCenter(b2Vec2(force.x, force.y), wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::ApplyForceToCenter(force, wake));
 				return true;
 				});
 			};
 
-		physicsTable["ApplyTorque"] = [ExecuteOnPhysicsBody](Entity& entity, float torque, bool wake) {
+		physicsTable["ApplyTorque"] = [ExecuteOnPhysicsBody, scene](Entity& entity, float torque, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->ApplyTorque(torque, wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::ApplyTorque(torque, wake));
 				return true;
 				});
 			};
 
-		physicsTable["SetAngularDamping"] = [ExecuteOnPhysicsBody](Entity& entity, float damp) {
+		physicsTable["SetAngularDamping"] = [ExecuteOnPhysicsBody, scene](Entity& entity, float damp) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetAngularDamping(damp);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetAngularDamping(damp));
 				return true;
 				});
 			};
 
-		physicsTable["SetAngularVelocity"] = [ExecuteOnPhysicsBody](Entity& entity, float vel) {
+		physicsTable["SetAngularVelocity"] = [ExecuteOnPhysicsBody, scene](Entity& entity, float vel) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetAngularVelocity(vel);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetAngularVelocity(vel));
 				return true;
 				});
 			};
 
-		physicsTable["SetLinearDamping"] = [ExecuteOnPhysicsBody](Entity& entity, float damp) {
+		physicsTable["SetLinearDamping"] = [ExecuteOnPhysicsBody, scene](Entity& entity, float damp) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetLinearDamping(damp);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetLinearDamping(damp));
 				return true;
 				});
 			};
 
-		physicsTable["SetLinearVelocity"] = [ExecuteOnPhysicsBody](Entity& entity, glm::vec2 vel) {
+		physicsTable["SetLinearVelocity"] = [ExecuteOnPhysicsBody, scene](Entity& entity, glm::vec2 vel) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetLinearVelocity(b2Vec2(vel.x, vel.y));
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetLinearVelocity(vel));
 				return true;
 				});
 			};
 
-		physicsTable["SetAwake"] = [ExecuteOnPhysicsBody](Entity& entity, bool wake) {
+		physicsTable["SetAwake"] = [ExecuteOnPhysicsBody, scene](Entity& entity, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetAwake(wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetAwake(wake));
 				return true;
 				});
 			};
 
-		physicsTable["SetEnabled"] = [ExecuteOnPhysicsBody](Entity& entity, bool wake) {
+		physicsTable["SetEnabled"] = [ExecuteOnPhysicsBody, scene](Entity& entity, bool wake) {
 			ExecuteOnPhysicsBody(entity, [&](b2Body* body) {
-				body->SetEnabled(wake);
+				scene->m_PhysicsRecorder.ApplyBodyCommand(body, BodyCommand::SetEnabled(wake));
 				return true;
 				});
 			};
@@ -952,6 +1219,39 @@ namespace Engine
 				return body->IsEnabled();
 				});
 			};
+
+		// World queries. 'mask' is optional and matches collider Category bits, everything by default.
+		// Hits are tables { Entity, Point, Normal, Fraction }.
+		auto ToLuaHit = [m_Lua, scene](const Scene::RaycastHit& hit) {
+			return m_Lua->create_table_with(
+				"Entity", Entity{ hit.Entity, scene },
+				"Point", hit.Point,
+				"Normal", hit.Normal,
+				"Fraction", hit.Fraction);
+			};
+
+		physicsTable["Raycast"] = [scene, ToLuaHit](glm::vec2 from, glm::vec2 to, sol::optional<uint16_t> mask) -> sol::object {
+			Scene::RaycastHit hit;
+			if (!scene->Raycast(from, to, mask.value_or(0xFFFF), hit))
+				return sol::lua_nil;
+			return ToLuaHit(hit);
+			};
+
+		physicsTable["RaycastAll"] = [m_Lua, scene, ToLuaHit](glm::vec2 from, glm::vec2 to, sol::optional<uint16_t> mask) {
+			auto hits = scene->RaycastAll(from, to, mask.value_or(0xFFFF));
+			sol::table result = m_Lua->create_table((int)hits.size(), 0);
+			for (size_t i = 0; i < hits.size(); i++)
+				result[i + 1] = ToLuaHit(hits[i]);
+			return result;
+			};
+
+		physicsTable["OverlapAABB"] = [scene](glm::vec2 min, glm::vec2 max, sol::optional<uint16_t> mask) {
+			return sol::as_table(scene->OverlapAABB(min, max, mask.value_or(0xFFFF)));
+			};
+
+		physicsTable["OverlapCircle"] = [scene](glm::vec2 center, float radius, sol::optional<uint16_t> mask) {
+			return sol::as_table(scene->OverlapCircle(center, radius, mask.value_or(0xFFFF)));
+			};
 	}
 
 	class PhysicsContactListener : public b2ContactListener
@@ -962,95 +1262,383 @@ namespace Engine
 		{
 		}
 
-		struct ContactData
+		enum class ContactEventType : uint8_t { Begin = 0, End };
+
+		// Plain data, so queuing an event never allocates once the buffers have grown
+		struct ContactEvent
 		{
-			Entity A, B;
-			std::string func;
+			entt::entity A, B;
+			ContactEventType Type;
+			glm::vec2 Point;	// world space, zero for sensors
+			glm::vec2 Normal;	// from A to B
+			float Impulse;		// normal impulse of the first solve, zero for End and sensor contacts
+			float ThresholdA, ThresholdB;	// ImpulseThreshold of each collider
+			uint8_t FilteredBegin;	// End only, FilteredA/FilteredB of the contact's Begin. A side whose Begin was filtered gets no End either.
 		};
 
-		std::vector<ContactData> PendingCollisions;
+		static constexpr uint8_t FilteredA = 1, FilteredB = 2;
 
-		void FireCallbacks()
+		// Dispatches the events queued by the last step and returns how many were dispatched
+		uint32_t FireCallbacks()
 		{
-			// 1. Make a local copy of all pending collisions
-			std::vector<ContactData> currentCollisions = PendingCollisions;
+			// Swap the buffers first. Events raised by the callbacks themselves (a script disabling a body reports
+			// EndContact right away) go into the other buffer and are dispatched after the next step.
+			std::vector<ContactEvent>& events = m_Events[m_WriteBuffer];
+			m_WriteBuffer ^= 1;
 
-			// 2. Clear the main queue immediately!
-			// Now, if Box2D triggers EndContact during our loop, it will push 
-			// into the empty PendingCollisions vector, leaving our local copy perfectly safe.
-			PendingCollisions.clear();
+			// Begin events of the step that were never solved keep a zero impulse, their index is for the buffer just swapped out
+			for (b2Contact* contact : m_PendingContacts)
+			{
+				if (ContactState* state = m_Contacts.Find(contact))
+					state->PendingEvent = NoPendingEvent;
+			}
+			m_PendingContacts.clear();
+			m_PendingCount = 0;
 
-			// 3. Iterate over the safe, local copy
-			for (auto& col : currentCollisions)
+			for (const auto& event : events)
 			{
-				callCollision(col.A, col.B, col.func);
-				callCollision(col.B, col.A, col.func);
+				// soft hits are filtered out before going to Lua, and so is the End of a filtered Begin
+				const uint8_t filtered = event.Type == ContactEventType::Begin ? GetFilteredSides(event) : event.FilteredBegin;
+				Entity a = { event.A, m_Scene };
+				Entity b = { event.B, m_Scene };
+				if (!(filtered & FilteredA))
+					callCollision(a, b, event, event.Normal);
+				if (!(filtered & FilteredB))
+					callCollision(b, a, event, -event.Normal);
 			}
+
+			uint32_t count = (uint32_t)events.size();
+			events.clear(); // keeps its capacity
+			return count;
 		}
 
 		// Called when two fixtures begin to touch
 		virtual void BeginContact(b2Contact* contact) override
 		{
-			// Get fixtures
-			b2Fixture* fixtureA = contact->GetFixtureA();
-			b2Fixture* fixtureB = contact->GetFixtureB();
+			ContactEvent& event = PushEvent(contact, ContactEventType::Begin);
 
-			// Get the Entities from UserData
-			uintptr_t userDataA = fixtureA->GetUserData().pointer;
-			uintptr_t userDataB = fixtureB->GetUserData().pointer;
+			// sensors are never solved, there is no impulse to compare against
+			if (!contact->GetFixtureA()->IsSensor() && !contact->GetFixtureB()->IsSensor())
+			{
+				ColliderContactOptions options;
+				if (GetColliderOptions(contact->GetFixtureA(), options))
+					event.ThresholdA = options.ImpulseThreshold;
+				if (GetColliderOptions(contact->GetFixtureB(), options))
+					event.ThresholdB = options.ImpulseThreshold;
+			}
 
-			// Convert back to Entity
-			Entity entityA = { (entt::entity)userDataA, m_Scene };
-			Entity entityB = { (entt::entity)userDataB, m_Scene };
+			b2WorldManifold manifold;
+			contact->GetWorldManifold(&manifold);
+			int32 pointCount = contact->GetManifold()->pointCount;
+			if (pointCount > 0)
+			{
+				b2Vec2 point = pointCount == 1 ? manifold.points[0] : 0.5f * (manifold.points[0] + manifold.points[1]);
+				event.Point = { point.x, point.y };
+				event.Normal = { manifold.normal.x, manifold.normal.y };
+			}
 
-			PendingCollisions.push_back({ entityA, entityB, "OnCollisionBegin" });
+			// the impulse is only known once the contact is solved, see PostSolve. Until then it is zero,
+			// which filters the sides with a threshold.
+			ContactState& state = m_Contacts.Insert(contact);
+			state.PendingEvent = (uint32_t)m_Events[m_WriteBuffer].size() - 1;
+			state.FilteredBegin = GetFilteredSides(event);
+			state.PassingThrough = false;
+			m_PendingContacts.push_back(contact);
+			m_PendingCount++;
 		}
 
 		// Called when two fixtures cease to touch
 		virtual void EndContact(b2Contact* contact) override
 		{
-			// Get fixtures
+			ContactEvent& event = PushEvent(contact, ContactEventType::End);
+
+			// the contact is freed right after and its address may be reused
+			ContactState* state = m_Contacts.Find(contact);
+			if (!state)
+				return;
+
+			event.FilteredBegin = state->FilteredBegin;
+			if (state->PendingEvent != NoPendingEvent)
+				m_PendingCount--;
+			if (state->PassingThrough)
+				m_PassingThroughCount--;
+			m_Contacts.Erase(contact);
+		}
+
+		// Called every step for every touching, non sensor contact before it is solved
+		virtual void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override
+		{
 			b2Fixture* fixtureA = contact->GetFixtureA();
 			b2Fixture* fixtureB = contact->GetFixtureB();
+			ColliderContactOptions options;
+			// Box2D re-enables contacts every step, keep the ones passing through a one way collider disabled until they end
+			ContactState* state = m_PassingThroughCount > 0 ? m_Contacts.Find(contact) : nullptr;
+			if (state && state->PassingThrough)
+			{
+				contact->SetEnabled(false);
+			}
+			else if ((GetColliderOptions(fixtureA, options) && options.OneWay && !ShouldCollideOneWay(contact, fixtureA, fixtureB, options.OneWayDirection, true)) ||
+				(GetColliderOptions(fixtureB, options) && options.OneWay && !ShouldCollideOneWay(contact, fixtureB, fixtureA, options.OneWayDirection, false)))
+			{
+				contact->SetEnabled(false);
+				// touching contacts have begun, their state exists
+				if (!state)
+					state = m_Contacts.Find(contact);
+				if (state)
+				{
+					state->PassingThrough = true;
+					m_PassingThroughCount++;
+				}
+			}
 
-			// Get the Entities from UserData
-			uintptr_t userDataA = fixtureA->GetUserData().pointer;
-			uintptr_t userDataB = fixtureB->GetUserData().pointer;
+			// the replay disables the same contacts
+			m_Scene->m_PhysicsRecorder.OnPreSolve(contact);
+		}
+
+		virtual void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override
+		{
+			if (m_PendingCount == 0)
+				return;
 
-			// Convert back to Entity
-			Entity entityA = { (entt::entity)userDataA, m_Scene };
-			Entity entityB = { (entt::entity)userDataB, m_Scene };
+			// every touching contact gets here, every step
+			ContactState* state = m_Contacts.Find(contact);
+			if (!state || state->PendingEvent == NoPendingEvent)
+				return;
 
-			PendingCollisions.push_back({ entityA, entityB, "OnCollisionEnd" });
+			// only the first solve counts, that is the hit
+			float total = 0.0f;
+			for (int32 i = 0; i < impulse->count; i++)
+				total += impulse->normalImpulses[i];
+			ContactEvent& event = m_Events[m_WriteBuffer][state->PendingEvent];
+			event.Impulse = total;
+			state->FilteredBegin = GetFilteredSides(event);
+			state->PendingEvent = NoPendingEvent;
+			m_PendingCount--;
 		}
 
 	private:
-		Scene* m_Scene;
-		
-		// Helper function to avoid code duplication
-		void callCollision(Entity& self, Entity& other, const std::string& function) {
+		ContactEvent& PushEvent(b2Contact* contact, ContactEventType type)
+		{
+			// Get the Entities from UserData
+			entt::entity a = (entt::entity)(uint32_t)contact->GetFixtureA()->GetUserData().pointer;
+			entt::entity b = (entt::entity)(uint32_t)contact->GetFixtureB()->GetUserData().pointer;
+			return m_Events[m_WriteBuffer].emplace_back(ContactEvent{ a, b, type, { 0.0f, 0.0f }, { 0.0f, 0.0f }, 0.0f, 0.0f, 0.0f, 0 });
+		}
+
+		// Sides of a Begin event whose hit is softer than their collider's ImpulseThreshold
+		static uint8_t GetFilteredSides(const ContactEvent& event)
+		{
+			return (event.Impulse < event.ThresholdA ? FilteredA : 0) | (event.Impulse < event.ThresholdB ? FilteredB : 0);
+		}
+
+		// Options of the collider component the fixture was created from
+		bool GetColliderOptions(b2Fixture* fixture, ColliderContactOptions& options)
+		{
+			auto& registry = m_Scene->m_Registry;
+			entt::entity entity = (entt::entity)(uint32_t)fixture->GetUserData().pointer;
+			if (!registry.valid(entity))
+				return false;
+
+			return GetColliderOptions<BoxCollider2DComponent>(entity, fixture, options)
+				|| GetColliderOptions<CircleCollider2DComponent>(entity, fixture, options)
+				|| GetColliderOptions<PolygonCollider2DComponent>(entity, fixture, options)
+				|| GetColliderOptions<CapsuleCollider2DComponent>(entity, fixture, options)
+				|| GetColliderOptions<EdgeChainCollider2DComponent>(entity, fixture, options);
+		}
+
+		template<typename Collider>
+		bool GetColliderOptions(entt::entity entity, b2Fixture* fixture, ColliderContactOptions& options)
+		{
+			auto* collider = m_Scene->m_Registry.try_get<Collider>(entity);
+			if (!collider || !OwnsFixture(*collider, fixture))
+				return false;
+
+			options = collider->ContactOptions;
+			return true;
+		}
+
+		template<typename Collider>
+		static bool OwnsFixture(const Collider& collider, b2Fixture* fixture) { return collider.RuntimeFixture == fixture; }
+		static bool OwnsFixture(const CapsuleCollider2DComponent& collider, b2Fixture* fixture)
+		{
+			return collider.RuntimeFixture == fixture || collider.RuntimeCapFixtures[0] == fixture || collider.RuntimeCapFixtures[1] == fixture;
+		}
+
+		// The other fixture collides with a one way fixture only if it is on the OneWayDirection side and moving into it
+		static bool ShouldCollideOneWay(b2Contact* contact, b2Fixture* oneWay, b2Fixture* other, const glm::vec2& localDirection, bool oneWayIsA)
+		{
+			int32 pointCount = contact->GetManifold()->pointCount;
+			if (pointCount == 0)
+				return true;
+
+			b2Body* oneWayBody = oneWay->GetBody();
+			b2Body* otherBody = other->GetBody();
+
+			b2Vec2 direction = b2Mul(oneWayBody->GetTransform().q, b2Vec2(localDirection.x, localDirection.y));
+			if (direction.Normalize() < b2_epsilon)
+				return true;
+
+			b2WorldManifold manifold;
+			contact->GetWorldManifold(&manifold);
+			// manifold normal points from A to B, make it point from the one way collider to the other one
+			b2Vec2 normal = oneWayIsA ? manifold.normal : -manifold.normal;
+
+			// touching the sides or the back
+			if (b2Dot(normal, direction) < 0.5f)
+				return false;
+
+			// touching the front, collide unless it is moving out (like jumping up through a platform)
+			for (int32 i = 0; i < pointCount; i++)
+			{
+				b2Vec2 relativeVelocity = otherBody->GetLinearVelocityFromWorldPoint(manifold.points[i]) - oneWayBody->GetLinearVelocityFromWorldPoint(manifold.points[i]);
+				if (b2Dot(relativeVelocity, direction) < b2_linearSlop)
+					return true;
+			}
+			return false;
+		}
+
+		void callCollision(Entity& self, Entity& other, const ContactEvent& event, const glm::vec2& normal)
+		{
+			// destroying a body reports EndContact for entities that no longer exist
+			if (!self || !other)
+				return;
 			if (!self.HasComponent<ScriptComponent>())
 				return;
 
 			auto& sc = self.GetComponent<ScriptComponent>();
-
-			// Check if the Instance table is valid
-			if (!sc.Instance.valid())
+			// copied, the component moves if the callback adds scripts. A copy is a registry reference, not a lookup.
+			sol::protected_function callback = event.Type == ContactEventType::Begin ? sc.OnCollisionBegin : sc.OnCollisionEnd;
+			if (!callback.valid())
 				return;
 
-			// Check if the function exists
-			sol::protected_function onCollisionFunc = sc.Instance[function];
-			if (onCollisionFunc.valid())
+			// Call it safely (catches Lua runtime errors like "attempt to index nil")
+			sol::protected_function_result result = callback(sc.Instance, other, event.Point, normal, event.Impulse);
+			if (!result.valid())
 			{
-				// Call it safely (catches Lua runtime errors like "attempt to index nil")
-				sol::protected_function_result result = onCollisionFunc(sc.Instance, other);
+				sol::error err = result;
+				ENGINE_LOG_ERROR("Script Error in {0}: {1}", event.Type == ContactEventType::Begin ? "OnCollisionBegin" : "OnCollisionEnd", err.what());
+			}
+		}
 
-				if (!result.valid())
+	private:
+		Scene* m_Scene;
+
+		std::vector<ContactEvent> m_Events[2];
+		uint32_t m_WriteBuffer = 0;
+
+		static constexpr uint32_t NoPendingEvent = std::numeric_limits<uint32_t>::max();
+
+		// What the listener keeps about a touching contact, from BeginContact to EndContact
+		struct ContactState
+		{
+			uint32_t PendingEvent = NoPendingEvent;	// Begin event of the current step waiting for its impulse, index in the write buffer
+			uint8_t FilteredBegin = 0;	// sides the Begin event was filtered for, their End is filtered too
+			bool PassingThrough = false;	// disabled by a one way collider until it ends
+		};
+
+		// b2Contact -> ContactState, Box2D contacts have no user data. Open addressing (linear probing) in a single flat
+		// array like UUIDIndex, with backward shift erase. The array only grows, once it fits the most contacts touching
+		// at a time, tracking them does not allocate.
+		class ContactStateTable
+		{
+		public:
+			ContactState& Insert(b2Contact* contact)
+			{
+				if ((m_Count + 1) * 4 > m_Slots.size() * 3) // keep load factor under 0.75
+					Rehash(m_Slots.empty() ? 256 : m_Slots.size() * 2);
+
+				size_t index = FindSlot(contact);
+				if (!m_Slots[index].Contact)
 				{
-					sol::error err = result;
-					ENGINE_LOG_ERROR("Script Error in {0}: {1}", function, err.what());
+					m_Slots[index].Contact = contact;
+					m_Count++;
 				}
+				return m_Slots[index].State;
 			}
-		}
+
+			ContactState* Find(b2Contact* contact)
+			{
+				if (m_Count == 0)
+					return nullptr;
+
+				Slot& slot = m_Slots[FindSlot(contact)];
+				return slot.Contact ? &slot.State : nullptr;
+			}
+
+			void Erase(b2Contact* contact)
+			{
+				if (m_Count == 0)
+					return;
+
+				size_t index = FindSlot(contact);
+				if (!m_Slots[index].Contact)
+					return;
+
+				// backward shift: move up every following entry whose home slot is at or before the hole
+				const size_t mask = m_Slots.size() - 1;
+				size_t hole = index;
+				size_t next = (hole + 1) & mask;
+				while (m_Slots[next].Contact)
+				{
+					size_t home = Hash(m_Slots[next].Contact) & mask;
+					if (((next - home) & mask) >= ((next - hole) & mask))
+					{
+						m_Slots[hole] = m_Slots[next];
+						hole = next;
+					}
+					next = (next + 1) & mask;
+				}
+				m_Slots[hole] = Slot();
+				m_Count--;
+			}
+
+		private:
+			struct Slot
+			{
+				b2Contact* Contact = nullptr; // null marks an empty slot
+				ContactState State;
+			};
+
+			// contacts come from Box2D's block allocator, the low bits are alignment
+			static size_t Hash(const b2Contact* contact)
+			{
+				uint64_t key = (uint64_t)(uintptr_t)contact;
+				key ^= key >> 33;
+				key *= 0xff51afd7ed558ccdull;
+				key ^= key >> 33;
+				return (size_t)key;
+			}
+
+			// slot holding 'contact', or the empty slot where it would go
+			size_t FindSlot(const b2Contact* contact) const
+			{
+				const size_t mask = m_Slots.size() - 1;
+				size_t index = Hash(contact) & mask;
+				while (m_Slots[index].Contact && m_Slots[index].Contact != contact)
+					index = (index + 1) & mask;
+				return index;
+			}
+
+			void Rehash(size_t capacity)
+			{
+				std::vector<Slot> old = std::move(m_Slots);
+				m_Slots.assign(capacity, Slot());
+				for (const auto& slot : old)
+				{
+					if (slot.Contact)
+						m_Slots[FindSlot(slot.Contact)] = slot;
+				}
+			}
+
+		private:
+			std::vector<Slot> m_Slots; // size is always a power of two
+			size_t m_Count = 0;
+		};
+
+		ContactStateTable m_Contacts;
+		// contacts that began this step, their pending index is dropped when the events are dispatched
+		std::vector<b2Contact*> m_PendingContacts;
+		uint32_t m_PendingCount = 0;	// Begin events still waiting for their impulse
+		uint32_t m_PassingThroughCount = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "egpch.h"
+#include "SpatialHash.h"
+
+namespace Engine {
+
+	// above this many cells an entity goes to the large list instead
+	static constexpr int64_t MaxCellsPerEntity = 64;
+
+	SpatialHash::SpatialHash(float cellSize)
+		: m_CellSize(cellSize), m_InverseCellSize(1.0f / cellSize)
+	{
+	}
+
+	void SpatialHash::Update(entt::entity entity, const glm::vec2& min, const glm::vec2& max)
+	{
+		size_t index = GetIndex(entity);
+		if (index >= m_Records.size())
+			m_Records.resize(index + 1);
+
+		Record& record = m_Records[index];
+		record.Min = min;
+		record.Max = max;
+
+		CellRange cells = GetCells(min, max);
+		if (record.Entity == entity && cells == record.Cells)
+			return; // still in the same cells, the common case for entities that did not move much
+
+		if (record.Entity != entt::null)
+			Unlink(record);
+		else
+			m_Count++;
+
+		record.Entity = entity;
+		record.Cells = cells;
+		Link(record);
+	}
+
+	void SpatialHash::Remove(entt::entity entity)
+	{
+		size_t index = GetIndex(entity);
+		if (index >= m_Records.size() || m_Records[index].Entity != entity)
+			return;
+
+		Record& record = m_Records[index];
+		Unlink(record);
+		record.Entity = entt::null;
+		m_Count--;
+	}
+
+	void SpatialHash::Clear()
+	{
+		m_Records.clear();
+		m_Cells.clear();
+		m_Large.clear();
+		m_Count = 0;
+	}
+
+	void SpatialHash::QueryAABB(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& result)
+	{
+		result.clear();
+		ForEachOverlap(min, max, [&](const Record& record) {
+			result.push_back(record.Entity);
+		});
+	}
+
+	void SpatialHash::QueryRadius(const glm::vec2& center, float radius, std::vector<entt::entity>& result)
+	{
+		result.clear();
+		const float radiusSquared = radius * radius;
+		ForEachOverlap(center - glm::vec2(radius), center + glm::vec2(radius), [&](const Record& record) {
+			if (DistanceSquared(record, center) <= radiusSquared)
+				result.push_back(record.Entity);
+		});
+	}
+
+	void SpatialHash::QueryNearest(const glm::vec2& point, uint32_t count, std::vector<entt::entity>& result)
+	{
+		result.clear();
+		if (count == 0 || m_Count == 0)
+			return;
+
+		// grow the search radius until it holds enough entities, everything closer is then guaranteed to be inside
+		std::vector<std::pair<float, entt::entity>> candidates;
+		float radius = m_CellSize;
+		while (true)
+		{
+			candidates.clear();
+			const float radiusSquared = radius * radius;
+			ForEachOverlap(point - glm::vec2(radius), point + glm::vec2(radius), [&](const Record& record) {
+				float distance = DistanceSquared(record, point);
+				if (distance <= radiusSquared)
+					candidates.emplace_back(distance, record.Entity);
+			});
+
+			if (candidates.size() >= count || candidates.size() == m_Count || std::isinf(radius))
+				break;
+			radius *= 2.0f;
+		}
+
+		count = std::min(count, (uint32_t)candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+
+		result.reserve(count);
+		for (uint32_t i = 0; i < count; i++)
+			result.push_back(candidates[i].second);
+	}
+
+	float SpatialHash::DistanceSquared(const Record& record, const glm::vec2& point)
+	{
+		// 0 inside the box
+		glm::vec2 closest = glm::clamp(point, record.Min, record.Max);
+		glm::vec2 delta = point - closest;
+		return glm::dot(delta, delta);
+	}
+
+	SpatialHash::CellRange SpatialHash::GetCells(const glm::vec2& min, const glm::vec2& max) const
+	{
+		// clamped so far away (or infinite) bounds cannot overflow the cell coordinates
+		constexpr float limit = (float)(1 << 30);
+		auto cell = [&](float value) {
+			return (int32_t)glm::clamp(std::floor(value * m_InverseCellSize), -limit, limit);
+		};
+
+		CellRange range;
+		range.MinX = cell(min.x);
+		range.MinY = cell(min.y);
+		range.MaxX = cell(max.x);
+		range.MaxY = cell(max.y);
+		return range;
+	}
+
+	void SpatialHash::Link(Record& record)
+	{
+		const CellRange& cells = record.Cells;
+		int64_t cellCount = ((int64_t)cells.MaxX - cells.MinX + 1) * ((int64_t)cells.MaxY - cells.MinY + 1);
+		record.Large = cellCount > MaxCellsPerEntity;
+		if (record.Large)
+		{
+			m_Large.push_back(record.Entity);
+			return;
+		}
+
+		for (int32_t y = cells.MinY; y <= cells.MaxY; y++)
+		{
+			for (int32_t x = cells.MinX; x <= cells.MaxX; x++)
+				m_Cells[CellKey(x, y)].push_back(record.Entity);
+		}
+	}
+
+	void SpatialHash::Unlink(Record& record)
+	{
+		auto erase = [&](std::vector<entt::entity>& entities) {
+			auto it = std::find(entities.begin(), entities.end(), record.Entity);
+			if (it != entities.end())
+			{
+				*it = entities.back();
+				entities.pop_back();
+			}
+		};
+
+		if (record.Large)
+		{
+			erase(m_Large);
+			return;
+		}
+
+		const CellRange& cells = record.Cells;
+		for (int32_t y = cells.MinY; y <= cells.MaxY; y++)
+		{
+			for (int32_t x = cells.MinX; x <= cells.MaxX; x++)
+			{
+				// emptied cells are kept, entities tend to come back to the same areas
+				auto it = m_Cells.find(CellKey(x, y));
+				if (it != m_Cells.end())
+					erase(it->second);
+			}
+		}
+	}
+
+	template<typename Func>
+	void SpatialHash::ForEachOverlap(const glm::vec2& min, const glm::vec2& max, Func&& func)
+	{
+		if (++m_QueryStamp == 0)
+		{
+			for (auto& record : m_Records)
+				record.QueryStamp = 0;
+			m_QueryStamp = 1;
+		}
+
+		// an entity is listed in every cell it touches, the stamp makes sure it is reported once
+		auto visit = [&](entt::entity entity) {
+			Record& record = m_Records[GetIndex(entity)];
+			if (record.QueryStamp == m_QueryStamp)
+				return;
+			record.QueryStamp = m_QueryStamp;
+
+			if (record.Min.x <= max.x && record.Max.x >= min.x && record.Min.y <= max.y && record.Max.y >= min.y)
+				func(record);
+		};
+
+		CellRange range = GetCells(min, max);
+		int64_t cellCount = ((int64_t)range.MaxX - range.MinX + 1) * ((int64_t)range.MaxY - range.MinY + 1);
+		if (cellCount <= (int64_t)m_Cells.size())
+		{
+			for (int32_t y = range.MinY; y <= range.MaxY; y++)
+			{
+				for (int32_t x = range.MinX; x <= range.MaxX; x++)
+				{
+					auto it = m_Cells.find(CellKey(x, y));
+					if (it == m_Cells.end())
+						continue;
+					for (auto entity : it->second)
+						visit(entity);
+				}
+			}
+		}
+		else
+		{
+			// the query covers more cells than exist, walk the existing ones instead
+			for (auto& [key, entities] : m_Cells)
+			{
+				int32_t x = (int32_t)(uint32_t)(key >> 32);
+				int32_t y = (int32_t)(uint32_t)key;
+				if (x < range.MinX || x > range.MaxX || y < range.MinY || y > range.MaxY)
+					continue;
+				for (auto entity : entities)
+					visit(entity);
+			}
+		}
+
+		for (auto entity : m_Large)
+			visit(entity);
+	}
+
+}
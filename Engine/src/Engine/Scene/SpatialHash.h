@@ -0,0 +1,82 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include "entt.hpp"
+
+namespace Engine {
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// SpatialHash //////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// Uniform grid over world space AABBs, cells are hashed so the world has no bounds.
+	// An entity is listed in every cell its AABB touches, moving it only touches the grid when it changes cells.
+	class SpatialHash
+	{
+	public:
+		SpatialHash(float cellSize = 4.0f);
+
+		// Inserts the entity or updates its bounds
+		void Update(entt::entity entity, const glm::vec2& min, const glm::vec2& max);
+		void Remove(entt::entity entity);
+		void Clear();
+		bool Contains(entt::entity entity) const
+		{
+			size_t index = GetIndex(entity);
+			return index < m_Records.size() && m_Records[index].Entity == entity;
+		}
+
+		// Entities whose AABB overlaps [min, max], each listed once
+		void QueryAABB(const glm::vec2& min, const glm::vec2& max, std::vector<entt::entity>& result);
+		// Entities whose AABB is within 'radius' of 'center'
+		void QueryRadius(const glm::vec2& center, float radius, std::vector<entt::entity>& result);
+		// Up to 'count' entities closest to 'point' (distance to their AABB), closest first
+		void QueryNearest(const glm::vec2& point, uint32_t count, std::vector<entt::entity>& result);
+
+		size_t Size() const { return m_Count; }
+
+	private:
+		struct CellRange
+		{
+			int32_t MinX = 0, MinY = 0, MaxX = -1, MaxY = -1;
+
+			bool operator==(const CellRange& other) const { return MinX == other.MinX && MinY == other.MinY && MaxX == other.MaxX && MaxY == other.MaxY; }
+			bool operator!=(const CellRange& other) const { return !(*this == other); }
+		};
+
+		struct Record
+		{
+			entt::entity Entity = entt::null; // null if not in the grid
+			glm::vec2 Min{ 0.0f }, Max{ 0.0f };
+			CellRange Cells;
+			bool Large = false;
+			uint32_t QueryStamp = 0;
+		};
+
+		static size_t GetIndex(entt::entity entity) { return (size_t)entt::to_integral(entt::registry::entity(entity)); }
+		static uint64_t CellKey(int32_t x, int32_t y) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+		static float DistanceSquared(const Record& record, const glm::vec2& point);
+
+		CellRange GetCells(const glm::vec2& min, const glm::vec2& max) const;
+		void Link(Record& record);
+		void Unlink(Record& record);
+		// calls 'func' once for every entity whose AABB overlaps [min, max]
+		template<typename Func>
+		void ForEachOverlap(const glm::vec2& min, const glm::vec2& max, Func&& func);
+
+	private:
+		float m_CellSize;
+		float m_InverseCellSize;
+		size_t m_Count = 0;
+		uint32_t m_QueryStamp = 0;
+
+		std::vector<Record> m_Records; // indexed by entity id
+		std::unordered_map<uint64_t, std::vector<entt::entity>> m_Cells;
+		// entities spanning too many cells are kept aside and tested by every query instead
+		std::vector<entt::entity> m_Large;
+	};
+
+}
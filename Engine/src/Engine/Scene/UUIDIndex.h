@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+
+#include "Engine/Utils/UUID.h"
+#include "entt.hpp"
+
+namespace Engine {
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+	// UUIDIndex ////////////////////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	// UUID -> entity map with open addressing (linear probing) in a single flat array.
+	// Erase shifts following entries back instead of leaving tombstones, so lookups never degrade.
+	class UUIDIndex
+	{
+	public:
+		void Insert(UUID uuid, entt::entity entity)
+		{
+			if ((m_Count + 1) * 4 > m_Slots.size() * 3) // keep load factor under 0.75
+				Rehash(m_Slots.empty() ? 64 : m_Slots.size() * 2);
+
+			size_t index = FindSlot(uuid);
+			if (m_Slots[index].Entity == entt::null)
+				m_Count++;
+			m_Slots[index] = { (uint64_t)uuid, entity };
+		}
+
+		void Erase(UUID uuid)
+		{
+			if (m_Slots.empty())
+				return;
+
+			size_t index = FindSlot(uuid);
+			if (m_Slots[index].Entity == entt::null)
+				return;
+
+			// backward shift: move up every following entry whose home slot is at or before the hole
+			const size_t mask = m_Slots.size() - 1;
+			size_t hole = index;
+			size_t next = (hole + 1) & mask;
+			while (m_Slots[next].Entity != entt::null)
+			{
+				size_t home = Hash(m_Slots[next].ID) & mask;
+				if (((next - home) & mask) >= ((next - hole) & mask))
+				{
+					m_Slots[hole] = m_Slots[next];
+					hole = next;
+				}
+				next = (next + 1) & mask;
+			}
+			m_Slots[hole] = Slot();
+			m_Count--;
+		}
+
+		entt::entity Find(UUID uuid) const
+		{
+			if (m_Slots.empty())
+				return entt::null;
+			return m_Slots[FindSlot(uuid)].Entity;
+		}
+
+		void Clear()
+		{
+			m_Slots.clear();
+			m_Count = 0;
+		}
+
+		size_t Size() const { return m_Count; }
+
+	private:
+		struct Slot
+		{
+			uint64_t ID = 0;
+			entt::entity Entity = entt::null; // null marks an empty slot
+		};
+
+		// UUIDs are random already, only mix enough that the low bits used for the slot are well spread
+		static size_t Hash(uint64_t id)
+		{
+			id ^= id >> 33;
+			id *= 0xff51afd7ed558ccdull;
+			id ^= id >> 33;
+			return (size_t)id;
+		}
+
+		// slot holding 'uuid', or the empty slot where it would go
+		size_t FindSlot(UUID uuid) const
+		{
+			const size_t mask = m_Slots.size() - 1;
+			size_t index = Hash((uint64_t)uuid) & mask;
+			while (m_Slots[index].Entity != entt::null && m_Slots[index].ID != (uint64_t)uuid)
+				index = (index + 1) & mask;
+			return index;
+		}
+
+		void Rehash(size_t capacity)
+		{
+			std::vector<Slot> old = std::move(m_Slots);
+			m_Slots.assign(capacity, Slot());
+			m_Count = 0;
+			for (const auto& slot : old)
+			{
+				if (slot.Entity != entt::null)
+				{
+					m_Slots[FindSlot(slot.ID)] = slot;
+					m_Count++;
+				}
+			}
+		}
+
+	private:
+		std::vector<Slot> m_Slots; // size is always a power of two
+		size_t m_Count = 0;
+	};
+
+}
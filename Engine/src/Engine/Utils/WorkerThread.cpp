@@ -0,0 +1,62 @@
+#include "egpch.h"
+#include "WorkerThread.h"
+
+namespace Engine {
+
+	WorkerThread::WorkerThread()
+	{
+		m_Thread = std::thread(&WorkerThread::Run, this);
+	}
+
+	WorkerThread::~WorkerThread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Quit = true;
+		}
+		m_Condition.notify_all();
+		m_Thread.join();
+	}
+
+	void WorkerThread::Submit(std::function<void()> job)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return !m_Busy; });
+			m_Job = std::move(job);
+			m_Busy = true;
+		}
+		m_Condition.notify_all();
+	}
+
+	void WorkerThread::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Condition.wait(lock, [this]() { return !m_Busy; });
+	}
+
+	void WorkerThread::Run()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this]() { return m_Busy || m_Quit; });
+				// pending work is finished before quitting
+				if (!m_Busy)
+					return;
+				job = std::move(m_Job);
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Busy = false;
+			}
+			m_Condition.notify_all();
+		}
+	}
+
+}
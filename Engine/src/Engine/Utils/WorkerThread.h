@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Engine {
+
+	// A single background thread running one job at a time.
+	// Submit hands a job over to the thread, Wait blocks until it has finished.
+	class WorkerThread
+	{
+	public:
+		WorkerThread();
+		~WorkerThread();
+
+		WorkerThread(const WorkerThread&) = delete;
+		WorkerThread& operator=(const WorkerThread&) = delete;
+
+		// Waits for the previous job first, a worker never runs two jobs at once
+		void Submit(std::function<void()> job);
+		void Wait();
+
+	private:
+		void Run();
+
+	private:
+		std::thread m_Thread;
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+
+		std::function<void()> m_Job;
+		bool m_Busy = false;
+		bool m_Quit = false;
+	};
+
+}